@@ -0,0 +1,144 @@
+#include <arena.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+
+typedef struct
+{
+  size_t size;
+  unsigned char *data;
+} block_t;
+
+/* Interal structure (hiden from outside) to represent an arena */
+struct arena_t
+{
+  size_t block_size;
+  size_t nb_blocks;
+  size_t max_blocks;
+  block_t *blocks;
+  size_t current;
+  size_t used;
+};
+
+arena_t *arena_new(const size_t block_size)
+{
+  arena_t *arena = calloc(1, sizeof(arena_t));
+  if (!arena)
+    return NULL;
+
+  arena->block_size = block_size ? block_size : 4096;
+
+  return arena;
+}
+
+void arena_free(arena_t *arena)
+{
+  if (!arena)
+    return;
+
+  for (size_t i = 0; i < arena->nb_blocks; i = i + 1)
+    free(arena->blocks[i].data);
+
+  free(arena->blocks);
+  free(arena);
+}
+
+/* make the block of given index able to hold the given size */
+static bool arena_grow(arena_t *arena, const size_t next, const size_t size)
+{
+  size_t block_size = arena->block_size;
+  block_t *blocks = NULL;
+
+  if (next < arena->nb_blocks && arena->blocks[next].size >= size)
+    return true;
+
+  while (block_size < size)
+    block_size = block_size * 2;
+
+  if (next == arena->nb_blocks)
+  {
+    if (arena->nb_blocks == arena->max_blocks)
+    {
+      blocks = realloc(arena->blocks,
+                       (2 * arena->max_blocks + 1) * sizeof(block_t));
+      if (!blocks)
+        return false;
+
+      arena->blocks = blocks;
+      arena->max_blocks = 2 * arena->max_blocks + 1;
+    }
+
+    arena->blocks[next].data = NULL;
+    arena->nb_blocks = arena->nb_blocks + 1;
+  }
+
+/* a block too small for the request is replaced by a larger one */
+  free(arena->blocks[next].data);
+  arena->blocks[next].data = malloc(block_size);
+  arena->blocks[next].size = arena->blocks[next].data ? block_size : 0;
+
+  return arena->blocks[next].data != NULL;
+}
+
+void *arena_alloc(arena_t *arena, const size_t size)
+{
+  size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  size_t next = 0;
+  void *memory = NULL;
+
+  if (!arena || !size)
+    return NULL;
+
+  if (!arena->nb_blocks ||
+      arena->used + aligned > arena->blocks[arena->current].size)
+  {
+    next = arena->nb_blocks ? arena->current + 1 : 0;
+    if (!arena_grow(arena, next, aligned))
+      return NULL;
+
+    arena->current = next;
+    arena->used = 0;
+  }
+
+  memory = arena->blocks[arena->current].data + arena->used;
+  arena->used = arena->used + aligned;
+  memset(memory, 0, size);
+
+  return memory;
+}
+
+void arena_reset(arena_t *arena)
+{
+  if (!arena)
+    return;
+
+  arena->current = 0;
+  arena->used = 0;
+}
+
+arena_mark_t arena_mark(const arena_t *arena)
+{
+  arena_mark_t mark = {0, 0};
+
+  if (!arena)
+    return mark;
+
+  mark.block = arena->current;
+  mark.used = arena->used;
+
+  return mark;
+}
+
+void arena_release(arena_t *arena, const arena_mark_t mark)
+{
+  if (!arena)
+    return;
+
+  arena->current = mark.block;
+  arena->used = mark.used;
+}
@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Region allocator (forward declaration to hide the implementation). Memory
+   is taken from large blocks and given back all at once, either completely
+   with arena_reset or down to a previous mark with arena_release. The blocks
+   stay allocated for the next uses, so a warm arena never calls malloc. An
+   arena must not be shared between threads */
+typedef struct arena_t arena_t;
+
+/* position in an arena, to release everything allocated after it */
+typedef struct
+{
+  size_t block;
+  size_t used;
+} arena_mark_t;
+
+/* memory allocation for an arena whose blocks are at least of given size */
+arena_t *arena_new(const size_t block_size);
+
+/* free the given arena and all the memory taken from it */
+void arena_free(arena_t *arena);
+
+/* return a zeroed memory area of given size taken from the given arena, or
+   NULL if no memory is left */
+void *arena_alloc(arena_t *arena, const size_t size);
+
+/* give back all the memory taken from the given arena, in constant time */
+void arena_reset(arena_t *arena);
+
+/* return the current position of the given arena */
+arena_mark_t arena_mark(const arena_t *arena);
+
+/* give back the memory taken from the given arena after the given mark */
+void arena_release(arena_t *arena, const arena_mark_t mark);
+
+#endif /* ARENA_H */
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <batch.h>
+#include <latency.h>
+#include <pool.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* number of lines read before the workers are waited for and the answers
+   written, which bounds the memory whatever the size of the batch */
+#define BATCH_CHUNK 1024
+
+/* size of the pieces in which the lines left out of a slice are skipped */
+#define BATCH_SKIP_LENGTH 4096
+
+typedef struct
+{
+  batch_job_t job;
+  batch_cost_t cost;
+  char *line;
+  size_t line_size;
+  size_t index;
+  char *answer;
+  double prediction;
+  batch_result_t result;
+  uint64_t end;
+  uint64_t elapsed;
+} item_t;
+
+/* run the job of the given item and time it. The time is recorded later,
+   by the reader of the batch, so that the workers share nothing */
+static void batch_item(void *arg, void *state)
+{
+  item_t *item = arg;
+  uint64_t start = trace_clock();
+
+  item->answer[0] = '\0';
+  item->result.size = 0;
+  item->result.outcome = outcome_unsolvable;
+  item->job(item->index, item->line, item->answer, BATCH_ANSWER_LENGTH,
+            &item->result, state);
+  item->end = trace_clock();
+  item->elapsed = item->end - start;
+}
+
+static void batch_predict(void *arg, void *state)
+{
+  item_t *item = arg;
+
+  item->prediction = item->cost(item->index, item->line, state);
+}
+
+/* order the items from the costliest to the cheapest */
+static int batch_compare(const void *a, const void *b)
+{
+  const item_t *item_a = *(item_t *const *) a;
+  const item_t *item_b = *(item_t *const *) b;
+
+  if (item_a->prediction != item_b->prediction)
+    return item_a->prediction < item_b->prediction ? 1 : -1;
+
+  return item_a < item_b ? -1 : item_a > item_b;
+}
+
+bool batch_slice_parse(const char *spec, batch_slice_t *slice)
+{
+  int end = 0;
+
+  if (!spec || !slice)
+    return false;
+
+  if (sscanf(spec, "%zu:%zu%n", &slice->start, &slice->count, &end) != 2 ||
+      spec[end] != '\0')
+    return false;
+
+  return true;
+}
+
+/* check if the line of the given index belongs to the given slice */
+static bool batch_selected(const batch_slice_t *slice, const size_t index)
+{
+  if (index < slice->start)
+    return false;
+
+  return slice->nb_shards < 2 ||
+         (index - slice->start) % slice->nb_shards == slice->shard;
+}
+
+/* skip the next line of the given file without keeping it. return false at
+   the end of the file */
+static bool batch_skip(FILE *input)
+{
+  char buffer[BATCH_SKIP_LENGTH];
+  bool read = false;
+
+  while (fgets(buffer, sizeof(buffer), input))
+  {
+    read = true;
+    if (strchr(buffer, '\n'))
+      break;
+  }
+
+  return read;
+}
+
+/* read up to BATCH_CHUNK lines of the given slice in the given items, and
+   skip the others. index is the number of lines of the file read so far.
+   return the number of lines kept */
+static size_t batch_read(FILE *input, item_t *items,
+                         const batch_slice_t *slice, size_t *index)
+{
+  size_t nb_items = 0;
+  ssize_t length = 0;
+
+  while (nb_items < BATCH_CHUNK)
+  {
+    if (slice->count && *index >= slice->start + slice->count)
+      break;
+
+    if (!batch_selected(slice, *index))
+    {
+      if (!batch_skip(input))
+        break;
+
+      *index = *index + 1;
+      continue;
+    }
+
+    items[nb_items].index = *index;
+    *index = *index + 1;
+    length = getline(&items[nb_items].line, &items[nb_items].line_size,
+                     input);
+    if (length < 0)
+      break;
+
+    while (length > 0 && (items[nb_items].line[length - 1] == '\n' ||
+                          items[nb_items].line[length - 1] == '\r'))
+    {
+      length = length - 1;
+      items[nb_items].line[length] = '\0';
+    }
+
+    nb_items = nb_items + 1;
+  }
+
+  return nb_items;
+}
+
+bool batch_run(const char *path, FILE *fd, const size_t nb_workers,
+               batch_job_t job, batch_cost_t cost,
+               const batch_slice_t *slice, latency_t *latency,
+               void *(*state_new)(void), void (*state_free)(void *))
+{
+  batch_slice_t whole = {0, 0, 0, 1};
+  FILE *input = NULL;
+  item_t *items = NULL;
+  item_t **order = NULL;
+  char *answers = NULL;
+  pool_t *pool = NULL;
+  size_t nb_items = 0;
+  size_t index = 0;
+  bool success = false;
+
+  if (!path || !fd || !job)
+    return false;
+
+  if (!slice)
+    slice = &whole;
+
+  input = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!input)
+    return false;
+
+  items = calloc(BATCH_CHUNK, sizeof(item_t));
+  order = calloc(BATCH_CHUNK, sizeof(item_t *));
+  answers = malloc(BATCH_CHUNK * BATCH_ANSWER_LENGTH);
+  pool = pool_new(nb_workers, state_new, state_free);
+  if (!items || !order || !answers || !pool)
+    goto cleanup;
+
+  for (size_t i = 0; i < BATCH_CHUNK; i = i + 1)
+  {
+    items[i].job = job;
+    items[i].cost = cost;
+    items[i].answer = answers + i * BATCH_ANSWER_LENGTH;
+    order[i] = &items[i];
+  }
+
+  while ((nb_items = batch_read(input, items, slice, &index)))
+  {
+/* the costs are predicted by the workers too, before any job starts */
+    if (cost)
+    {
+      for (size_t i = 0; i < nb_items; i = i + 1)
+      {
+        order[i] = &items[i];
+        if (!pool_submit(pool, batch_predict, &items[i]))
+          goto cleanup;
+      }
+
+      pool_wait(pool);
+      qsort(order, nb_items, sizeof(item_t *), batch_compare);
+    }
+
+    for (size_t i = 0; i < nb_items; i = i + 1)
+      if (!pool_submit(pool, batch_item, order[i]))
+        goto cleanup;
+
+    pool_wait(pool);
+
+    for (size_t i = 0; i < nb_items; i = i + 1)
+    {
+      fprintf(fd, "%s\n", items[i].answer);
+      if (latency)
+        latency_record(latency, items[i].index, items[i].result.size,
+                       items[i].result.outcome, items[i].end,
+                       items[i].elapsed);
+    }
+  }
+
+  success = !ferror(input);
+
+  cleanup:
+    pool_free(pool);
+    if (items)
+      for (size_t i = 0; i < BATCH_CHUNK; i = i + 1)
+        free(items[i].line);
+
+    free(items);
+    free(order);
+    free(answers);
+    if (input != stdin)
+      fclose(input);
+
+  return success;
+}
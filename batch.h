@@ -0,0 +1,68 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <grid.h>
+#include <latency.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* longest answer a job may write, a grid of the largest size on a line and
+   some room for the rest */
+#define BATCH_ANSWER_LENGTH (GRID_LINE_LENGTH(MAX_GRID_SIZE) + 256)
+
+/* what a job tells of the line it answered, for the latency report: the
+   size of its grid ('0' if the line is malformed) and the outcome of its
+   search */
+typedef struct
+{
+  size_t size;
+  solver_outcome_t outcome;
+} batch_result_t;
+
+/* a job reads the line of given index (from 0) of the batch, writes its
+   answer in the given buffer and fills the given result, using the private
+   state of the worker running it. Whatever a job draws at random should be
+   seeded from the index, so that a seeded batch gives the same answers
+   whichever worker runs the line */
+typedef void (*batch_job_t)(const size_t index, const char *line,
+                            char *answer, const size_t length,
+                            batch_result_t *result, void *state);
+
+/* a cost predicts how long the job of a batch will take on the line of
+   given index, using the private state of the worker running it */
+typedef double (*batch_cost_t)(const size_t index, const char *line,
+                               void *state);
+
+/* lines of a batch to process, numbered from 0: count lines from the start
+   one ('0': up to the end), and among them one out of nb_shards, from the
+   shard-th one on. The lines left out are skipped unread */
+typedef struct
+{
+  size_t start;
+  size_t count;
+  size_t shard;
+  size_t nb_shards;
+} batch_slice_t;
+
+/* read a slice 'START:COUNT' in the given slice, return false if it is
+   invalid */
+bool batch_slice_parse(const char *spec, batch_slice_t *slice);
+
+/* run the given job on every line of the file at the given path ('-' for
+   the standard input), or only on those of the given slice (may be NULL),
+   with the given number of workers, each one owning a state made by
+   state_new (may be NULL) and released by state_free. If a cost is given
+   (may be NULL), the lines read together are dispatched from the costliest
+   to the cheapest, so that the longest ones do not start last. The answers
+   are written in the given file, one per line, in the order of the input.
+   The time taken by each line is recorded in the given report (may be
+   NULL). return false if the file could not be read */
+bool batch_run(const char *path, FILE *fd, const size_t nb_workers,
+               batch_job_t job, batch_cost_t cost,
+               const batch_slice_t *slice, latency_t *latency,
+               void *(*state_new)(void), void (*state_free)(void *));
+
+#endif /* BATCH_H */
@@ -0,0 +1,556 @@
+#define _GNU_SOURCE
+
+#include <arena.h>
+#include <colors.h>
+#include <grid.h>
+#include <rng.h>
+#include <schedule.h>
+
+#include <err.h>
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* a kernel is timed over enough operations to last BENCH_MIN_NS, the
+   counters are read on the same run */
+#define BENCH_MIN_NS 50000000ULL
+#define BENCH_SEED 1
+
+/* number of random colors fed to the colors_* kernels */
+#define NB_INPUTS 4096
+
+#define NB_COUNTERS 5
+
+static const char *counter_names[NB_COUNTERS] = {"cycles", "instructions",
+                                                 "branch_misses",
+                                                 "l1d_misses", "llc_misses"};
+
+/* inputs of the kernels for one grid size: a grid in the middle of a
+   search (cells of several colors beside singletons), the units of this
+   grid, and random colors within the size */
+typedef struct
+{
+  size_t size;
+  rng_t rng;
+  grid_t *grid;
+  grid_t *copy;
+  arena_t *arena;
+  choice_t *choice;
+  colors_t units[NB_SUBGRID_TYPE * MAX_GRID_SIZE][MAX_GRID_SIZE];
+  colors_t unit[MAX_GRID_SIZE];
+  colors_t inputs[NB_INPUTS];
+  FILE *null;
+} bench_t;
+
+/* a kernel runs the given number of operations, and returns a value for
+   the sink so that its results are not optimized away */
+typedef uint64_t (*kernel_t)(bench_t *bench, const size_t nb_ops);
+
+typedef struct
+{
+  const char *name;
+  kernel_t run;
+} kernel_entry_t;
+
+static uint64_t kernel_colors_count(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + colors_count(bench->inputs[i % NB_INPUTS]);
+
+  return sink;
+}
+
+static uint64_t kernel_colors_index(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + colors_index(bench->inputs[i % NB_INPUTS]);
+
+  return sink;
+}
+
+static uint64_t kernel_colors_rightmost(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink ^ colors_rightmost(bench->inputs[i % NB_INPUTS]);
+
+  return sink;
+}
+
+static uint64_t kernel_colors_leftmost(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink ^ colors_leftmost(bench->inputs[i % NB_INPUTS]);
+
+  return sink;
+}
+
+static uint64_t kernel_colors_nth(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+  colors_t colors = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+  {
+    colors = bench->inputs[i % NB_INPUTS];
+    sink = sink ^ colors_nth(colors, i % (colors_count(colors) + 1));
+  }
+
+  return sink;
+}
+
+static uint64_t kernel_colors_random(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink ^ colors_random(bench->inputs[i % NB_INPUTS], &bench->rng);
+
+  return sink;
+}
+
+/* copy the i-th unit of the grid in the scratch unit, and return the
+   pointers on its cells */
+static colors_t **bench_unit(bench_t *bench, const size_t i,
+                             colors_t **subgrid)
+{
+  size_t unit = i % (NB_SUBGRID_TYPE * bench->size);
+
+  memcpy(bench->unit, bench->units[unit], bench->size * sizeof(colors_t));
+  for (size_t j = 0; j < bench->size; j = j + 1)
+    subgrid[j] = &bench->unit[j];
+
+  return subgrid;
+}
+
+/* the cost of resetting a unit, paid by every subgrid kernel */
+static uint64_t kernel_subgrid_reset(bench_t *bench, const size_t nb_ops)
+{
+  colors_t *subgrid[MAX_GRID_SIZE];
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink ^ *bench_unit(bench, i, subgrid)[i % bench->size];
+
+  return sink;
+}
+
+static uint64_t bench_technique(bench_t *bench, const size_t nb_ops,
+                                const technique_t technique)
+{
+  colors_t *subgrid[MAX_GRID_SIZE];
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + subgrid_technique(bench_unit(bench, i, subgrid),
+                                    bench->size, technique);
+
+  return sink;
+}
+
+static uint64_t kernel_cross_hatching(bench_t *bench, const size_t nb_ops)
+{
+  return bench_technique(bench, nb_ops, technique_cross_hatching);
+}
+
+static uint64_t kernel_lone_number(bench_t *bench, const size_t nb_ops)
+{
+  return bench_technique(bench, nb_ops, technique_lone_number);
+}
+
+static uint64_t kernel_naked_subset(bench_t *bench, const size_t nb_ops)
+{
+  return bench_technique(bench, nb_ops, technique_naked_subset);
+}
+
+static uint64_t kernel_hidden_subset(bench_t *bench, const size_t nb_ops)
+{
+  return bench_technique(bench, nb_ops, technique_hidden_subset);
+}
+
+static uint64_t kernel_alldifferent(bench_t *bench, const size_t nb_ops)
+{
+  return bench_technique(bench, nb_ops, technique_alldifferent);
+}
+
+static uint64_t kernel_subgrid_heuristics(bench_t *bench, const size_t nb_ops)
+{
+  colors_t *subgrid[MAX_GRID_SIZE];
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + subgrid_heuristics(bench_unit(bench, i, subgrid),
+                                     bench->size);
+
+  return sink;
+}
+
+/* gathers the cells of every unit, as get_grid_subgrid used to */
+static uint64_t kernel_grid_is_consistent(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + grid_is_consistent(bench->grid);
+
+  return sink;
+}
+
+static uint64_t kernel_grid_choice(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    sink = sink + grid_choice_update(bench->grid, bench->choice);
+
+  return sink;
+}
+
+static uint64_t kernel_grid_copy(bench_t *bench, const size_t nb_ops)
+{
+  uint64_t sink = 0;
+  grid_t *copy = NULL;
+
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+  {
+    copy = grid_copy(bench->grid);
+    sink = sink + (uintptr_t) copy;
+    grid_free(copy);
+  }
+
+  return sink;
+}
+
+static uint64_t kernel_grid_copy_into(bench_t *bench, const size_t nb_ops)
+{
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    grid_copy_into(bench->copy, bench->grid);
+
+  return grid_get_colors(bench->copy, 0, 0);
+}
+
+static uint64_t kernel_grid_print(bench_t *bench, const size_t nb_ops)
+{
+  for (size_t i = 0; i < nb_ops; i = i + 1)
+    grid_print(bench->grid, bench->null);
+
+  return 0;
+}
+
+static const kernel_entry_t kernels[] =
+{
+  {"colors_count", kernel_colors_count},
+  {"colors_index", kernel_colors_index},
+  {"colors_rightmost", kernel_colors_rightmost},
+  {"colors_leftmost", kernel_colors_leftmost},
+  {"colors_nth", kernel_colors_nth},
+  {"colors_random", kernel_colors_random},
+  {"subgrid_reset", kernel_subgrid_reset},
+  {"cross_hatching", kernel_cross_hatching},
+  {"lone_number", kernel_lone_number},
+  {"naked_subset", kernel_naked_subset},
+  {"hidden_subset", kernel_hidden_subset},
+  {"alldifferent", kernel_alldifferent},
+  {"subgrid_heuristics", kernel_subgrid_heuristics},
+  {"grid_is_consistent", kernel_grid_is_consistent},
+  {"grid_choice", kernel_grid_choice},
+  {"grid_copy", kernel_grid_copy},
+  {"grid_copy_into", kernel_grid_copy_into},
+  {"grid_print", kernel_grid_print}
+};
+
+#define NB_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static uint64_t clock_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/* open the hardware counters of this thread, -1 for the ones the kernel
+   or the machine does not give */
+static void counters_open(int *fds)
+{
+  struct perf_event_attr attr;
+  const uint32_t types[NB_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                       PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                       PERF_TYPE_HW_CACHE};
+  const uint64_t configs[NB_COUNTERS] =
+  {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+    PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+    PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+    PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+  };
+
+  for (size_t i = 0; i < NB_COUNTERS; i = i + 1)
+  {
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[i];
+    attr.config = configs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+}
+
+static void counters_close(const int *fds)
+{
+  for (size_t i = 0; i < NB_COUNTERS; i = i + 1)
+    if (fds[i] >= 0)
+      close(fds[i]);
+}
+
+static void counters_switch(const int *fds, const bool on)
+{
+  for (size_t i = 0; i < NB_COUNTERS; i = i + 1)
+    if (fds[i] >= 0)
+    {
+      if (on)
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+
+      ioctl(fds[i], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+/* read the counters, scaled up when the kernel multiplexed them. A counter
+   which could not be read is negative */
+static void counters_read(const int *fds, double *values)
+{
+  uint64_t data[3];
+
+  for (size_t i = 0; i < NB_COUNTERS; i = i + 1)
+  {
+    values[i] = -1.0;
+    if (fds[i] < 0 || read(fds[i], data, sizeof(data)) != sizeof(data) ||
+        !data[2])
+      continue;
+
+    values[i] = (double) data[0] * data[1] / data[2];
+  }
+}
+
+/* make the inputs for the given size: a solved grid (the rows of the
+   canonical pattern), two thirds of its cells emptied, then propagated */
+static bool bench_init(bench_t *bench, const size_t size)
+{
+  size_t sqrt = 1;
+  size_t nb_cells = size * size;
+  size_t where = 0;
+  size_t unit = 0;
+
+  memset(bench, 0, sizeof(bench_t));
+  bench->size = size;
+  rng_seed(&bench->rng, BENCH_SEED, size);
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  bench->grid = grid_alloc(size);
+  bench->copy = grid_alloc(size);
+  bench->arena = arena_new(4096);
+  bench->null = fopen("/dev/null", "w");
+  if (!bench->grid || !bench->copy || !bench->arena || !bench->null)
+    return false;
+
+  bench->choice = grid_choice_new_in(bench->arena);
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+      grid_set_colors(bench->grid, i, j,
+                      colors_set((sqrt * (i % sqrt) + i / sqrt + j) % size));
+
+  for (size_t i = 0; i < nb_cells * 2 / 3; i = i + 1)
+  {
+    where = rng_below(&bench->rng, nb_cells);
+    grid_set_colors(bench->grid, where / size, where % size,
+                    colors_full(size));
+  }
+
+  grid_schedule(bench->grid, NULL);
+
+/* the units, rows then columns then blocks */
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      bench->units[i][j] = grid_get_colors(bench->grid, i, j);
+      bench->units[size + i][j] = grid_get_colors(bench->grid, j, i);
+      unit = 2 * size + (i / sqrt) * sqrt + j / sqrt;
+      bench->units[unit][(i % sqrt) * sqrt + j % sqrt] =
+        grid_get_colors(bench->grid, i, j);
+    }
+
+  for (size_t i = 0; i < NB_INPUTS; i = i + 1)
+    bench->inputs[i] = rng_next(&bench->rng) & colors_full(size);
+
+  return true;
+}
+
+static void bench_clear(bench_t *bench)
+{
+  grid_free(bench->grid);
+  grid_free(bench->copy);
+  arena_free(bench->arena);
+  if (bench->null)
+    fclose(bench->null);
+}
+
+/* time the given kernel on the given inputs and print its entry */
+static void bench_kernel(bench_t *bench, const kernel_entry_t *kernel,
+                         const int *fds, const bool first)
+{
+  static volatile uint64_t sink = 0;
+  size_t nb_ops = 1;
+  uint64_t start = 0;
+  uint64_t elapsed = 0;
+  double values[NB_COUNTERS];
+
+/* the number of operations doubles until a run is long enough */
+  for (;;)
+  {
+    start = clock_ns();
+    sink = sink + kernel->run(bench, nb_ops);
+    elapsed = clock_ns() - start;
+    if (elapsed >= BENCH_MIN_NS / 4)
+      break;
+
+    nb_ops = nb_ops * 2;
+  }
+
+  nb_ops = nb_ops * 4;
+  counters_switch(fds, true);
+  start = clock_ns();
+  sink = sink + kernel->run(bench, nb_ops);
+  elapsed = clock_ns() - start;
+  counters_switch(fds, false);
+  counters_read(fds, values);
+
+  printf("%s  {\"kernel\": \"%s\", \"size\": %zu, \"ops\": %zu,"
+         " \"ns_per_op\": %.3f", first ? "" : ",\n", kernel->name,
+         bench->size, nb_ops, (double) elapsed / nb_ops);
+  for (size_t i = 0; i < NB_COUNTERS; i = i + 1)
+    if (values[i] < 0)
+      printf(", \"%s\": null", counter_names[i]);
+    else
+      printf(", \"%s\": %.3f", counter_names[i], values[i] / nb_ops);
+
+  printf("}");
+}
+
+int main(int argc, char **argv)
+{
+  bench_t *bench = NULL;
+  int fds[NB_COUNTERS];
+  size_t only_size = 0;
+  bool first = true;
+  bool wanted = false;
+  int optc;
+
+  static struct option long_opts[] =
+  {
+    {"help", no_argument, NULL, 'h'},
+    {"size", required_argument, NULL, 's'},
+    {NULL, no_argument, NULL, 0}
+  };
+
+  while ((optc = getopt_long(argc, argv, "hs:", long_opts, NULL)) != -1)
+    switch (optc)
+      {
+      case 'h':
+          fprintf(stdout, "Usage:\tbench [-s SIZE] [KERNEL ...]\n"
+            "Time the kernels of the solver on each grid size, and print"
+            " the results\nin JSON (counters are null when perf_event_open"
+            " is not available)\n\n"
+            " -s N,--size N\t\tonly run on grids of size NxN\n"
+            " -h,--help\t\tdisplay this help and exit\n\nKernels:");
+          for (size_t k = 0; k < NB_KERNELS; k = k + 1)
+            fprintf(stdout, " %s", kernels[k].name);
+
+          fprintf(stdout, "\n");
+        return EXIT_SUCCESS;
+
+      case 's':
+          only_size = strtoul(optarg, NULL, 10);
+          if (!grid_check_size(only_size) || only_size < 4)
+            errx(EXIT_FAILURE, "error invalid grid size\n");
+        break;
+
+      default:
+          errx(EXIT_FAILURE, "error: invalid option '%s'!\n",
+               argv[optind - 1]);
+      }
+
+  for (int i = optind; i < argc; i = i + 1)
+  {
+    wanted = false;
+    for (size_t k = 0; k < NB_KERNELS; k = k + 1)
+      wanted = wanted || !strcmp(argv[i], kernels[k].name);
+
+    if (!wanted)
+      errx(EXIT_FAILURE, "error: unknown kernel '%s'\n", argv[i]);
+  }
+
+  bench = malloc(sizeof(bench_t));
+  if (!bench)
+    errx(EXIT_FAILURE, "An error occured during memory allocation");
+
+  counters_open(fds);
+  printf("{\"counters\": %s, \"results\": [\n",
+         fds[0] >= 0 ? "true" : "false");
+  for (size_t sqrt = 2; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
+  {
+    if (only_size && only_size != sqrt * sqrt)
+      continue;
+
+    if (!bench_init(bench, sqrt * sqrt))
+      errx(EXIT_FAILURE, "An error occured during memory allocation");
+
+    for (size_t k = 0; k < NB_KERNELS; k = k + 1)
+    {
+      wanted = optind == argc;
+      for (int i = optind; i < argc; i = i + 1)
+        wanted = wanted || !strcmp(argv[i], kernels[k].name);
+
+      if (!wanted)
+        continue;
+
+      bench_kernel(bench, &kernels[k], fds, first);
+      first = false;
+      fflush(stdout);
+    }
+
+    bench_clear(bench);
+  }
+  printf("\n]}\n");
+
+  counters_close(fds);
+  free(bench);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,495 @@
+#include <bitboard.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the AVX2 path is built whatever the flags of the compiler, and taken when
+   the processor has it */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITBOARD_AVX2
+#include <immintrin.h>
+#endif
+
+/* units and peers of every cell for one grid size, as bitsets of words */
+typedef struct
+{
+  size_t size;
+  size_t words;
+  uint64_t *valid;
+  uint64_t *units;
+  uint64_t *peers;
+} tables_t;
+
+/* Interal structure (hiden from outside) to represent a bitboard. The
+   bitsets of the colors are stored one after the other after the set of the
+   cells whose single was already propagated and the set of the cells the
+   propagation changed. The colors of the cells as the bitboard last read or
+   wrote them are kept, so that it only exchanges the cells which differ
+   with the grid */
+struct bitboard_t
+{
+  size_t size;
+  size_t words;
+  bool avx2;
+  const tables_t *tables;
+  colors_t *cells;
+  uint64_t *placed;
+  uint64_t *changed;
+  uint64_t *digits;
+  uint64_t bits[];
+};
+
+/* tables are built the first time a size is used and kept afterwards */
+static tables_t *tables_cache[MAX_GRID_SQRT + 1];
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t bits_count(const uint64_t word)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(word);
+#else
+  return colors_count(word);
+#endif
+}
+
+static size_t bits_lowest(const uint64_t word)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(word);
+#else
+  return colors_index(word);
+#endif
+}
+
+static void bits_set(uint64_t *bits, const size_t bit)
+{
+  bits[bit / 64] = bits[bit / 64] | (1ULL << (bit % 64));
+}
+
+static void bits_clear(uint64_t *bits, const size_t bit)
+{
+  bits[bit / 64] = bits[bit / 64] & ~(1ULL << (bit % 64));
+}
+
+static bool bits_test(const uint64_t *bits, const size_t bit)
+{
+  return (bits[bit / 64] >> (bit % 64)) & 1;
+}
+
+/* remove the cells of mask from the given bitset of a color, and add the
+   ones it held to changed */
+static void bits_remove(uint64_t *digit, const uint64_t *mask,
+                        uint64_t *changed, const size_t words)
+{
+  for (size_t i = 0; i < words; i = i + 1)
+  {
+    changed[i] = changed[i] | (digit[i] & mask[i]);
+    digit[i] = digit[i] & ~mask[i];
+  }
+}
+
+#ifdef BITBOARD_AVX2
+/* same as bits_remove, four words at a time */
+__attribute__((target("avx2")))
+static void bits_remove_avx2(uint64_t *digit, const uint64_t *mask,
+                             uint64_t *changed, const size_t words)
+{
+  size_t i = 0;
+  __m256i x;
+  __m256i y;
+  __m256i z;
+
+  for (; i + 4 <= words; i = i + 4)
+  {
+    x = _mm256_loadu_si256((const __m256i *) (digit + i));
+    y = _mm256_loadu_si256((const __m256i *) (mask + i));
+    z = _mm256_loadu_si256((const __m256i *) (changed + i));
+    _mm256_storeu_si256((__m256i *) (changed + i),
+                        _mm256_or_si256(z, _mm256_and_si256(x, y)));
+    _mm256_storeu_si256((__m256i *) (digit + i), _mm256_andnot_si256(y, x));
+  }
+
+  bits_remove(digit + i, mask + i, changed + i, words - i);
+}
+#endif
+
+/* return the number of bits of bits1 & bits2, counting stops past limit,
+   and set where to one of these bits */
+static size_t bits_and_count(const uint64_t *bits1, const uint64_t *bits2,
+                             const size_t words, const size_t limit,
+                             size_t *where)
+{
+  size_t count = 0;
+  uint64_t word = 0;
+
+  for (size_t i = 0; i < words && count <= limit; i = i + 1)
+  {
+    word = bits1[i] & bits2[i];
+    if (word)
+    {
+      count = count + bits_count(word);
+      *where = i * 64 + bits_lowest(word);
+    }
+  }
+
+  return count;
+}
+
+static tables_t *tables_build(const size_t sqrt)
+{
+  size_t size = sqrt * sqrt;
+  size_t words = (size * size + 63) / 64;
+  size_t cell = 0;
+  size_t unit[NB_SUBGRID_TYPE];
+  tables_t *tables = calloc(1, sizeof(tables_t));
+  if (!tables)
+    return NULL;
+
+  tables->size = size;
+  tables->words = words;
+  tables->valid = calloc(words, sizeof(uint64_t));
+  tables->units = calloc(NB_SUBGRID_TYPE * size * words, sizeof(uint64_t));
+  tables->peers = calloc(size * size * words, sizeof(uint64_t));
+  if (!tables->valid || !tables->units || !tables->peers)
+  {
+    free(tables->valid);
+    free(tables->units);
+    free(tables->peers);
+    free(tables);
+
+    return NULL;
+  }
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      cell = i * size + j;
+      bits_set(tables->valid, cell);
+      unit[COL] = COL * size + j;
+      unit[ROW] = ROW * size + i;
+      unit[BLOCK] = BLOCK * size + (i - i % sqrt) + j / sqrt;
+
+      for (size_t k = 0; k < NB_SUBGRID_TYPE; k = k + 1)
+        bits_set(tables->units + unit[k] * words, cell);
+    }
+
+/* the peers of a cell are the cells sharing one of its units */
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      cell = i * size + j;
+      unit[COL] = COL * size + j;
+      unit[ROW] = ROW * size + i;
+      unit[BLOCK] = BLOCK * size + (i - i % sqrt) + j / sqrt;
+
+      for (size_t k = 0; k < NB_SUBGRID_TYPE; k = k + 1)
+        for (size_t w = 0; w < words; w = w + 1)
+          tables->peers[cell * words + w] = tables->peers[cell * words + w] |
+                                            tables->units[unit[k] * words + w];
+
+      bits_clear(tables->peers + cell * words, cell);
+    }
+
+  return tables;
+}
+
+static const tables_t *tables_get(const size_t size)
+{
+  size_t sqrt = 1;
+  tables_t *tables = NULL;
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  if (sqrt > MAX_GRID_SQRT)
+    return NULL;
+
+  pthread_mutex_lock(&tables_lock);
+  if (!tables_cache[sqrt])
+    tables_cache[sqrt] = tables_build(sqrt);
+
+  tables = tables_cache[sqrt];
+  pthread_mutex_unlock(&tables_lock);
+
+  return tables;
+}
+
+bitboard_t *bitboard_new(const size_t size)
+{
+  const tables_t *tables = NULL;
+  bitboard_t *board = NULL;
+  size_t words = 0;
+
+  if (!grid_check_size(size))
+    return NULL;
+
+  tables = tables_get(size);
+  if (!tables)
+    return NULL;
+
+  words = tables->words;
+  board = calloc(1, sizeof(bitboard_t) + (size + 2) * words * sizeof(uint64_t));
+  if (!board)
+    return NULL;
+
+  board->cells = calloc(size * size, sizeof(colors_t));
+  if (!board->cells)
+  {
+    free(board);
+
+    return NULL;
+  }
+
+  board->size = size;
+  board->words = words;
+  board->tables = tables;
+  board->placed = board->bits;
+  board->changed = board->bits + words;
+  board->digits = board->bits + 2 * words;
+#ifdef BITBOARD_AVX2
+  board->avx2 = words >= 4 && __builtin_cpu_supports("avx2");
+#endif
+
+  return board;
+}
+
+void bitboard_free(bitboard_t *board)
+{
+  if (!board)
+    return;
+
+  free(board->cells);
+  free(board);
+}
+
+size_t bitboard_get_size(const bitboard_t *board)
+{
+  if (!board)
+    return 0;
+
+  return board->size;
+}
+
+bool bitboard_from_grid(bitboard_t *board, const grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  colors_t colors = colors_empty();
+  colors_t stale = colors_empty();
+  colors_t color = colors_empty();
+  size_t d = 0;
+
+  if (!board || !size || size != board->size)
+    return false;
+
+  memset(board->placed, 0, board->words * sizeof(uint64_t));
+
+  for (size_t cell = 0; cell < size * size; cell = cell + 1)
+  {
+    colors = grid_get_colors(grid, cell / size, cell % size);
+
+/* a cell the last propagation changed without writing it back is read
+   whole, the others by the colors which differ */
+    if (bits_test(board->changed, cell))
+    {
+      for (d = 0; d < size; d = d + 1)
+        bits_clear(board->digits + d * board->words, cell);
+
+      stale = colors;
+    }
+    else
+      stale = colors_xor(colors, board->cells[cell]);
+
+    for (; stale; stale = colors_xor(stale, color))
+    {
+      color = colors_rightmost(stale);
+      d = colors_index(color);
+      if (colors_is_in(colors, d))
+        bits_set(board->digits + d * board->words, cell);
+      else
+        bits_clear(board->digits + d * board->words, cell);
+    }
+
+    board->cells[cell] = colors;
+  }
+
+  memset(board->changed, 0, board->words * sizeof(uint64_t));
+
+  return true;
+}
+
+void bitboard_to_grid(bitboard_t *board, grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  size_t cell = 0;
+  colors_t colors = colors_empty();
+  uint64_t word = 0;
+
+  if (!board || !size || size != board->size)
+    return;
+
+  for (size_t w = 0; w < board->words; w = w + 1)
+    for (word = board->changed[w]; word; word = word & (word - 1))
+    {
+      cell = w * 64 + bits_lowest(word);
+      colors = colors_empty();
+      for (size_t d = 0; d < size; d = d + 1)
+        if (bits_test(board->digits + d * board->words, cell))
+          colors = colors_add(colors, d);
+
+      board->cells[cell] = colors;
+      grid_set_colors(grid, cell / size, cell % size, colors);
+    }
+
+  memset(board->changed, 0, board->words * sizeof(uint64_t));
+}
+
+/* compute the cells with exactly one color in singles. return false if a
+   cell has no color at all */
+static bool bitboard_singles(const bitboard_t *board, uint64_t *singles)
+{
+  uint64_t ones = 0;
+  uint64_t twos = 0;
+  uint64_t word = 0;
+
+  for (size_t w = 0; w < board->words; w = w + 1)
+  {
+    ones = 0;
+    twos = 0;
+    for (size_t d = 0; d < board->size; d = d + 1)
+    {
+      word = board->digits[d * board->words + w];
+      twos = twos | (ones & word);
+      ones = ones | word;
+    }
+
+    if (board->tables->valid[w] & ~ones)
+      return false;
+
+    singles[w] = ones & ~twos;
+  }
+
+  return true;
+}
+
+bool bitboard_is_consistent(const bitboard_t *board)
+{
+  uint64_t singles[(MAX_GRID_SIZE * MAX_GRID_SIZE + 63) / 64];
+  uint64_t placed[(MAX_GRID_SIZE * MAX_GRID_SIZE + 63) / 64];
+  const uint64_t *unit = NULL;
+  const uint64_t *digit = NULL;
+  size_t where = 0;
+
+  if (!board || !bitboard_singles(board, singles))
+    return false;
+
+  for (size_t d = 0; d < board->size; d = d + 1)
+  {
+    digit = board->digits + d * board->words;
+    for (size_t w = 0; w < board->words; w = w + 1)
+      placed[w] = singles[w] & digit[w];
+
+    for (size_t u = 0; u < NB_SUBGRID_TYPE * board->size; u = u + 1)
+    {
+      unit = board->tables->units + u * board->words;
+      if (!bits_and_count(digit, unit, board->words, 0, &where) ||
+          bits_and_count(placed, unit, board->words, 1, &where) > 1)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+size_t bitboard_propagate(bitboard_t *board)
+{
+  uint64_t singles[(MAX_GRID_SIZE * MAX_GRID_SIZE + 63) / 64];
+  size_t words = 0;
+  size_t size = 0;
+  size_t cell = 0;
+  size_t count = 0;
+  uint64_t *digit = NULL;
+  uint64_t word = 0;
+  bool alteration = true;
+  bool solved = false;
+
+  if (!board)
+    return 2;
+
+  words = board->words;
+  size = board->size;
+
+  while (alteration)
+  {
+    alteration = false;
+
+/* singles: a lone color is removed from the peers of its cell */
+    if (!bitboard_singles(board, singles))
+      return 2;
+
+    for (size_t d = 0; d < size; d = d + 1)
+    {
+      digit = board->digits + d * words;
+      for (size_t w = 0; w < words; w = w + 1)
+      {
+        word = singles[w] & digit[w] & ~board->placed[w];
+        while (word)
+        {
+          cell = w * 64 + bits_lowest(word);
+          word = word & (word - 1);
+#ifdef BITBOARD_AVX2
+          if (board->avx2)
+            bits_remove_avx2(digit, board->tables->peers + cell * words,
+                             board->changed, words);
+          else
+#endif
+            bits_remove(digit, board->tables->peers + cell * words,
+                        board->changed, words);
+          bits_set(board->placed, cell);
+          alteration = true;
+        }
+      }
+    }
+
+    if (alteration)
+      continue;
+
+/* hidden singles: a color with one place left in a unit takes it */
+    for (size_t d = 0; d < size; d = d + 1)
+    {
+      digit = board->digits + d * words;
+      for (size_t u = 0; u < NB_SUBGRID_TYPE * size; u = u + 1)
+      {
+        count = bits_and_count(digit, board->tables->units + u * words, words,
+                               1, &cell);
+        if (!count)
+          return 2;
+
+        if (count > 1 || bits_test(singles, cell))
+          continue;
+
+        for (size_t e = 0; e < size; e = e + 1)
+          if (e != d)
+            bits_clear(board->digits + e * words, cell);
+
+        bits_set(board->changed, cell);
+        bits_set(singles, cell);
+        alteration = true;
+      }
+    }
+  }
+
+  solved = true;
+  for (size_t w = 0; w < words && solved; w = w + 1)
+    solved = singles[w] == board->tables->valid[w];
+
+  if (!bitboard_is_consistent(board))
+    return 2;
+
+  return solved ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Digit-major view of a grid (forward declaration to hide the
+   implementation): for each color, the set of the cells where it is still
+   possible, as a bitset over all the cells (128 bits for a 9x9 grid, 256 bits
+   for a 16x16 grid). The units and the peers of every cell are precomputed
+   bitsets too, so that singles, hidden singles and consistency checks are
+   made of wide and/or/andnot/popcount operations */
+typedef struct bitboard_t bitboard_t;
+
+/* memory allocation for a bitboard of a given size */
+bitboard_t *bitboard_new(const size_t size);
+
+/* free the allocated memory of given bitboard */
+void bitboard_free(bitboard_t *board);
+
+/* return the size of a given bitboard */
+size_t bitboard_get_size(const bitboard_t *board);
+
+/* fill the given bitboard from the given grid of the same size, only
+   reading again the cells which differ from the last grid it was filled
+   from or written into. return false if the sizes differ */
+bool bitboard_from_grid(bitboard_t *board, const grid_t *grid);
+
+/* write the cells the propagation changed in the given bitboard into the
+   given grid, the one it was last filled from */
+void bitboard_to_grid(bitboard_t *board, grid_t *grid);
+
+/* check if no cell is empty and no color is missing from a unit */
+bool bitboard_is_consistent(const bitboard_t *board);
+
+/* apply singles and hidden singles until nothing changes, and return a
+   number corresponding to the state of the bitboard afterward, as
+   grid_heuristics does:
+   - '0' if the grid is not solved
+   - '1' if the grid is solved
+   - '2' if the grid is inconsistent */
+size_t bitboard_propagate(bitboard_t *board);
+
+#endif /* BITBOARD_H */
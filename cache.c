@@ -0,0 +1,313 @@
+#include <cache.h>
+#include <canon.h>
+#include <colors.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct entry_t
+{
+  uint64_t hash;
+  size_t size;
+  uint8_t *cells;
+/* solution in the canonical space, NULL if the grid has no solution */
+  uint8_t *solution;
+  struct entry_t *chain;
+  struct entry_t *newer;
+  struct entry_t *older;
+} entry_t;
+
+/* Interal structure (hiden from outside) to represent a cache */
+struct cache_t
+{
+  pthread_mutex_t lock;
+  size_t capacity;
+  size_t nb_entries;
+  size_t nb_buckets;
+  entry_t **buckets;
+  entry_t *newest;
+  entry_t *oldest;
+  size_t hits;
+};
+
+cache_t *cache_new(const size_t capacity)
+{
+  cache_t *cache = NULL;
+
+  if (!capacity)
+    return NULL;
+
+  cache = calloc(1, sizeof(cache_t));
+  if (!cache)
+    return NULL;
+
+  cache->capacity = capacity;
+  cache->nb_buckets = 1;
+  while (cache->nb_buckets < 2 * capacity)
+    cache->nb_buckets = cache->nb_buckets * 2;
+
+  cache->buckets = calloc(cache->nb_buckets, sizeof(entry_t *));
+  if (!cache->buckets)
+  {
+    free(cache);
+
+    return NULL;
+  }
+
+  pthread_mutex_init(&cache->lock, NULL);
+
+  return cache;
+}
+
+static void entry_free(entry_t *entry)
+{
+  free(entry->cells);
+  free(entry->solution);
+  free(entry);
+}
+
+void cache_free(cache_t *cache)
+{
+  entry_t *entry = NULL;
+
+  if (!cache)
+    return;
+
+  while (cache->newest)
+  {
+    entry = cache->newest;
+    cache->newest = entry->older;
+    entry_free(entry);
+  }
+
+  pthread_mutex_destroy(&cache->lock);
+  free(cache->buckets);
+  free(cache);
+}
+
+/* unlink the given entry from the recency list */
+static void cache_unlink(cache_t *cache, entry_t *entry)
+{
+  if (entry->newer)
+    entry->newer->older = entry->older;
+  else
+    cache->newest = entry->older;
+
+  if (entry->older)
+    entry->older->newer = entry->newer;
+  else
+    cache->oldest = entry->newer;
+
+  entry->newer = NULL;
+  entry->older = NULL;
+}
+
+/* link the given entry as the most recently used one */
+static void cache_push(cache_t *cache, entry_t *entry)
+{
+  entry->older = cache->newest;
+  entry->newer = NULL;
+  if (cache->newest)
+    cache->newest->newer = entry;
+  else
+    cache->oldest = entry;
+
+  cache->newest = entry;
+}
+
+static entry_t **cache_find(cache_t *cache, const canon_t *canon)
+{
+  entry_t **where = &cache->buckets[canon->hash & (cache->nb_buckets - 1)];
+
+  while (*where && ((*where)->hash != canon->hash ||
+                    (*where)->size != canon->size ||
+                    memcmp((*where)->cells, canon->cells,
+                           canon->size * canon->size)))
+    where = &(*where)->chain;
+
+  return where;
+}
+
+/* drop the least recently used entry */
+static void cache_evict(cache_t *cache)
+{
+  entry_t *entry = cache->oldest;
+  entry_t **where = NULL;
+
+  if (!entry)
+    return;
+
+  where = &cache->buckets[entry->hash & (cache->nb_buckets - 1)];
+  while (*where != entry)
+    where = &(*where)->chain;
+
+  *where = entry->chain;
+  cache_unlink(cache, entry);
+  entry_free(entry);
+  cache->nb_entries = cache->nb_entries - 1;
+}
+
+bool cache_lookup(cache_t *cache, const canon_t *canon, grid_t **solution)
+{
+  entry_t *entry = NULL;
+  grid_t *image = NULL;
+  size_t size = 0;
+
+  if (!cache || !canon || !solution)
+    return false;
+
+  size = canon->size;
+  *solution = NULL;
+
+  pthread_mutex_lock(&cache->lock);
+  entry = *cache_find(cache, canon);
+  if (!entry)
+  {
+    pthread_mutex_unlock(&cache->lock);
+
+    return false;
+  }
+
+  cache_unlink(cache, entry);
+  cache_push(cache, entry);
+  cache->hits = cache->hits + 1;
+
+  if (entry->solution)
+  {
+    image = grid_alloc(size);
+    for (size_t i = 0; image && i < size * size; i = i + 1)
+      grid_set_colors(image, i / size, i % size,
+                      colors_set(entry->solution[i] - 1));
+  }
+  pthread_mutex_unlock(&cache->lock);
+
+  if (image)
+  {
+    *solution = canon_revert(canon, image);
+    grid_free(image);
+  }
+
+  return true;
+}
+
+void cache_insert(cache_t *cache, const canon_t *canon,
+                  const grid_t *solution)
+{
+  entry_t *entry = NULL;
+  entry_t **where = NULL;
+  grid_t *image = NULL;
+  size_t nb_cells = 0;
+
+  if (!cache || !canon)
+    return;
+
+  nb_cells = canon->size * canon->size;
+  entry = calloc(1, sizeof(entry_t));
+  if (!entry)
+    return;
+
+  entry->hash = canon->hash;
+  entry->size = canon->size;
+  entry->cells = malloc(nb_cells);
+  if (!entry->cells)
+    goto insert_pb;
+
+  memcpy(entry->cells, canon->cells, nb_cells);
+
+  if (solution)
+  {
+    image = canon_apply(canon, solution);
+    entry->solution = malloc(nb_cells);
+    if (!image || !entry->solution)
+      goto insert_pb;
+
+    for (size_t i = 0; i < nb_cells; i = i + 1)
+      entry->solution[i] = colors_index(grid_get_colors(image,
+                                                        i / canon->size,
+                                                        i % canon->size)) + 1;
+    grid_free(image);
+    image = NULL;
+  }
+
+  pthread_mutex_lock(&cache->lock);
+  where = cache_find(cache, canon);
+  if (*where)
+  {
+    pthread_mutex_unlock(&cache->lock);
+    goto insert_pb;
+  }
+
+  if (cache->nb_entries == cache->capacity)
+  {
+    cache_evict(cache);
+    where = cache_find(cache, canon);
+  }
+
+  *where = entry;
+  cache_push(cache, entry);
+  cache->nb_entries = cache->nb_entries + 1;
+  pthread_mutex_unlock(&cache->lock);
+
+  return;
+
+  insert_pb:
+  {
+    grid_free(image);
+    entry_free(entry);
+  }
+}
+
+solver_outcome_t cache_solve(cache_t *cache, solver_t *solver,
+                             const grid_t *grid, grid_t **solution)
+{
+  canon_t identity;
+  canon_t canon;
+  solver_outcome_t outcome = outcome_unsolvable;
+  bool known = false;
+  bool canonical = false;
+
+  if (!solution)
+    return outcome_unsolvable;
+
+/* the grid is looked for as is first, which costs far less than its
+   canonical form: both keys hold a solution of the grid of their cells, so
+   they share the cache */
+  *solution = NULL;
+  known = cache && grid_identity(grid, &identity);
+  if (known && cache_lookup(cache, &identity, solution))
+    return *solution ? outcome_solved : outcome_unsolvable;
+
+  canonical = known && grid_canonical(grid, &canon);
+  if (canonical && cache_lookup(cache, &canon, solution))
+  {
+    cache_insert(cache, &identity, *solution);
+
+    return *solution ? outcome_solved : outcome_unsolvable;
+  }
+
+  solver_set_mode(solver, mode_first);
+  outcome = solver_run(solver, grid);
+  *solution = solver_take_solution(solver);
+
+  if (known && outcome != outcome_budget)
+    cache_insert(cache, &identity, *solution);
+
+  if (canonical && outcome != outcome_budget)
+    cache_insert(cache, &canon, *solution);
+
+  return outcome;
+}
+
+size_t cache_get_hits(const cache_t *cache)
+{
+  if (!cache)
+    return 0;
+
+  return cache->hits;
+}
@@ -0,0 +1,46 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <canon.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Least recently used cache of solutions, keyed by the canonical form of the
+   grids so that relabeled, transposed or permuted grids share their entry,
+   and by the grids as given, found without computing their canonical form.
+   A cache can be shared between threads (forward declaration to hide the
+   implementation) */
+typedef struct cache_t cache_t;
+
+/* memory allocation for a cache holding at most the given number of
+   entries, a grid taking two of them (as given and canonical) */
+cache_t *cache_new(const size_t capacity);
+
+/* free the allocated memory of the given cache */
+void cache_free(cache_t *cache);
+
+/* look for the grid whose canonical form (or identity, see grid_identity)
+   is given. If found, return true and set solution to a new grid holding
+   its solution mapped back through the inverse transformation, or to NULL
+   if the grid has no solution */
+bool cache_lookup(cache_t *cache, const canon_t *canon, grid_t **solution);
+
+/* remember the solution (NULL if none) of the grid whose canonical form (or
+   identity) is given */
+void cache_insert(cache_t *cache, const canon_t *canon,
+                  const grid_t *solution);
+
+/* search the first solution of the given grid with the given solver, unless
+   the cache already knows it, as given or else in canonical form. return
+   the outcome, and set solution to a new grid holding the solution or to
+   NULL */
+solver_outcome_t cache_solve(cache_t *cache, solver_t *solver,
+                             const grid_t *grid, grid_t **solution);
+
+/* return the number of lookups which found their grid in the given cache */
+size_t cache_get_hits(const cache_t *cache);
+
+#endif /* CACHE_H */
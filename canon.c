@@ -0,0 +1,561 @@
+#include <canon.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* maximum number of rows tried by a canonicalization before it settles for
+   the best grid found so far. It is exhaustive on grids up to
+   CANON_EXHAUSTIVE_SIZE; on larger ones, whose forms are out of reach
+   anyway, the search is cut short so that it costs far less than a solve
+   (a few hundred microseconds rather than tens of milliseconds), and only
+   keeps a deterministic image of the grid */
+#define CANON_BUDGET (1 << 20)
+#define CANON_LARGE_BUDGET (1 << 12)
+#define CANON_EXHAUSTIVE_SIZE 9
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+/* a transformation giving the canonical grid, as in canon_t */
+typedef struct
+{
+  bool transpose;
+  uint8_t rows[MAX_GRID_SIZE];
+  uint8_t columns[MAX_GRID_SIZE];
+  uint8_t colors[MAX_GRID_SIZE];
+} transform_t;
+
+/* state of the branch and bound search of the canonical form */
+typedef struct
+{
+  size_t size;
+  size_t sqrt;
+  uint8_t values[MAX_GRID_SIZE * MAX_GRID_SIZE];
+
+  bool transpose;
+  uint8_t columns[MAX_GRID_SIZE];
+  bool used_column[MAX_GRID_SIZE];
+  bool used_stack[MAX_GRID_SIZE];
+  uint8_t rows[MAX_GRID_SIZE];
+  bool used_row[MAX_GRID_SIZE];
+  bool used_band[MAX_GRID_SIZE];
+
+/* current relabeling: value -> label and label -> value, '0' for none */
+  uint8_t label[MAX_GRID_SIZE + 1];
+  uint8_t value[MAX_GRID_SIZE + 1];
+  size_t nb_labels;
+
+  size_t best_rows;
+  size_t steps;
+  size_t budget;
+  bool recorded;
+  bool stop;
+  canon_t *canon;
+
+/* transformations giving the best grid, kept when found is given (at most
+   max_found of them, overflow is set beyond) */
+  transform_t *found;
+  size_t max_found;
+  bool overflow;
+} canon_search_t;
+
+/* value of the cell at given coordinate, seen through the transposition */
+static uint8_t search_value(const canon_search_t *search, const size_t row,
+                            const size_t column)
+{
+  if (search->transpose)
+    return search->values[column * search->size + row];
+
+  return search->values[row * search->size + column];
+}
+
+/* remember the current transformation, which gives the best grid */
+static void search_record(canon_search_t *search)
+{
+  canon_t *canon = search->canon;
+  size_t next = search->nb_labels;
+
+  canon->transpose = search->transpose;
+  memcpy(canon->rows, search->rows, search->size);
+  memcpy(canon->columns, search->columns, search->size);
+
+/* colors absent from the grid take the remaining labels in order */
+  for (size_t i = 1; i <= search->size; i = i + 1)
+    if (search->label[i])
+      canon->colors[i - 1] = search->label[i] - 1;
+    else
+    {
+      canon->colors[i - 1] = next;
+      next = next + 1;
+    }
+
+  if (search->found && canon->automorphisms < search->max_found)
+  {
+    search->found[canon->automorphisms].transpose = canon->transpose;
+    memcpy(search->found[canon->automorphisms].rows, canon->rows,
+           search->size);
+    memcpy(search->found[canon->automorphisms].columns, canon->columns,
+           search->size);
+    memcpy(search->found[canon->automorphisms].colors, canon->colors,
+           search->size);
+  }
+  else if (search->found)
+    search->overflow = true;
+
+  canon->automorphisms = canon->automorphisms + 1;
+  search->recorded = true;
+}
+
+static void search_rows(canon_search_t *search, const size_t where)
+{
+  size_t size = search->size;
+  size_t sqrt = search->sqrt;
+  size_t first = 0;
+  size_t last = size;
+  size_t nb_labels = 0;
+  uint8_t image[MAX_GRID_SIZE];
+  uint8_t *best = search->canon->cells + where * size;
+  uint8_t v = 0;
+  int cmp = 0;
+
+  if (where == size)
+  {
+    search_record(search);
+
+    return;
+  }
+
+/* inside a band, the rows are taken from the band of the previous row */
+  if (where % sqrt)
+  {
+    first = search->rows[where - 1] - search->rows[where - 1] % sqrt;
+    last = first + sqrt;
+  }
+
+  for (size_t r = first; r < last; r = r + 1)
+  {
+    if (search->used_row[r] || (!(where % sqrt) && search->used_band[r / sqrt]))
+      continue;
+
+    search->steps = search->steps + 1;
+    if (search->recorded && search->steps > search->budget)
+      search->stop = true;
+
+/* the image is compared with the best row as it is made, and given up as
+   soon as it is larger */
+    nb_labels = search->nb_labels;
+    cmp = where < search->best_rows ? 0 : -1;
+    for (size_t j = 0; j < size && cmp <= 0; j = j + 1)
+    {
+      v = search_value(search, r, search->columns[j]);
+      if (v && !search->label[v])
+      {
+        search->nb_labels = search->nb_labels + 1;
+        search->label[v] = search->nb_labels;
+        search->value[search->nb_labels] = v;
+      }
+
+      image[j] = v ? search->label[v] : 0;
+      if (!cmp && image[j] != best[j])
+        cmp = image[j] < best[j] ? -1 : 1;
+    }
+
+    if (cmp < 0)
+    {
+      memcpy(best, image, size);
+      search->best_rows = where + 1;
+      search->canon->automorphisms = 0;
+      search->overflow = false;
+    }
+
+    if (cmp <= 0)
+    {
+      search->rows[where] = r;
+      search->used_row[r] = true;
+      search->used_band[r / sqrt] = true;
+      search_rows(search, where + 1);
+      search->used_row[r] = false;
+      if (!(where % sqrt))
+        search->used_band[r / sqrt] = false;
+    }
+
+    while (search->nb_labels > nb_labels)
+    {
+      search->label[search->value[search->nb_labels]] = 0;
+      search->nb_labels = search->nb_labels - 1;
+    }
+
+/* a path which improved the best grid is always completed */
+    if (search->stop && cmp <= 0)
+      break;
+  }
+}
+
+/* check if a row may still give, through the columns chosen up to the
+   given one, a first row no larger than the one of the best grid. Its
+   colors being labeled in order, a first row only depends on which of its
+   cells are empty */
+static bool search_promising(const canon_search_t *search, const size_t where)
+{
+  const uint8_t *best = search->canon->cells;
+  size_t j = 0;
+  bool empty = false;
+
+  if (!search->best_rows)
+    return true;
+
+  for (size_t r = 0; r < search->size; r = r + 1)
+  {
+    for (j = 0; j <= where; j = j + 1)
+    {
+      empty = !search_value(search, r, search->columns[j]);
+      if (empty != !best[j])
+        break;
+    }
+
+    if (j > where || empty)
+      return true;
+  }
+
+  return false;
+}
+
+static void search_columns(canon_search_t *search, const size_t where)
+{
+  size_t size = search->size;
+  size_t sqrt = search->sqrt;
+  size_t first = 0;
+  size_t last = size;
+
+  if (where == size)
+  {
+    search_rows(search, 0);
+
+    return;
+  }
+
+  if (where % sqrt)
+  {
+    first = search->columns[where - 1] - search->columns[where - 1] % sqrt;
+    last = first + sqrt;
+  }
+
+  for (size_t c = first; c < last && !search->stop; c = c + 1)
+  {
+    if (search->used_column[c] ||
+        (!(where % sqrt) && search->used_stack[c / sqrt]))
+      continue;
+
+    search->columns[where] = c;
+    if (!search_promising(search, where))
+      continue;
+
+    search->used_column[c] = true;
+    search->used_stack[c / sqrt] = true;
+    search_columns(search, where + 1);
+    search->used_column[c] = false;
+    if (!(where % sqrt))
+      search->used_stack[c / sqrt] = false;
+  }
+}
+
+/* hash the cells of the given canonical grid */
+static void canon_hash(canon_t *canon)
+{
+  uint64_t hash = FNV_OFFSET;
+
+  for (size_t i = 0; i < canon->size * canon->size; i = i + 1)
+    hash = (hash ^ canon->cells[i]) * FNV_PRIME;
+
+  canon->hash = (hash ^ canon->size) * FNV_PRIME;
+}
+
+/* search the canonical form of the given grid in canon, keeping the
+   transformations giving it in found if given */
+static bool canon_search(const grid_t *grid, canon_t *canon,
+                         transform_t *found, const size_t max_found)
+{
+  canon_search_t search;
+  size_t size = grid_get_size(grid);
+  colors_t colors = colors_empty();
+
+  if (!size || !canon)
+    return false;
+
+  memset(&search, 0, sizeof(canon_search_t));
+  search.size = size;
+  search.budget = size > CANON_EXHAUSTIVE_SIZE ? CANON_LARGE_BUDGET :
+                                                 CANON_BUDGET;
+  search.found = found;
+  search.max_found = max_found;
+  while (search.sqrt * search.sqrt < size)
+    search.sqrt = search.sqrt + 1;
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      colors = grid_get_colors(grid, i, j);
+      if (colors_is_singleton(colors))
+        search.values[i * size + j] = colors_index(colors) + 1;
+    }
+
+  memset(canon, 0, sizeof(canon_t));
+  canon->size = size;
+  search.canon = canon;
+
+  for (size_t t = 0; t < 2 && !search.stop; t = t + 1)
+  {
+    search.transpose = t;
+    search_columns(&search, 0);
+  }
+
+/* a search cut short may have missed transformations */
+  canon->exhaustive = !search.stop;
+  if (!canon->exhaustive || search.overflow)
+    canon->automorphisms = 0;
+
+  canon_hash(canon);
+
+  return true;
+}
+
+bool grid_canonical(const grid_t *grid, canon_t *canon)
+{
+  return canon_search(grid, canon, NULL, 0);
+}
+
+/* set destination to the index of the cell where each cell of a grid of
+   the given size goes through the given transformation */
+static void transform_cells(const transform_t *transform, const size_t size,
+                            size_t *destination)
+{
+  size_t row_of[MAX_GRID_SIZE];
+  size_t column_of[MAX_GRID_SIZE];
+  size_t i = 0;
+  size_t j = 0;
+
+  for (size_t k = 0; k < size; k = k + 1)
+  {
+    row_of[transform->rows[k]] = k;
+    column_of[transform->columns[k]] = k;
+  }
+
+  for (size_t r = 0; r < size; r = r + 1)
+    for (size_t c = 0; c < size; c = c + 1)
+    {
+      i = transform->transpose ? row_of[c] : row_of[r];
+      j = transform->transpose ? column_of[r] : column_of[c];
+      destination[r * size + c] = i * size + j;
+    }
+}
+
+size_t grid_automorphisms(const grid_t *grid, const size_t max,
+                          uint16_t **cells, uint8_t **colors)
+{
+  canon_t canon;
+  transform_t *found = NULL;
+  size_t *first = NULL;
+  size_t *other = NULL;
+  size_t *source = NULL;
+  uint8_t label_of[MAX_GRID_SIZE];
+  size_t size = grid_get_size(grid);
+  size_t nb_cells = size * size;
+  size_t count = 0;
+
+  if (!size || !max || !cells || !colors)
+    return 0;
+
+  *cells = NULL;
+  *colors = NULL;
+  found = malloc(max * sizeof(transform_t));
+  first = malloc(3 * nb_cells * sizeof(size_t));
+  if (!found || !first || !canon_search(grid, &canon, found, max) ||
+      !canon.automorphisms)
+    goto automorphisms_end;
+
+  *cells = malloc(canon.automorphisms * nb_cells * sizeof(uint16_t));
+  *colors = malloc(canon.automorphisms * size * sizeof(uint8_t));
+  if (!*cells || !*colors)
+  {
+    free(*cells);
+    free(*colors);
+    *cells = NULL;
+    *colors = NULL;
+    goto automorphisms_end;
+  }
+
+/* the automorphisms are the first transformation followed by the inverse of
+   each one, the first giving the identity */
+  other = first + nb_cells;
+  source = other + nb_cells;
+  transform_cells(&found[0], size, first);
+  for (count = 0; count < canon.automorphisms; count = count + 1)
+  {
+    transform_cells(&found[count], size, other);
+    for (size_t k = 0; k < nb_cells; k = k + 1)
+      source[other[k]] = k;
+
+    for (size_t k = 0; k < size; k = k + 1)
+      label_of[found[count].colors[k]] = k;
+
+    for (size_t k = 0; k < nb_cells; k = k + 1)
+      (*cells)[count * nb_cells + k] = source[first[k]];
+
+    for (size_t k = 0; k < size; k = k + 1)
+      (*colors)[count * size + k] = label_of[found[0].colors[k]];
+  }
+
+  automorphisms_end:
+  {
+    free(found);
+    free(first);
+  }
+
+  return count;
+}
+
+bool grid_identity(const grid_t *grid, canon_t *canon)
+{
+  size_t size = grid_get_size(grid);
+  colors_t colors = colors_empty();
+
+  if (!size || !canon)
+    return false;
+
+  canon->size = size;
+  canon->transpose = false;
+  canon->automorphisms = 1;
+  canon->exhaustive = false;
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    canon->rows[i] = i;
+    canon->columns[i] = i;
+    canon->colors[i] = i;
+  }
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      colors = grid_get_colors(grid, i, j);
+      canon->cells[i * size + j] = colors_is_singleton(colors) ?
+                                   colors_index(colors) + 1 : 0;
+    }
+
+  canon_hash(canon);
+
+  return true;
+}
+
+/* transform the given grid, forward or backward */
+static grid_t *canon_map(const canon_t *canon, const grid_t *grid,
+                         const bool forward)
+{
+  size_t size = grid_get_size(grid);
+  grid_t *image = NULL;
+  colors_t colors = colors_empty();
+  colors_t mapped = colors_empty();
+  size_t row = 0;
+  size_t column = 0;
+
+  if (!canon || size != canon->size)
+    return NULL;
+
+  image = grid_alloc(size);
+  if (!image)
+    return NULL;
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      row = canon->transpose ? canon->columns[j] : canon->rows[i];
+      column = canon->transpose ? canon->rows[i] : canon->columns[j];
+
+      colors = forward ? grid_get_colors(grid, row, column) :
+                         grid_get_colors(grid, i, j);
+      mapped = colors_empty();
+      for (size_t c = 0; c < size; c = c + 1)
+      {
+        if (forward && colors_is_in(colors, c))
+          mapped = colors_add(mapped, canon->colors[c]);
+
+        if (!forward && colors_is_in(colors, canon->colors[c]))
+          mapped = colors_add(mapped, c);
+      }
+
+      if (forward)
+        grid_set_colors(image, i, j, mapped);
+      else
+        grid_set_colors(image, row, column, mapped);
+    }
+
+  return image;
+}
+
+grid_t *canon_apply(const canon_t *canon, const grid_t *grid)
+{
+  return canon_map(canon, grid, true);
+}
+
+grid_t *canon_revert(const canon_t *canon, const grid_t *grid)
+{
+  return canon_map(canon, grid, false);
+}
+
+size_t canon_to_line(const canon_t *canon, char *buffer, const size_t length)
+{
+  size_t nb_cells = 0;
+
+  if (!canon || !buffer)
+    return 0;
+
+  nb_cells = canon->size * canon->size;
+  if (!nb_cells)
+    return 0;
+
+/* the larger grids are written as numbers, the way grid_to_line does */
+  if (canon->size > MAX_CHAR_SIZE)
+  {
+    size_t where = 0;
+    char name[4];
+    size_t name_length = 0;
+
+    for (size_t i = 0; i < nb_cells; i = i + 1)
+    {
+      name[0] = EMPTY_CELL;
+      name_length = 1;
+      if (canon->cells[i])
+        name_length = grid_color_name(canon->size, canon->cells[i] - 1, name);
+
+      if (where + name_length + (i > 0) >= length)
+        return 0;
+
+      if (i)
+      {
+        buffer[where] = ' ';
+        where = where + 1;
+      }
+
+      memcpy(buffer + where, name, name_length);
+      where = where + name_length;
+    }
+
+    buffer[where] = '\0';
+
+    return where;
+  }
+
+  if (length < nb_cells + 1)
+    return 0;
+
+  for (size_t i = 0; i < nb_cells; i = i + 1)
+    buffer[i] = canon->cells[i] ? color_table[canon->cells[i] - 1] : EMPTY_CELL;
+
+  buffer[nb_cells] = '\0';
+
+  return nb_cells;
+}
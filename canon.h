@@ -0,0 +1,69 @@
+#ifndef CANON_H
+#define CANON_H
+
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Transformation mapping a grid on its canonical form, i.e the smallest grid
+   (row by row, empty cells first) among the grids obtained by transposition,
+   permutations of the bands, of the stacks, of the rows within a band, of
+   the columns within a stack, and relabeling of the colors in order of first
+   appearance. Only singleton cells are taken into account */
+typedef struct
+{
+  size_t size;
+  bool transpose;
+  /* canonical row i is made of the cells of original row rows[i] (column
+     when transposed), and canonical column j of original column columns[j] */
+  uint8_t rows[MAX_GRID_SIZE];
+  uint8_t columns[MAX_GRID_SIZE];
+  /* original color index c is written as colors[c] in the canonical form */
+  uint8_t colors[MAX_GRID_SIZE];
+  /* canonical grid, row by row: '0' for an empty cell, color index + 1
+     otherwise */
+  uint8_t cells[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  uint64_t hash;
+  /* number of transformations giving the canonical grid, 0 when unknown
+     (search cut by its budget) */
+  size_t automorphisms;
+  /* false if the search was cut by its budget: the result is still a
+     deterministic image of the grid, but equivalent grids may get another
+     one */
+  bool exhaustive;
+} canon_t;
+
+/* compute the canonical form of the given grid in canon. return false if
+   the grid is not valid */
+bool grid_canonical(const grid_t *grid, canon_t *canon);
+
+/* set in cells and colors new arrays with the automorphisms of the given
+   grid: automorphism k moves cell i (row * size + column) to cell
+   cells[k * size * size + i] and relabels color c as colors[k * size + c],
+   colors absent from the grid being left as they are. The first one is the
+   identity. return their number, or 0 (and NULL arrays) if the grid is not
+   valid, if the search of the canonical form was cut by its budget, or if
+   there are more than max of them */
+size_t grid_automorphisms(const grid_t *grid, const size_t max,
+                          uint16_t **cells, uint8_t **colors);
+
+/* set in canon the transformation leaving the given grid as it is, hashed
+   the same way as a canonical form: a grid keyed by it is found again only
+   when it is given as is, but without any search. return false if the grid
+   is not valid */
+bool grid_identity(const grid_t *grid, canon_t *canon);
+
+/* return a new grid, image of the given grid by the transformation */
+grid_t *canon_apply(const canon_t *canon, const grid_t *grid);
+
+/* return a new grid, image of the given canonical grid by the inverse of the
+   transformation */
+grid_t *canon_revert(const canon_t *canon, const grid_t *grid);
+
+/* write the canonical grid of canon as a single line in the given buffer of
+   given length (see grid_to_line). return the number of char written */
+size_t canon_to_line(const canon_t *canon, char *buffer, const size_t length);
+
+#endif /* CANON_H */
@@ -0,0 +1,625 @@
+#include <chains.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a candidate: a color of a cell, reached after a number of strong links */
+typedef struct
+{
+  uint16_t cell;
+  uint8_t color;
+  uint8_t length;
+} node_t;
+
+/* state of the search of the chains of a grid: the colors of its cells,
+   and for each unit and color the places of the color in the unit (a
+   column of a row, a row of a column, a cell of a block from left to right
+   and top to bottom) */
+typedef struct
+{
+  grid_t *grid;
+  size_t size;
+  size_t sqrt;
+  size_t length;
+  colors_t cells[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  uint8_t units[NB_SUBGRID_TYPE][MAX_GRID_SIZE * MAX_GRID_SIZE];
+  uint8_t ranks[NB_SUBGRID_TYPE][MAX_GRID_SIZE * MAX_GRID_SIZE];
+  colors_t places[NB_SUBGRID_TYPE][MAX_GRID_SIZE][MAX_SIZE];
+
+/* the candidates proven true (on) and false (off) by a chain, the cells
+   where they were marked, and the candidates to follow */
+  colors_t on[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  colors_t off[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  uint16_t marks[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  size_t nb_marks;
+  node_t *queue;
+
+/* the parity of the cells in simple coloring, and the cells of the current
+   component */
+  uint16_t parities[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  uint16_t members[MAX_GRID_SIZE * MAX_GRID_SIZE];
+} chain_t;
+
+/* return the unit of given type holding the given cell */
+static size_t chain_unit(const chain_t *chain, const size_t type,
+                         const size_t cell)
+{
+  return chain->units[type][cell];
+}
+
+/* return the place of the given cell in its unit of given type */
+static size_t chain_place(const chain_t *chain, const size_t type,
+                          const size_t cell)
+{
+  return chain->ranks[type][cell];
+}
+
+/* compute the unit of given type holding the given cell */
+static size_t chain_unit_of(const chain_t *chain, const size_t type,
+                            const size_t cell)
+{
+  size_t row = cell / chain->size;
+  size_t column = cell % chain->size;
+
+  if (type == ROW)
+    return row;
+
+  if (type == COL)
+    return column;
+
+  return (row / chain->sqrt) * chain->sqrt + column / chain->sqrt;
+}
+
+/* compute the place of the given cell in its unit of given type */
+static size_t chain_place_of(const chain_t *chain, const size_t type,
+                             const size_t cell)
+{
+  size_t row = cell / chain->size;
+  size_t column = cell % chain->size;
+
+  if (type == ROW)
+    return column;
+
+  if (type == COL)
+    return row;
+
+  return (row % chain->sqrt) * chain->sqrt + column % chain->sqrt;
+}
+
+/* return the cell at the given place of the given unit of given type */
+static size_t chain_cell(const chain_t *chain, const size_t type,
+                         const size_t unit, const size_t place)
+{
+  size_t sqrt = chain->sqrt;
+
+  if (type == ROW)
+    return unit * chain->size + place;
+
+  if (type == COL)
+    return place * chain->size + unit;
+
+  return ((unit / sqrt) * sqrt + place / sqrt) * chain->size +
+         (unit % sqrt) * sqrt + place % sqrt;
+}
+
+/* check if the two given cells are different and share a unit */
+static bool chain_sees(const chain_t *chain, const size_t cell1,
+                       const size_t cell2)
+{
+  if (cell1 == cell2)
+    return false;
+
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+    if (chain_unit(chain, type, cell1) == chain_unit(chain, type, cell2))
+      return true;
+
+  return false;
+}
+
+/* fill the given array with the cells sharing a unit with the given cell,
+   each one once. return their number */
+static size_t chain_peers(const chain_t *chain, const size_t cell,
+                          uint16_t *peers)
+{
+  size_t count = 0;
+  size_t unit = 0;
+  size_t peer = 0;
+
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+  {
+    unit = chain_unit(chain, type, cell);
+    for (size_t place = 0; place < chain->size; place = place + 1)
+    {
+      peer = chain_cell(chain, type, unit, place);
+      if (peer == cell)
+        continue;
+
+/* the cells of the block in the row or the column are already in */
+      if (type == BLOCK &&
+          (chain_unit(chain, ROW, peer) == chain_unit(chain, ROW, cell) ||
+           chain_unit(chain, COL, peer) == chain_unit(chain, COL, cell)))
+        continue;
+
+      peers[count] = peer;
+      count = count + 1;
+    }
+  }
+
+  return count;
+}
+
+/* discard the given color from the given cell. return false if the cell
+   did not have it */
+static bool chain_discard(chain_t *chain, const size_t cell,
+                          const size_t color)
+{
+  size_t unit = 0;
+
+  if (!colors_is_in(chain->cells[cell], color))
+    return false;
+
+  chain->cells[cell] = colors_discard(chain->cells[cell], color);
+  grid_set_colors(chain->grid, cell / chain->size, cell % chain->size,
+                  chain->cells[cell]);
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+  {
+    unit = chain_unit(chain, type, cell);
+    chain->places[type][unit][color] =
+      colors_discard(chain->places[type][unit][color],
+                     chain_place(chain, type, cell));
+  }
+
+  return true;
+}
+
+/* discard the given color from the cells seeing both given cells */
+static bool chain_discard_common(chain_t *chain, const size_t cell1,
+                                 const size_t cell2, const size_t color)
+{
+  colors_t places = colors_empty();
+  size_t unit = 0;
+  size_t cell = 0;
+  bool alteration = false;
+
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+  {
+    unit = chain_unit(chain, type, cell1);
+    for (places = chain->places[type][unit][color]; places;
+         places = colors_xor(places, colors_rightmost(places)))
+    {
+      cell = chain_cell(chain, type, unit, colors_index(places));
+      if (cell != cell1 && chain_sees(chain, cell, cell2) &&
+          chain_discard(chain, cell, color))
+        alteration = true;
+    }
+  }
+
+  return alteration;
+}
+
+/* return the first cell from the given one on which still holds the given
+   color, the number of cells if there is none. The places of the color in
+   the rows are scanned rather than the cells */
+static size_t chain_next(const chain_t *chain, const size_t color,
+                         const size_t from)
+{
+  size_t size = chain->size;
+  colors_t places = colors_empty();
+
+  for (size_t row = from / size; row < size; row = row + 1)
+  {
+    places = chain->places[ROW][row][color];
+    if (row == from / size)
+      places = colors_subtract(places, colors_full(from % size));
+
+    if (places)
+      return row * size + colors_index(places);
+  }
+
+  return size * size;
+}
+
+/* simple coloring of the given color: the cells linked by the units where
+   the color has two places are colored alternately. If two cells of the
+   same parity share a unit, that parity is false. Otherwise one parity is
+   true, and the cells seeing both parities lose the color */
+static size_t chain_coloring(chain_t *chain, const size_t color)
+{
+  uint16_t *component = chain->members;
+  uint16_t *parities = chain->parities;
+  colors_t seen[2][NB_SUBGRID_TYPE];
+  bool wrap[2];
+  size_t nb_cells = chain->size * chain->size;
+  size_t nb_members = 0;
+  size_t id = 0;
+  size_t count = 0;
+  size_t cell = 0;
+  size_t parity = 0;
+  size_t unit = 0;
+  size_t other = 0;
+  bool sees[2];
+  bool alteration = false;
+
+  memset(parities, 0, nb_cells * sizeof(uint16_t));
+  for (size_t start = chain_next(chain, color, 0); start < nb_cells;
+       start = chain_next(chain, color, start + 1))
+  {
+    if (parities[start])
+      continue;
+
+/* the parity of a cell is stored with the id of its component, starting
+   at 1 so that 0 stands for an uncolored cell */
+    id = id + 1;
+    memset(seen, 0, sizeof(seen));
+    wrap[0] = false;
+    wrap[1] = false;
+    component[0] = start;
+    parities[start] = 2 * id;
+    nb_members = 1;
+    for (size_t i = 0; i < nb_members; i = i + 1)
+    {
+      cell = component[i];
+      parity = parities[cell] & 1;
+      for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+      {
+        unit = chain_unit(chain, type, cell);
+        if (colors_is_in(seen[parity][type], unit))
+          wrap[parity] = true;
+
+        seen[parity][type] = colors_add(seen[parity][type], unit);
+        if (colors_count(chain->places[type][unit][color]) != 2)
+          continue;
+
+        other = colors_index(colors_discard(chain->places[type][unit][color],
+                                            chain_place(chain, type, cell)));
+        other = chain_cell(chain, type, unit, other);
+        if (parities[other])
+          continue;
+
+        parities[other] = 2 * id + (1 - parity);
+        component[nb_members] = other;
+        nb_members = nb_members + 1;
+      }
+    }
+
+    if (nb_members < 2)
+      continue;
+
+    alteration = false;
+    if (wrap[0] || wrap[1])
+    {
+      for (size_t i = 0; i < nb_members; i = i + 1)
+        if (wrap[parities[component[i]] & 1] &&
+            chain_discard(chain, component[i], color))
+          alteration = true;
+    }
+    else
+      for (size_t row = 0; row < chain->size; row = row + 1)
+        for (colors_t places = chain->places[ROW][row][color]; places;
+             places = colors_xor(places, colors_rightmost(places)))
+        {
+          cell = row * chain->size + colors_index(places);
+          if (parities[cell] / 2 == id)
+            continue;
+
+          sees[0] = false;
+          sees[1] = false;
+          for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+          {
+            unit = chain_unit(chain, type, cell);
+            sees[0] = sees[0] || colors_is_in(seen[0][type], unit);
+            sees[1] = sees[1] || colors_is_in(seen[1][type], unit);
+          }
+
+          if (sees[0] && sees[1] && chain_discard(chain, cell, color))
+            alteration = true;
+        }
+
+    if (alteration)
+      count = count + 1;
+  }
+
+  return count;
+}
+
+/* XY-wings pivoting on the given cell of two colors */
+static size_t chain_xy_wing(chain_t *chain, const size_t pivot)
+{
+  uint16_t peers[NB_SUBGRID_TYPE * MAX_GRID_SIZE];
+  uint16_t pincers[NB_SUBGRID_TYPE * MAX_GRID_SIZE];
+  size_t nb_peers = chain_peers(chain, pivot, peers);
+  size_t nb_pincers = 0;
+  size_t count = 0;
+  colors_t colors = chain->cells[pivot];
+  colors_t shared1 = colors_empty();
+  colors_t shared2 = colors_empty();
+  colors_t other = colors_empty();
+
+  for (size_t i = 0; i < nb_peers; i = i + 1)
+    if (colors_count(chain->cells[peers[i]]) == 2 &&
+        colors_count(colors_and(chain->cells[peers[i]], colors)) == 1)
+    {
+      pincers[nb_pincers] = peers[i];
+      nb_pincers = nb_pincers + 1;
+    }
+
+  for (size_t i = 0; i < nb_pincers; i = i + 1)
+    for (size_t j = i + 1; j < nb_pincers; j = j + 1)
+    {
+      shared1 = colors_and(chain->cells[pincers[i]], colors);
+      shared2 = colors_and(chain->cells[pincers[j]], colors);
+      other = colors_subtract(chain->cells[pincers[i]], shared1);
+      if (colors_is_equal(shared1, shared2) ||
+          !colors_is_singleton(shared1) || !colors_is_singleton(shared2) ||
+          !colors_is_equal(other,
+                           colors_subtract(chain->cells[pincers[j]],
+                                           shared2)))
+        continue;
+
+      if (chain_discard_common(chain, pincers[i], pincers[j],
+                               colors_index(other)))
+        count = count + 1;
+    }
+
+  return count;
+}
+
+/* mark the given candidate as proven true (on) or false (off). return
+   false if it already was */
+static bool chain_mark(chain_t *chain, const bool on, const size_t cell,
+                       const size_t color)
+{
+  colors_t *marks = on ? chain->on : chain->off;
+
+  if (colors_is_in(marks[cell], color))
+    return false;
+
+  if (!chain->on[cell] && !chain->off[cell])
+  {
+    chain->marks[chain->nb_marks] = cell;
+    chain->nb_marks = chain->nb_marks + 1;
+  }
+
+  marks[cell] = colors_add(marks[cell], color);
+
+  return true;
+}
+
+/* queue the candidates made true by the given candidate being false (its
+   strong links): the other color of its cell if it has two, the other
+   place of its color in the units where the color has two places */
+static size_t chain_strong(chain_t *chain, const size_t cell,
+                           const size_t color, const size_t length,
+                           size_t nb_queued)
+{
+  colors_t places = colors_empty();
+  size_t other = 0;
+  size_t unit = 0;
+
+  if (colors_count(chain->cells[cell]) == 2)
+  {
+    other = colors_index(colors_discard(chain->cells[cell], color));
+    if (chain_mark(chain, true, cell, other))
+    {
+      chain->queue[nb_queued] = (node_t) {cell, other, length};
+      nb_queued = nb_queued + 1;
+    }
+  }
+
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+  {
+    unit = chain_unit(chain, type, cell);
+    places = chain->places[type][unit][color];
+    if (colors_count(places) != 2)
+      continue;
+
+    other = colors_index(colors_discard(places,
+                                        chain_place(chain, type, cell)));
+    other = chain_cell(chain, type, unit, other);
+    if (chain_mark(chain, true, other, color))
+    {
+      chain->queue[nb_queued] = (node_t) {other, color, length};
+      nb_queued = nb_queued + 1;
+    }
+  }
+
+  return nb_queued;
+}
+
+/* queue the candidates made true by the chains going through the
+   candidates made false by the given true one (its weak links): the other
+   colors of its cell, its color in the cells seeing it */
+static size_t chain_weak(chain_t *chain, const node_t *node,
+                         size_t nb_queued)
+{
+  colors_t others = colors_discard(chain->cells[node->cell], node->color);
+  colors_t places = colors_empty();
+  size_t color = 0;
+  size_t cell = 0;
+  size_t unit = 0;
+
+  for (; others; others = colors_xor(others, colors_rightmost(others)))
+  {
+    color = colors_index(others);
+    if (chain_mark(chain, false, node->cell, color))
+      nb_queued = chain_strong(chain, node->cell, color, node->length + 1,
+                               nb_queued);
+  }
+
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+  {
+    unit = chain_unit(chain, type, node->cell);
+    places = colors_discard(chain->places[type][unit][node->color],
+                            chain_place(chain, type, node->cell));
+    for (; places; places = colors_xor(places, colors_rightmost(places)))
+    {
+      cell = chain_cell(chain, type, unit, colors_index(places));
+      if (chain_mark(chain, false, cell, node->color))
+        nb_queued = chain_strong(chain, cell, node->color, node->length + 1,
+                                 nb_queued);
+    }
+  }
+
+  return nb_queued;
+}
+
+/* one of the two given candidates is true, discard the candidates seeing
+   both. return true if a color was discarded */
+static bool chain_conclude(chain_t *chain, const node_t *start,
+                           const node_t *end)
+{
+  colors_t colors = colors_empty();
+  bool alteration = false;
+
+  if (start->cell == end->cell)
+  {
+/* a chain from a candidate back to itself proves it */
+    colors = colors_discard(chain->cells[start->cell], start->color);
+    if (start->color != end->color)
+      colors = colors_discard(colors, end->color);
+
+    for (; colors; colors = colors_xor(colors, colors_rightmost(colors)))
+      alteration = chain_discard(chain, start->cell, colors_index(colors)) ||
+                   alteration;
+
+    return alteration;
+  }
+
+  if (start->color == end->color)
+    return chain_discard_common(chain, start->cell, end->cell, start->color);
+
+  if (!chain_sees(chain, start->cell, end->cell))
+    return false;
+
+  alteration = chain_discard(chain, end->cell, start->color);
+  alteration = chain_discard(chain, start->cell, end->color) || alteration;
+
+  return alteration;
+}
+
+/* alternating inference chains from each candidate: assuming it false,
+   the candidates reached through up to chain->length strong links are
+   true, so one of them and the start holds. The search stops after the
+   first cell whose chains discarded a color, the cheaper techniques take
+   over from there */
+static size_t chain_aic(chain_t *chain)
+{
+  node_t start;
+  size_t nb_cells = chain->size * chain->size;
+  size_t nb_queued = 0;
+  size_t count = 0;
+  colors_t colors = colors_empty();
+
+  for (size_t cell = 0; cell < nb_cells && !count; cell = cell + 1)
+    for (colors = chain->cells[cell]; colors;
+         colors = colors_xor(colors, colors_rightmost(colors)))
+    {
+      start = (node_t) {cell, colors_index(colors), 0};
+      if (colors_is_singleton(chain->cells[cell]) ||
+          !colors_is_in(chain->cells[cell], start.color))
+        continue;
+
+      chain_mark(chain, false, cell, start.color);
+      nb_queued = chain_strong(chain, cell, start.color, 1, 0);
+      for (size_t i = 0; i < nb_queued; i = i + 1)
+      {
+        if (chain_conclude(chain, &start, &chain->queue[i]))
+          count = count + 1;
+
+        if (chain->queue[i].length < chain->length)
+          nb_queued = chain_weak(chain, &chain->queue[i], nb_queued);
+      }
+
+      for (size_t i = 0; i < chain->nb_marks; i = i + 1)
+      {
+        chain->on[chain->marks[i]] = colors_empty();
+        chain->off[chain->marks[i]] = colors_empty();
+      }
+
+      chain->nb_marks = 0;
+    }
+
+  return count;
+}
+
+size_t grid_chains(grid_t *grid, const size_t length)
+{
+  chain_t *chain = NULL;
+  size_t size = grid_get_size(grid);
+  size_t nb_cells = size * size;
+  size_t count = 0;
+  size_t cell = 0;
+  size_t color = 0;
+  colors_t *places = NULL;
+
+  if (size < 4 || !length)
+    return 0;
+
+  chain = malloc(sizeof(chain_t));
+  if (!chain)
+    return 0;
+
+/* each candidate is queued at most once per start */
+  chain->queue = malloc(nb_cells * size * sizeof(node_t));
+  if (!chain->queue)
+  {
+    free(chain);
+    return 0;
+  }
+
+  chain->grid = grid;
+  chain->size = size;
+  for (chain->sqrt = 1; chain->sqrt * chain->sqrt < size;
+       chain->sqrt = chain->sqrt + 1)
+    ;
+
+  chain->length = length < CHAINS_MAX_LENGTH ? length : CHAINS_MAX_LENGTH;
+  chain->nb_marks = 0;
+  memset(chain->on, 0, nb_cells * sizeof(colors_t));
+  memset(chain->off, 0, nb_cells * sizeof(colors_t));
+  for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+    for (size_t unit = 0; unit < size; unit = unit + 1)
+      memset(chain->places[type][unit], 0, size * sizeof(colors_t));
+
+  for (cell = 0; cell < nb_cells; cell = cell + 1)
+    for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+    {
+      chain->units[type][cell] = chain_unit_of(chain, type, cell);
+      chain->ranks[type][cell] = chain_place_of(chain, type, cell);
+    }
+
+  for (cell = 0; cell < nb_cells; cell = cell + 1)
+  {
+    chain->cells[cell] = grid_get_colors(grid, cell / size, cell % size);
+    for (colors_t colors = chain->cells[cell]; colors;
+         colors = colors_xor(colors, colors_rightmost(colors)))
+    {
+      color = colors_index(colors);
+      for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+      {
+        places = &chain->places[type][chain_unit(chain, type, cell)][color];
+        *places = colors_add(*places, chain_place(chain, type, cell));
+      }
+    }
+  }
+
+  for (color = 0; color < size; color = color + 1)
+    count = count + chain_coloring(chain, color);
+
+  for (cell = 0; cell < nb_cells && !count; cell = cell + 1)
+    if (colors_count(chain->cells[cell]) == 2)
+      count = count + chain_xy_wing(chain, cell);
+
+  if (!count)
+    count = chain_aic(chain);
+
+  free(chain->queue);
+  free(chain);
+
+  return count;
+}
@@ -0,0 +1,26 @@
+#ifndef CHAINS_H
+#define CHAINS_H
+
+#include <grid.h>
+
+#include <stddef.h>
+
+/* number of strong links of the longest alternating inference chains
+   looked for by default, an XY-wing is a chain of 3 of them */
+#define CHAINS_DEFAULT_LENGTH 4
+#define CHAINS_MAX_LENGTH 16
+
+/* look for the chains of the given grid, from the cheapest kind to the
+   most expensive one, and stop at the first kind which discarded a color:
+   - simple coloring: the cells of a color linked two by two by the units
+     where the color has only two places, one cell out of two holds it;
+   - XY-wing: a cell {x,y} seeing the cells {x,z} and {y,z}, z is discarded
+     from the cells seeing both of them;
+   - alternating inference chains of up to the given number of strong links
+     (two places of a color in a unit, two colors of a cell) joined by weak
+     ones: one of the ends of the chain holds, so the colors seeing both
+     ends are discarded.
+   return the number of chains which discarded a color */
+size_t grid_chains(grid_t *grid, const size_t length);
+
+#endif /* CHAINS_H */
@@ -0,0 +1,402 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* the checks read the grids written with the chars of color_table only */
+#define MAX_CELLS (MAX_CHAR_SIZE * MAX_CHAR_SIZE)
+
+/* a line of a file may hold a grid of the largest size with a blank
+   between its cells */
+#define MAX_TEXT (2 * MAX_CELLS + 2)
+
+/* codes of the characters which are not a color (a color is coded by its
+   index) */
+#define CODE_EMPTY MAX_SIZE
+#define CODE_WRONG (MAX_SIZE + 1)
+#define CODE_BLANK (MAX_SIZE + 2)
+#define CODE_END (MAX_SIZE + 3)
+
+static const char *subgrid_names[NB_SUBGRID_TYPE] = {"column", "row",
+                                                     "block"};
+
+/* a conflict is reported in the row first, then the column, then the
+   block */
+static const size_t subgrid_order[NB_SUBGRID_TYPE] = {ROW, COL, BLOCK};
+
+static uint8_t char_codes[256];
+static colors_t code_bits[CODE_WRONG + 1];
+static pthread_once_t codes_once = PTHREAD_ONCE_INIT;
+
+static void codes_init(void)
+{
+  memset(char_codes, CODE_WRONG, sizeof(char_codes));
+  for (size_t i = 0; i < MAX_CHAR_SIZE; i = i + 1)
+  {
+    char_codes[(unsigned char) color_table[i]] = i;
+    code_bits[i] = colors_set(i);
+  }
+
+  char_codes[(unsigned char) EMPTY_CELL] = CODE_EMPTY;
+  char_codes[(unsigned char) ' '] = CODE_BLANK;
+  char_codes[(unsigned char) '\t'] = CODE_BLANK;
+  char_codes[(unsigned char) '\r'] = CODE_BLANK;
+  char_codes[(unsigned char) '\n'] = CODE_END;
+  char_codes[0] = CODE_END;
+}
+
+/* translate the cells of the given text into codes, up to room of them.
+   return their number (room + 1 if there are more), wrong is set to the
+   first wrong character, or '\0' */
+static size_t parse_cells(const char *text, uint8_t *cells, const size_t room,
+                          char *wrong)
+{
+  size_t nb_cells = 0;
+  uint8_t code = 0;
+
+  *wrong = '\0';
+  for (;; text = text + 1)
+  {
+    code = char_codes[(unsigned char) *text];
+    if (code == CODE_BLANK)
+      continue;
+
+    if (code == CODE_END)
+      return nb_cells;
+
+    if (nb_cells == room)
+      return room + 1;
+
+    if (code == CODE_WRONG && !*wrong)
+      *wrong = *text;
+
+    cells[nb_cells] = code;
+    nb_cells = nb_cells + 1;
+  }
+}
+
+/* find the first cell, in reading order, whose color is wrong or already
+   seen in one of its subgrids */
+static bool check_locate(const uint8_t *cells, const size_t size,
+                         const size_t sqrt, check_t *check)
+{
+  colors_t seen[NB_SUBGRID_TYPE][MAX_GRID_SIZE];
+  size_t index[NB_SUBGRID_TYPE];
+  uint8_t code = 0;
+
+  memset(seen, 0, sizeof(seen));
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+    {
+      code = cells[i * size + j];
+      if (code == CODE_EMPTY)
+        continue;
+
+      check->row = i;
+      check->column = j;
+      if (code >= size)
+      {
+        if (code < MAX_SIZE)
+          check->color = color_table[code];
+
+        check->status = check_malformed;
+
+        return false;
+      }
+
+      index[COL] = j;
+      index[ROW] = i;
+      index[BLOCK] = (i / sqrt) * sqrt + j / sqrt;
+      check->color = color_table[code];
+      for (size_t t = 0; t < NB_SUBGRID_TYPE; t = t + 1)
+      {
+        size_t type = subgrid_order[t];
+
+        if (seen[type][index[type]] & code_bits[code])
+        {
+          check->status = check_conflict;
+          check->subgrid = type;
+          check->index = index[type];
+
+          return false;
+        }
+      }
+
+      for (size_t type = 0; type < NB_SUBGRID_TYPE; type = type + 1)
+        seen[type][index[type]] = seen[type][index[type]] | code_bits[code];
+    }
+
+  return true;
+}
+
+/* check the given codes of a grid. A subgrid is free of conflict if its
+   colors, OR'ed together, count as many as its filled cells: the sum over
+   all the subgrids matches three times the filled cells of the grid only
+   if no subgrid has a conflict */
+static bool check_codes(const uint8_t *cells, const size_t nb_cells,
+                        const char wrong, check_t *check)
+{
+  colors_t columns[MAX_GRID_SIZE];
+  colors_t blocks[MAX_GRID_SQRT];
+  colors_t row = 0;
+  colors_t all = 0;
+  colors_t bit = 0;
+  const uint8_t *line = NULL;
+  size_t size = 1;
+  size_t sqrt = 1;
+  size_t filled = 0;
+  size_t sum = 0;
+
+  memset(check, 0, sizeof(check_t));
+  check->status = check_malformed;
+  check->color = wrong;
+
+  while (size * size < nb_cells)
+    size = size + 1;
+
+  if (size * size != nb_cells || !grid_check_size(size) ||
+      size > MAX_CHAR_SIZE)
+    return false;
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  check->size = size;
+  if (wrong)
+    return check_locate(cells, size, sqrt, check);
+
+  memset(columns, 0, size * sizeof(colors_t));
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    if (i % sqrt == 0)
+      memset(blocks, 0, sqrt * sizeof(colors_t));
+
+    line = cells + i * size;
+    row = 0;
+    for (size_t b = 0; b < sqrt; b = b + 1)
+      for (size_t j = b * sqrt; j < (b + 1) * sqrt; j = j + 1)
+      {
+        bit = code_bits[line[j]];
+        row = row | bit;
+        columns[j] = columns[j] | bit;
+        blocks[b] = blocks[b] | bit;
+        filled = filled + (line[j] != CODE_EMPTY);
+      }
+
+    sum = sum + colors_count(row);
+    all = all | row;
+    if ((i + 1) % sqrt == 0)
+      for (size_t b = 0; b < sqrt; b = b + 1)
+        sum = sum + colors_count(blocks[b]);
+  }
+
+  for (size_t j = 0; j < size; j = j + 1)
+    sum = sum + colors_count(columns[j]);
+
+  if (sum != 3 * filled || !colors_is_subset(all, colors_full(size)))
+    return check_locate(cells, size, sqrt, check);
+
+  check->status = filled == nb_cells ? check_solved : check_partial;
+
+  return true;
+}
+
+bool check_line(const char *line, check_t *check)
+{
+  uint8_t cells[MAX_CELLS];
+  size_t nb_cells = 0;
+  char wrong = '\0';
+
+  if (!line || !check)
+    return false;
+
+  pthread_once(&codes_once, codes_init);
+
+  nb_cells = parse_cells(line, cells, MAX_CELLS, &wrong);
+
+  return check_codes(cells, nb_cells, wrong, check);
+}
+
+static void check_report(FILE *fd, const char *path, const size_t line,
+                         const check_t *check, size_t *nb_wrong)
+{
+  char answer[128];
+
+  check_to_line(check, answer, sizeof(answer));
+  fprintf(fd, "%s:%zu: %s\n", path, line, answer);
+  if (check->status >= check_conflict)
+    *nb_wrong = *nb_wrong + 1;
+}
+
+/* check if the given number of cells may be a row of a grid written as a
+   solver input */
+static bool check_row_size(const size_t nb_cells)
+{
+  return nb_cells > 1 && nb_cells <= MAX_CHAR_SIZE &&
+         grid_check_size(nb_cells);
+}
+
+bool check_file(const char *path, FILE *fd, size_t *nb_wrong)
+{
+  FILE *f = NULL;
+  char text[MAX_TEXT];
+  uint8_t cells[MAX_CELLS];
+  check_t check;
+  size_t size = 0;
+  size_t nb_rows = 0;
+  size_t nb_cells = 0;
+  size_t line = 0;
+  size_t first = 0;
+  size_t length = 0;
+  char wrong = '\0';
+  char first_wrong = '\0';
+  bool decided = false;
+  bool by_rows = false;
+  int c = 0;
+
+  if (!path || !fd || !nb_wrong)
+    return false;
+
+  pthread_once(&codes_once, codes_init);
+
+  f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!f)
+    return false;
+
+  *nb_wrong = 0;
+  while (fgets(text, sizeof(text), f))
+  {
+    line = line + 1;
+    length = strlen(text);
+
+/* a line too long for any grid is cut, and read as too many cells */
+    if (length == sizeof(text) - 1 && text[length - 1] != '\n')
+      do
+        c = getc(f);
+      while (c != '\n' && c != EOF);
+
+    text[strcspn(text, "#")] = '\0';
+
+/* a grid as a solver input, a row per line */
+    if (size)
+    {
+      nb_cells = parse_cells(text, cells + nb_rows * size, size, &wrong);
+      if (!nb_cells)
+        continue;
+
+      if (nb_cells != size)
+      {
+        memset(&check, 0, sizeof(check_t));
+        check.status = check_malformed;
+        check_report(fd, path, first, &check, nb_wrong);
+        size = 0;
+        continue;
+      }
+
+      if (!first_wrong)
+        first_wrong = wrong;
+
+      nb_rows = nb_rows + 1;
+      if (nb_rows == size)
+      {
+        check_codes(cells, size * size, first_wrong, &check);
+        check_report(fd, path, first, &check, nb_wrong);
+        size = 0;
+      }
+
+      continue;
+    }
+
+    nb_cells = parse_cells(text, cells, MAX_CELLS, &wrong);
+    if (!nb_cells)
+      continue;
+
+    first = line;
+
+/* the first grid of the file tells how its grids are written */
+    if (!decided)
+    {
+      by_rows = check_row_size(nb_cells);
+      decided = true;
+    }
+
+    if (!by_rows)
+    {
+      check_codes(cells, nb_cells, wrong, &check);
+      check_report(fd, path, first, &check, nb_wrong);
+      continue;
+    }
+
+    if (!check_row_size(nb_cells))
+    {
+      memset(&check, 0, sizeof(check_t));
+      check.status = check_malformed;
+      check_report(fd, path, first, &check, nb_wrong);
+      continue;
+    }
+
+    size = nb_cells;
+    nb_rows = 1;
+    first_wrong = wrong;
+  }
+
+/* the last grid misses rows */
+  if (size)
+  {
+    memset(&check, 0, sizeof(check_t));
+    check.status = check_malformed;
+    check_report(fd, path, first, &check, nb_wrong);
+  }
+
+  if (f != stdin)
+    fclose(f);
+
+  return true;
+}
+
+size_t check_to_line(const check_t *check, char *buffer, const size_t length)
+{
+  int written = 0;
+
+  if (!check || !buffer || !length)
+    return 0;
+
+  switch (check->status)
+  {
+    case check_solved:
+        written = snprintf(buffer, length, "solved");
+      break;
+
+    case check_partial:
+        written = snprintf(buffer, length, "partial");
+      break;
+
+    case check_conflict:
+        written = snprintf(buffer, length, "conflict %c row %zu column %zu in"
+                           " %s %zu", check->color, check->row + 1,
+                           check->column + 1, subgrid_names[check->subgrid],
+                           check->index + 1);
+      break;
+
+    default:
+        if (!check->size)
+          written = snprintf(buffer, length, "malformed number of cells");
+        else
+          written = snprintf(buffer, length, "malformed '%c' row %zu column"
+                             " %zu", check->color, check->row + 1,
+                             check->column + 1);
+  }
+
+  if (written < 0 || (size_t) written >= length)
+    return 0;
+
+  return written;
+}
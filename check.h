@@ -0,0 +1,55 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* verdict on a grid, from the best to the worst */
+typedef enum
+{
+  check_solved,
+  check_partial,
+  check_conflict,
+  check_malformed
+} check_status_t;
+
+/* outcome of a check. For a conflict, the cell (row and column, from 0) is
+   the first one, in reading order, whose color already appears in a
+   subgrid (COL, ROW or BLOCK) of the given index. For a malformed grid, it
+   is the cell of the wrong character, or size is 0 when the number of
+   cells is wrong */
+typedef struct
+{
+  check_status_t status;
+  size_t size;
+  size_t subgrid;
+  size_t index;
+  size_t row;
+  size_t column;
+  char color;
+} check_t;
+
+/* check the grid written on the given line (as read by grid_from_line),
+   without building a grid: no propagation, no allocation.
+   return true if it is solved or partial */
+bool check_line(const char *line, check_t *check);
+
+/* check every grid of the file at the given path ('-' for the standard
+   input): the grids are written as a solver input, one after the other, or
+   on single lines, as the first grid of the file tells (a first line of 16
+   cells starts a 16x16 grid, one of 81 cells is a 9x9 grid). One verdict
+   per grid is written in the given file, prefixed by the path and the line
+   where the grid starts. Set nb_wrong to the number of grids with a
+   conflict or malformed. return false if the file could not be read */
+bool check_file(const char *path, FILE *fd, size_t *nb_wrong);
+
+/* write the given verdict on a single line in the given buffer:
+   "solved", "partial", "conflict COLOR row R column C in SUBGRID N" or
+   "malformed ...", rows, columns and subgrids counted from 1.
+   return the number of char written (0 if it does not fit) */
+size_t check_to_line(const check_t *check, char *buffer, const size_t length);
+
+#endif /* CHECK_H */
@@ -1,12 +1,15 @@
 
 #include <colors.h>
-#include <time.h>
+#include <rng.h>
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h>
+
+#if defined(__BMI2__) && COLORS_BITS == 64
+#include <immintrin.h>
+#endif
 
 colors_t colors_full(const size_t size)
 {
@@ -46,12 +49,25 @@ colors_t colors_discard(const colors_t colors, const size_t color_id)
   return colors & (~colors_set(color_id));
 }
 
+/* with 128 bits, the bit is read in its own word rather than through a
+   shift of the 128 bits */
 bool colors_is_in(const colors_t colors, const size_t color_id)
 {
+#if COLORS_BITS == 64
   if(color_id > MAX_SIZE)
     return false;
 
   return (colors_set(color_id) & colors) != 0;
+#else
+  uint64_t word = 0;
+
+  if(color_id >= MAX_SIZE)
+    return false;
+
+  word = color_id < 64 ? (uint64_t) colors : (uint64_t) (colors >> 64);
+
+  return (word >> (color_id % 64)) & 1;
+#endif
 }
 
 colors_t colors_negate(const colors_t colors)
@@ -102,14 +118,49 @@ colors_t colors_rightmost(const colors_t colors)
   return colors & ~(colors - 1);
 }
 
-size_t colors_count(const colors_t colors)
+/* number of '1' of the given 64 bits */
+static size_t count_word(const uint64_t word)
 {
-  colors_t i = colors;
+  uint64_t i = word;
   i = i - ((i >> 1) & 0x5555555555555555);
   i = (i & 0x3333333333333333) + ((i >> 2) & 0x3333333333333333);
   return (((i + (i >> 4)) & 0x0F0F0F0F0F0F0F0F) * 0x0101010101010101) >> 56;
 }
 
+/* with 128 bits, the high word is only counted when it holds colors, which
+   it never does on the grids of 64 colors or less */
+size_t colors_count(const colors_t colors)
+{
+#if COLORS_BITS == 64
+  return count_word(colors);
+#else
+  uint64_t high = (uint64_t) (colors >> 64);
+
+  return count_word((uint64_t) colors) + (high ? count_word(high) : 0);
+#endif
+}
+
+size_t colors_index(const colors_t colors)
+{
+#if COLORS_BITS == 64
+  if (colors == 0)
+    return MAX_SIZE;
+
+  return colors_count(colors_rightmost(colors) - 1);
+#else
+  uint64_t low = (uint64_t) colors;
+  uint64_t high = (uint64_t) (colors >> 64);
+
+  if (low)
+    return count_word((low & -low) - 1);
+
+  if (high)
+    return 64 + count_word((high & -high) - 1);
+
+  return MAX_SIZE;
+#endif
+}
+
 colors_t colors_leftmost(const colors_t colors)
 {
   colors_t  n = colors;
@@ -124,34 +175,44 @@ colors_t colors_leftmost(const colors_t colors)
   return colors_set(r);
 }
 
-static void prng_init(time_t seed)
+colors_t colors_nth(const colors_t colors, const size_t n)
 {
-  static bool seed_initialized = false;
+  if (n >= colors_count(colors))
+    return 0;
 
-  if (!seed_initialized)
+#if defined(__BMI2__) && COLORS_BITS == 64
+  return _pdep_u64(colors_set(n), colors);
+#else
+  size_t rank = n;
+  size_t count = 0;
+  colors_t byte = 0;
+
+/* the byte holding the bit is found first, then the bit in the byte */
+  for (size_t shift = 0; shift < MAX_SIZE; shift = shift + 8)
   {
-    srandom(seed);
-    seed_initialized = true;
+    byte = colors & ((colors_t) 0xFF << shift);
+    count = colors_count(byte);
+    if (rank < count)
+      break;
+
+    rank = rank - count;
   }
+
+  for (size_t i = 0; i < rank; i = i + 1)
+    byte = byte ^ colors_rightmost(byte);
+
+  return colors_rightmost(byte);
+#endif
 }
 
-colors_t colors_random(const colors_t colors)
+colors_t colors_random(const colors_t colors, rng_t *rng)
 {
-  colors_t random_color = colors;
-  prng_init(time(NULL) * getpid());
-  int nb_colors = colors_count(colors);
-  long r = random();
+  size_t nb_colors = colors_count(colors);
 
-  if (!nb_colors)
+  if (!nb_colors || !rng)
     return 0;
 
-  r = r % nb_colors;
-  for (int i = 0; i < r; i = i + 1)
-    random_color = random_color ^ colors_rightmost(random_color);
-  
-  random_color = colors_rightmost(random_color);
-  
-  return random_color;
+  return colors_nth(colors, rng_below(rng, nb_colors));
 }
 
 bool subgrid_consistency(colors_t **subgrid, const size_t size)
@@ -207,33 +268,52 @@ static bool cross_hatching(colors_t **subgrid, const size_t size)
   return alteration;
 }
 
+/* the colors are taken in order, each one held by a single cell setting
+   this cell to it. The colors held once are found in a single pass over the
+   subgrid, made again only after a cell changed */
 static bool lone_number(colors_t **subgrid, const size_t size)
 {
+  colors_t once = colors_empty();
+  colors_t twice = colors_empty();
+  colors_t done = colors_empty();
   colors_t suspect = colors_empty();
-  size_t occ = 0;
   colors_t control = colors_empty();
   bool alteration = false;
+  bool changed = true;
 
   if (!subgrid)
     return false;
 
-  for (size_t i = 0; i < size; i = i + 1)
+  while (true)
   {
-    occ = 0;
-    suspect = colors_set(i);
-    for (size_t j = 0; j < size; j = j + 1)
-      if (colors_and(*subgrid[j], suspect))
-        occ = occ + 1;
-
-    if (occ == 1)
+    if (changed)
+    {
+      once = colors_empty();
+      twice = colors_empty();
       for (size_t j = 0; j < size; j = j + 1)
       {
-        control = *subgrid[i];
-        if (colors_and(*subgrid[j], suspect))
-          *subgrid[j] = colors_and(*subgrid[j], suspect);
+        twice = colors_or(twice, colors_and(once, *subgrid[j]));
+        once = colors_or(once, *subgrid[j]);
+      }
+    }
+
+    suspect = colors_rightmost(colors_subtract(colors_subtract(once, twice),
+                                               done));
+    if (!suspect)
+      break;
 
-        alteration = alteration || !colors_is_equal(*subgrid[i], control);
+    done = colors_or(suspect, suspect - 1);
+    changed = false;
+    for (size_t j = 0; j < size; j = j + 1)
+      if (colors_and(*subgrid[j], suspect))
+      {
+        control = *subgrid[j];
+        *subgrid[j] = suspect;
+        changed = !colors_is_equal(*subgrid[j], control);
+        break;
       }
+
+    alteration = alteration || changed;
   }
 
   return alteration;
@@ -262,11 +342,11 @@ static bool naked_subset(colors_t **subgrid, const size_t size)
     if (occ == suspect_size)
       for (size_t j = 0; j < size; j = j + 1)
       {
-        control = *subgrid[i];
+        control = *subgrid[j];
         if (!colors_is_equal(suspect, *subgrid[j]))
           *subgrid[j] = colors_subtract(*subgrid[j], suspect);
 
-        alteration = alteration || !colors_is_equal(*subgrid[i], control);
+        alteration = alteration || !colors_is_equal(*subgrid[j], control);
       }
   }
 
@@ -296,17 +376,204 @@ static bool hidden_subset(colors_t **subgrid, const size_t size)
     if (occ == suspect_size)
       for (size_t j = 0; j < size; j = j + 1)
       {
-        control = *subgrid[i];
+        control = *subgrid[j];
         if (colors_and(suspect, *subgrid[j]))
           *subgrid[j] = colors_and(*subgrid[j], suspect);
 
-        alteration = alteration || !colors_is_equal(*subgrid[i], control);
+        alteration = alteration || !colors_is_equal(*subgrid[j], control);
+      }
+  }
+
+  return alteration;
+}
+
+/* state of the matching of the cells of a subgrid with its colors, and of
+   the search of the strongly connected components of its alternating
+   graph (Tarjan) */
+typedef struct
+{
+  colors_t *cells[MAX_SIZE];
+  size_t size;
+  size_t cell_of[MAX_SIZE];
+  size_t color_of[MAX_SIZE];
+  colors_t visited;
+  size_t index[MAX_SIZE];
+  size_t low[MAX_SIZE];
+  size_t component[MAX_SIZE];
+  size_t stack[MAX_SIZE];
+  size_t nb_stacked;
+  bool stacked[MAX_SIZE];
+  size_t nb_indexed;
+  size_t nb_components;
+} matching_t;
+
+/* look for an augmenting path from the given cell (Kuhn), among the colors
+   not visited yet. return true if the cell got matched */
+static bool matching_augment(matching_t *matching, const size_t cell)
+{
+  colors_t left = colors_subtract(*matching->cells[cell], matching->visited);
+  colors_t color = colors_empty();
+  size_t id = 0;
+
+  while (left)
+  {
+    color = colors_rightmost(left);
+    left = colors_xor(left, color);
+    matching->visited = colors_or(matching->visited, color);
+    id = colors_index(color);
+    if (matching->cell_of[id] == matching->size ||
+        matching_augment(matching, matching->cell_of[id]))
+    {
+      matching->cell_of[id] = cell;
+      matching->color_of[cell] = id;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* number the strongly connected component of the given cell, in the graph
+   going from a cell to the cell matched with each of its other colors */
+static void matching_connect(matching_t *matching, const size_t cell)
+{
+  colors_t left = *matching->cells[cell];
+  size_t next = 0;
+  size_t top = 0;
+
+  matching->index[cell] = matching->nb_indexed;
+  matching->low[cell] = matching->nb_indexed;
+  matching->nb_indexed = matching->nb_indexed + 1;
+  matching->stack[matching->nb_stacked] = cell;
+  matching->nb_stacked = matching->nb_stacked + 1;
+  matching->stacked[cell] = true;
+
+  while (left)
+  {
+    next = matching->cell_of[colors_index(left)];
+    left = colors_xor(left, colors_rightmost(left));
+    if (matching->index[next] == matching->size)
+    {
+      matching_connect(matching, next);
+      if (matching->low[next] < matching->low[cell])
+        matching->low[cell] = matching->low[next];
+    }
+    else if (matching->stacked[next] &&
+             matching->index[next] < matching->low[cell])
+      matching->low[cell] = matching->index[next];
+  }
+
+  if (matching->low[cell] != matching->index[cell])
+    return;
+
+  do
+  {
+    matching->nb_stacked = matching->nb_stacked - 1;
+    top = matching->stack[matching->nb_stacked];
+    matching->stacked[top] = false;
+    matching->component[top] = matching->nb_components;
+  } while (top != cell);
+
+  matching->nb_components = matching->nb_components + 1;
+}
+
+/* all-different filtering (Regin): the cells and the colors of a subgrid
+   are matched one to one, and a color is kept in a cell only if some
+   perfect matching gives it to the cell, i.e if the cell is matched with it
+   or in the same strongly connected component as the cell matched with it.
+   This finds every naked and hidden subset at once, those of different
+   masks included. A subgrid with no perfect matching gets an empty cell */
+static bool alldifferent(colors_t **subgrid, const size_t size)
+{
+  matching_t matching;
+  colors_t kept[MAX_SIZE];
+  colors_t control = colors_empty();
+  bool alteration = false;
+
+  if (!subgrid || size > MAX_SIZE)
+    return false;
+
+  matching.size = size;
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    matching.cells[i] = subgrid[i];
+    matching.cell_of[i] = size;
+    matching.color_of[i] = size;
+  }
+
+/* the singletons, then a greedy pass, match most cells without any path */
+  for (size_t pass = 0; pass < 2; pass = pass + 1)
+    for (size_t i = 0; i < size; i = i + 1)
+    {
+      if (matching.color_of[i] != size ||
+          colors_is_singleton(*subgrid[i]) != (pass == 0))
+        continue;
+
+      control = colors_empty();
+      for (colors_t left = *subgrid[i]; left && !control;
+           left = colors_xor(left, colors_rightmost(left)))
+        if (matching.cell_of[colors_index(left)] == size)
+          control = colors_rightmost(left);
+
+      if (control)
+      {
+        matching.cell_of[colors_index(control)] = i;
+        matching.color_of[i] = colors_index(control);
       }
+    }
+
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    matching.visited = colors_empty();
+    if (matching.color_of[i] == size && !matching_augment(&matching, i))
+    {
+      alteration = !colors_is_equal(*subgrid[i], colors_empty());
+      *subgrid[i] = colors_empty();
+
+      return alteration;
+    }
+  }
+
+  matching.nb_stacked = 0;
+  matching.nb_indexed = 0;
+  matching.nb_components = 0;
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    matching.index[i] = size;
+    matching.stacked[i] = false;
+    kept[i] = colors_empty();
+  }
+
+  for (size_t i = 0; i < size; i = i + 1)
+    if (matching.index[i] == size)
+      matching_connect(&matching, i);
+
+  for (size_t i = 0; i < size; i = i + 1)
+    kept[matching.component[i]] = colors_or(kept[matching.component[i]],
+                                            colors_set(matching.color_of[i]));
+
+  for (size_t i = 0; i < size; i = i + 1)
+  {
+    control = *subgrid[i];
+    *subgrid[i] = colors_and(*subgrid[i], kept[matching.component[i]]);
+    alteration = alteration || !colors_is_equal(*subgrid[i], control);
   }
 
   return alteration;
 }
 
+/* the techniques, from the easiest to the hardest */
+static bool (*const techniques[NB_UNIT_TECHNIQUES])(colors_t **,
+                                                    const size_t) =
+{
+  cross_hatching,
+  lone_number,
+  naked_subset,
+  hidden_subset,
+  alldifferent
+};
+
 bool subgrid_heuristics(colors_t **subgrid, const size_t size)
 {
   bool alteration = false;
@@ -314,10 +581,46 @@ bool subgrid_heuristics(colors_t **subgrid, const size_t size)
   if (!subgrid)
     return false;
 
-  alteration = alteration || cross_hatching(subgrid, size);
-  alteration = alteration || lone_number(subgrid, size);
-  alteration = alteration || naked_subset(subgrid, size);
-  alteration = alteration || hidden_subset(subgrid, size);
-  
+  for (size_t i = 0; i < NB_UNIT_TECHNIQUES && !alteration; i = i + 1)
+    alteration = techniques[i](subgrid, size);
+
   return alteration;
 }
+
+bool subgrid_technique(colors_t **subgrid, const size_t size,
+                       const technique_t technique)
+{
+  if (!subgrid || technique >= NB_UNIT_TECHNIQUES)
+    return false;
+
+  return techniques[technique](subgrid, size);
+}
+
+const char *technique_name(const technique_t technique)
+{
+  switch (technique)
+  {
+    case technique_cross_hatching:
+      return "cross_hatching";
+
+    case technique_lone_number:
+      return "lone_number";
+
+    case technique_naked_subset:
+      return "naked_subset";
+
+    case technique_hidden_subset:
+      return "hidden_subset";
+
+    case technique_alldifferent:
+      return "alldifferent";
+
+    case technique_fish:
+      return "fish";
+
+    case technique_chains:
+      return "chains";
+  }
+
+  return "unknown";
+}
@@ -1,14 +1,46 @@
 #ifndef COLORS_H
 #define COLORS_H
 
-#define MAX_COLORS 0xFFFFFFFFFFFFFFFFULL
-#define MAX_SIZE 64
+#include <rng.h>
 
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
+/* number of bits of a set of colors, chosen when building: 64 by default,
+   128 (-DCOLORS_BITS=128) for the grids beyond 64x64, which makes every
+   grid size some 20 to 35% slower (see README.md) */
+#ifndef COLORS_BITS
+#define COLORS_BITS 64
+#endif
+
+#if COLORS_BITS == 64
 typedef uint64_t colors_t;
+#elif COLORS_BITS == 128
+__extension__ typedef unsigned __int128 colors_t;
+#else
+#error "COLORS_BITS must be 64 or 128"
+#endif
+
+#define MAX_SIZE COLORS_BITS
+#define MAX_COLORS (~(colors_t) 0)
+
+/* techniques of the propagation, from the easiest to the hardest. The
+   first NB_UNIT_TECHNIQUES work on a subgrid (see subgrid_heuristics), the
+   others on the whole grid */
+#define NB_TECHNIQUES 7
+#define NB_UNIT_TECHNIQUES 5
+
+typedef enum
+{
+  technique_cross_hatching,
+  technique_lone_number,
+  technique_naked_subset,
+  technique_hidden_subset,
+  technique_alldifferent,
+  technique_fish,
+  technique_chains
+} technique_t;
 
 /* return a color with '1' on all bits within range of given size */
 colors_t colors_full(const size_t size);
@@ -58,11 +90,20 @@ colors_t colors_rightmost(const colors_t colors);
 /* return the number of bit set to '1' of a given color */
 size_t colors_count(const colors_t colors);
 
+/* return the index of the least significant bit set to '1' of a given
+   color, or MAX_SIZE if the color is empty */
+size_t colors_index(const colors_t colors);
+
 /* return a color which is the most significant bit of a given color */
 colors_t colors_leftmost(const colors_t colors);
 
-/* return a singleton taken randomly from the given color */
-colors_t colors_random(const colors_t colors);
+/* return the n-th bit set to '1' (from 0, the least significant first) of
+   a given color, or an empty color if it has not so many */
+colors_t colors_nth(const colors_t colors, const size_t n);
+
+/* return a singleton taken randomly from the given color with the given
+   generator */
+colors_t colors_random(const colors_t colors, rng_t *rng);
 
 /* check if the given subgrid is consistent */
 bool subgrid_consistency(colors_t **subgrid, const size_t size);
@@ -70,4 +111,11 @@ bool subgrid_consistency(colors_t **subgrid, const size_t size);
 /* check if the heuristics have modified the given subgrid */
 bool subgrid_heuristics(colors_t **subgrid, const size_t size);
 
+/* check if the given technique alone has modified the given subgrid */
+bool subgrid_technique(colors_t **subgrid, const size_t size,
+                       const technique_t technique);
+
+/* return the name of the given technique */
+const char *technique_name(const technique_t technique);
+
 #endif
@@ -0,0 +1,110 @@
+#include <estimate.h>
+#include <colors.h>
+#include <grid.h>
+#include <rng.h>
+#include <schedule.h>
+#include <solver.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* techniques propagating the nodes of the probes: the singles only, so that
+   an estimate costs a small part of the search it predicts */
+#define ESTIMATE_TECHNIQUES ((1u << technique_cross_hatching) | \
+                             (1u << technique_lone_number))
+
+/* go down a random path of the search tree of the given grid, which is
+   modified, and return its estimate of the number of nodes. steps is
+   increased by the number of nodes propagated */
+static double estimate_probe(grid_t *grid, schedule_t *schedule, rng_t *rng,
+                             size_t *steps)
+{
+  double weight = 1;
+  double nodes = 0;
+  choice_t *choice = NULL;
+  size_t row = 0;
+  size_t column = 0;
+  colors_t color = colors_empty();
+
+  while (true)
+  {
+    nodes = nodes + weight;
+    *steps = *steps + 1;
+    if (grid_schedule(grid, schedule))
+      return nodes;
+
+    choice = grid_choice(grid);
+    if (!choice)
+      return nodes;
+
+    grid_choice_get(choice, &row, &column, &color);
+    weight = weight * colors_count(grid_get_colors(grid, row, column));
+    grid_choice_randomize(grid, choice, rng);
+    grid_choice_apply(grid, choice);
+    grid_choice_free(choice);
+  }
+}
+
+bool grid_estimate(const grid_t *grid, solver_t *solver, const size_t probes,
+                   estimate_t *estimate)
+{
+  grid_t *path = NULL;
+  schedule_t *schedule = NULL;
+  rng_t own;
+  rng_t *rng = solver ? solver_get_rng(solver) : &own;
+  double nodes = 0;
+  size_t steps = 0;
+  uint64_t start = 0;
+
+  if (!grid_get_size(grid) || !probes || !estimate)
+    return false;
+
+  if (!solver)
+    rng_init(&own);
+
+  path = grid_copy(grid);
+  schedule = schedule_new(ESTIMATE_TECHNIQUES, false);
+  if (!path || !schedule)
+  {
+    grid_free(path);
+    schedule_free(schedule);
+
+    return false;
+  }
+
+  start = trace_clock();
+  for (size_t i = 0; i < probes; i = i + 1)
+  {
+    grid_copy_into(path, grid);
+    nodes = nodes + estimate_probe(path, schedule, rng, &steps);
+  }
+
+  estimate->probes = probes;
+  estimate->nodes = nodes / probes;
+  estimate->milliseconds = estimate->nodes * (trace_clock() - start) / steps /
+                           1e6;
+
+  grid_free(path);
+  schedule_free(schedule);
+
+  return true;
+}
+
+size_t estimate_to_line(const estimate_t *estimate, char *buffer,
+                        const size_t length)
+{
+  int written = 0;
+
+  if (!estimate || !buffer || !length)
+    return 0;
+
+  written = snprintf(buffer, length, "%.3f ms %.0f nodes",
+                     estimate->milliseconds, estimate->nodes);
+  if (written < 0 || (size_t) written >= length)
+    return 0;
+
+  return written;
+}
@@ -0,0 +1,38 @@
+#ifndef ESTIMATE_H
+#define ESTIMATE_H
+
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* number of random probes of an estimate when none is given */
+#define ESTIMATE_DEFAULT_PROBES 8
+
+/* predicted cost of the search of a grid: the number of nodes of its tree,
+   and the milliseconds they take at the pace of the probes */
+typedef struct
+{
+  double nodes;
+  double milliseconds;
+  size_t probes;
+} estimate_t;
+
+/* estimate the size of the search tree of the given grid, which is left
+   untouched, the way of Knuth: each probe goes down a random path, taking
+   the cell of grid_choice and one of its colors at random after each
+   propagation, and weights each node by the product of the numbers of
+   colors of the cells chosen above it. The estimate is the mean of the
+   given number of probes. The random generator of the given solver (may
+   be NULL) draws the colors. return false if the grid is invalid */
+bool grid_estimate(const grid_t *grid, solver_t *solver, const size_t probes,
+                   estimate_t *estimate);
+
+/* write the given estimate on a single line in the given buffer:
+     MILLISECONDS ms NODES nodes
+   return the number of char written, or 0 if the buffer is too short */
+size_t estimate_to_line(const estimate_t *estimate, char *buffer,
+                        const size_t length);
+
+#endif /* ESTIMATE_H */
@@ -0,0 +1,142 @@
+#include <fish.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/* positions of one color in the grid: lines[ROW][r] holds the columns of
+   row r where the color may be, lines[COL][c] the rows of column c */
+typedef struct
+{
+  grid_t *grid;
+  colors_t *cells;
+  size_t size;
+  size_t order;
+  size_t color;
+  colors_t lines[NB_SUBGRID_TYPE][MAX_GRID_SIZE];
+} fish_t;
+
+/* discard the color of the fish from the cell at the given position of the
+   given line (of type ROW or COL) */
+static void fish_discard(fish_t *fish, const size_t type, const size_t line,
+                         const size_t position)
+{
+  size_t row = type == ROW ? line : position;
+  size_t column = type == ROW ? position : line;
+  size_t cell = row * fish->size + column;
+
+  fish->cells[cell] = colors_discard(fish->cells[cell], fish->color);
+  grid_set_colors(fish->grid, row, column, fish->cells[cell]);
+  fish->lines[ROW][row] = colors_discard(fish->lines[ROW][row], column);
+  fish->lines[COL][column] = colors_discard(fish->lines[COL][column], row);
+}
+
+/* discard the color from the cover lines, out of the base lines of a fish
+   whose base lines are of given type. return true if a cell changed */
+static bool fish_eliminate(fish_t *fish, const size_t type,
+                           const colors_t base, const colors_t cover)
+{
+  size_t cross = type == ROW ? COL : ROW;
+  colors_t lines = cover;
+  colors_t others = colors_empty();
+  size_t line = 0;
+  bool alteration = false;
+
+  for (; lines; lines = colors_xor(lines, colors_rightmost(lines)))
+  {
+    line = colors_index(lines);
+    for (others = colors_subtract(fish->lines[cross][line], base); others;
+         others = colors_xor(others, colors_rightmost(others)))
+    {
+      fish_discard(fish, cross, line, colors_index(others));
+      alteration = true;
+    }
+  }
+
+  return alteration;
+}
+
+/* look for the fishes whose base lines, of given type, are the lines of
+   base and some lines from the given one, covered by the lines of cover.
+   return the number of fishes which discarded a color */
+static size_t fish_search(fish_t *fish, const size_t type, const size_t from,
+                          const size_t depth, const colors_t base,
+                          const colors_t cover)
+{
+  size_t count = 0;
+  size_t nb_covers = 0;
+  colors_t line = colors_empty();
+  colors_t lines = colors_empty();
+
+  for (size_t i = from; i < fish->size; i = i + 1)
+  {
+    line = fish->lines[type][i];
+    nb_covers = colors_count(line);
+    if (nb_covers < 2 || nb_covers > fish->order)
+      continue;
+
+    lines = colors_or(cover, line);
+    nb_covers = colors_count(lines);
+    if (nb_covers > fish->order)
+      continue;
+
+/* a fish of depth + 1 lines, its larger supersets are not looked for */
+    if (depth && nb_covers == depth + 1)
+    {
+      if (fish_eliminate(fish, type, colors_add(base, i), lines))
+        count = count + 1;
+
+      continue;
+    }
+
+    if (depth + 1 < fish->order)
+      count = count + fish_search(fish, type, i + 1, depth + 1,
+                                  colors_add(base, i), lines);
+  }
+
+  return count;
+}
+
+size_t grid_fish(grid_t *grid, const size_t order)
+{
+  colors_t cells[MAX_GRID_SIZE * MAX_GRID_SIZE];
+  fish_t fish;
+  size_t size = grid_get_size(grid);
+  size_t count = 0;
+
+  if (size < 4 || order < 2)
+    return 0;
+
+  fish.grid = grid;
+  fish.cells = cells;
+  fish.size = size;
+  fish.order = order < size / 2 ? order : size / 2;
+  if (fish.order > FISH_MAX_ORDER)
+    fish.order = FISH_MAX_ORDER;
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+      cells[i * size + j] = grid_get_colors(grid, i, j);
+
+  for (fish.color = 0; fish.color < size; fish.color = fish.color + 1)
+  {
+    memset(fish.lines[ROW], 0, size * sizeof(colors_t));
+    memset(fish.lines[COL], 0, size * sizeof(colors_t));
+    for (size_t i = 0; i < size; i = i + 1)
+      for (size_t j = 0; j < size; j = j + 1)
+        if (colors_is_in(cells[i * size + j], fish.color))
+        {
+          fish.lines[ROW][i] = colors_add(fish.lines[ROW][i], j);
+          fish.lines[COL][j] = colors_add(fish.lines[COL][j], i);
+        }
+
+    count = count + fish_search(&fish, ROW, 0, 0, colors_empty(),
+                                colors_empty());
+    count = count + fish_search(&fish, COL, 0, 0, colors_empty(),
+                                colors_empty());
+  }
+
+  return count;
+}
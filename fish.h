@@ -0,0 +1,23 @@
+#ifndef FISH_H
+#define FISH_H
+
+#include <grid.h>
+
+#include <stddef.h>
+
+/* order of the largest fish looked for by default: 2 (X-Wing), 3
+   (Swordfish), 4 (Jellyfish) */
+#define FISH_DEFAULT_ORDER 4
+
+/* a fish of order n has a complementary one of order size - n, so no
+   larger order is ever needed */
+#define FISH_MAX_ORDER (MAX_GRID_SIZE / 2)
+
+/* look for the fishes of the given grid up to the given order: for a
+   color, n rows (or columns) whose cells of this color all lie in the same
+   n columns (or rows). The color is then discarded from the other cells of
+   these columns (or rows). return the number of fishes which discarded a
+   color */
+size_t grid_fish(grid_t *grid, const size_t order);
+
+#endif /* FISH_H */
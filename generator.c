@@ -0,0 +1,115 @@
+#include <generator.h>
+#include <colors.h>
+#include <grid.h>
+#include <rng.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/* maximum number of nodes spent to prove the uniqueness of one removal */
+#define UNIQUE_BUDGET 4096
+
+/* bytes of the transposition table shared by the uniqueness checks: the
+   grids of two checks only differ by one cell, so their searches meet the
+   same states again */
+#define GENERATOR_TABLE_SIZE (1 << 22)
+
+/* return a random solved grid of the given size */
+static grid_t *grid_fill(solver_t *solver, const size_t size)
+{
+  grid_t *empty = grid_alloc(size);
+  if (!empty)
+    return NULL;
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+      grid_set_cell(empty, i, j, EMPTY_CELL);
+
+  solver_set_mode(solver, mode_first);
+  solver_set_random(solver, true);
+  solver_run(solver, empty);
+  solver_set_random(solver, false);
+  grid_free(empty);
+
+  return solver_take_solution(solver);
+}
+
+/* check if the given grid has exactly one solution within the budget */
+static bool grid_is_unique(solver_t *solver, const grid_t *grid)
+{
+  solver_set_mode(solver, mode_count);
+  solver_set_limit(solver, 2);
+  solver_set_budget(solver, UNIQUE_BUDGET, 0);
+
+  return solver_run(solver, grid) == outcome_solved &&
+         solver_get_count(solver) == 1;
+}
+
+grid_t *grid_generate(const size_t size, const bool unique)
+{
+  return grid_generate_from(size, unique, NULL);
+}
+
+grid_t *grid_generate_from(const size_t size, const bool unique, rng_t *rng)
+{
+  grid_t *grid = NULL;
+  solver_t *solver = NULL;
+  size_t *cells = NULL;
+  size_t nb_cells = size * size;
+  size_t nb_clues = nb_cells;
+  size_t swap = 0;
+  size_t where = 0;
+  colors_t colors = colors_empty();
+
+  if (!grid_check_size(size))
+    return NULL;
+
+  solver = solver_new(mode_first);
+  solver_set_table(solver, GENERATOR_TABLE_SIZE);
+  cells = calloc(nb_cells, sizeof(size_t));
+  if (!solver || !cells)
+    goto generate_end;
+
+  rng_fork(rng, solver_get_rng(solver));
+  grid = grid_fill(solver, size);
+  if (!grid)
+    goto generate_end;
+
+/* visit the cells in a random order */
+  for (size_t i = 0; i < nb_cells; i = i + 1)
+    cells[i] = i;
+
+  for (size_t i = nb_cells; i > 1; i = i - 1)
+  {
+    where = rng_below(solver_get_rng(solver), i);
+    swap = cells[i - 1];
+    cells[i - 1] = cells[where];
+    cells[where] = swap;
+  }
+
+  for (size_t i = 0; i < nb_cells && size > 1; i = i + 1)
+  {
+/* without uniqueness, a third of the cells are kept as clues */
+    if (!unique && nb_clues <= nb_cells / 3)
+      break;
+
+    where = cells[i];
+    colors = grid_get_colors(grid, where / size, where % size);
+    grid_set_cell(grid, where / size, where % size, EMPTY_CELL);
+
+    if (unique && !grid_is_unique(solver, grid))
+      grid_set_colors(grid, where / size, where % size, colors);
+    else
+      nb_clues = nb_clues - 1;
+  }
+
+  generate_end:
+  {
+    free(cells);
+    solver_free(solver);
+
+    return grid;
+  }
+}
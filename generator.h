@@ -0,0 +1,19 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <grid.h>
+#include <rng.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* return a new grid of the given size, filled randomly then emptied of part
+   of its cells. If unique is true, a cell is only emptied when the grid keeps
+   a unique solution. return NULL if the size is not allowed */
+grid_t *grid_generate(const size_t size, const bool unique);
+
+/* same as grid_generate, with random numbers drawn from the given generator
+   (if NULL, from a generator initialized by rng_init) */
+grid_t *grid_generate_from(const size_t size, const bool unique, rng_t *rng);
+
+#endif /* GENERATOR_H */
@@ -1,6 +1,10 @@
 #include <grid.h>
+#include <arena.h>
+#include <chains.h>
 #include <colors.h>
+#include <fish.h>
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -8,11 +12,16 @@
 #include <stdint.h>
 #include <string.h>
 
-/* Interal structure (hiden from outside) to represent a sudoku grid */
+/* Interal structure (hiden from outside) to represent a sudoku grid. The
+   cells are stored row by row right after the structure */
 struct _grid_t
 {
   size_t size;
-  colors_t **cells;
+  bool in_arena;
+  bool hashing;
+  uint64_t hash;
+  uint64_t check;
+  colors_t cells[];
 };
 
 struct choice_t
@@ -20,8 +29,94 @@ struct choice_t
   size_t row;
   size_t column;
   colors_t color;
+  bool in_arena;
 };
 
+/* units of every allowed size, as indexes in the cells of a grid: for each
+   subgrid type, size units of size cells. Computed once, shared by all */
+static uint16_t unit_table[MAX_GRID_SQRT + 1]
+                          [NB_SUBGRID_TYPE * MAX_GRID_SIZE * MAX_GRID_SIZE];
+static pthread_once_t unit_once = PTHREAD_ONCE_INIT;
+
+/* Zobrist key of the given color index in the given cell: the hash of a
+   grid is the xor of a key of its size and of the keys of every color still
+   possible in every open cell (with two colors or more), so that, once
+   enabled on a grid, it follows each modification of a cell at the cost of
+   the colors it changes. The fixed cells are left out: once their colors
+   are crossed out of their units, the completions of a grid only depend on
+   its open cells, which different choices can leave alike. Drawn by
+   splitmix64 from a fixed seed, and computed when needed, so that only the
+   hashed grids pay for them. Each stream of keys gives its own hash of the
+   grid: the keys of stream 1, drawn past those of stream 0, make the check
+   of the grid */
+static inline uint64_t zobrist_key(const size_t stream, const size_t cell,
+                                   const size_t index)
+{
+  uint64_t z = 0x9E3779B97F4A7C15ULL *
+               (((uint64_t) stream * (MAX_GRID_SIZE * MAX_GRID_SIZE + 2) +
+                 cell) * MAX_SIZE + index + 2);
+
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+  return z ^ (z >> 31);
+}
+
+/* xor the given hash and check with the keys of the given colors in the
+   given cell, of stream 0 and 1 respectively */
+static void zobrist_xor(uint64_t *hash, uint64_t *check, const size_t cell,
+                        colors_t colors)
+{
+  colors_t color = colors_empty();
+
+  while (colors)
+  {
+    color = colors_rightmost(colors);
+    colors = colors_xor(colors, color);
+    *hash = *hash ^ zobrist_key(0, cell, colors_index(color));
+    *check = *check ^ zobrist_key(1, cell, colors_index(color));
+  }
+}
+
+/* return the colors of a cell which count in the hash of its grid: none
+   once it is fixed */
+static colors_t zobrist_colors(const colors_t colors)
+{
+  return colors_is_singleton(colors) ? colors_empty() : colors;
+}
+
+/* set the given cell of the given grid to the given colors and update the
+   hash and the check with the colors which changed */
+static void grid_cell_update(grid_t *grid, const size_t cell,
+                             const colors_t colors)
+{
+  if (grid->hashing)
+    zobrist_xor(&grid->hash, &grid->check, cell,
+                colors_xor(zobrist_colors(grid->cells[cell]),
+                           zobrist_colors(colors)));
+
+  grid->cells[cell] = colors;
+}
+
+/* update the hash of the given grid after the cells of the given subgrid
+   were modified behind its back, the previous colors being in saved */
+static void grid_subgrid_rehash(grid_t *grid, colors_t **subgrid,
+                                const colors_t *saved)
+{
+  colors_t colors = colors_empty();
+
+  for (size_t i = 0; i < grid->size; i = i + 1)
+    if (!colors_is_equal(*subgrid[i], saved[i]))
+    {
+      colors = *subgrid[i];
+      *subgrid[i] = saved[i];
+      grid_cell_update(grid, subgrid[i] - grid->cells, colors);
+    }
+}
+
+/* length of the string of the colors of a cell (see grid_cell_string) */
+#define CELL_STRING_LENGTH (4 * MAX_SIZE + 1)
+
 void fill_row(size_t size, FILE *f, char *row)
 {
   if (!f || !row || !grid_check_size(size))
@@ -36,6 +131,11 @@ void fill_row(size_t size, FILE *f, char *row)
       {
         case ' ':
         case '\t':
+            if (i && row[i - 1] != ' ' && i < GRID_ROW_LENGTH(size) - 1)
+            {
+              row[i] = ' ';
+              i = i + 1;
+            }
             c = getc(f);
           break;
 
@@ -49,42 +149,139 @@ void fill_row(size_t size, FILE *f, char *row)
           break;
 
         default:
-            if (c != '\n' && i < size + 1)
+            if (c != '\n' && i < GRID_ROW_LENGTH(size) - 1)
             {
               row[i] = c;
               i = i + 1;
-              c = getc(f);
             }
+            c = getc(f);
       }
 
+  if (i && row[i - 1] == ' ')
+    i = i - 1;
+
   row[i] = '\0';
 }
 
-bool check_row(char *row, char *who)
+/* return the number of chars of the given text which are not blanks, up to
+   its end or its first '\n' */
+static size_t text_chars(const char *text)
+{
+  size_t count = 0;
+
+  for (size_t i = 0; text[i] != '\0' && text[i] != '\n'; i = i + 1)
+    if (text[i] != ' ' && text[i] != '\t')
+      count = count + 1;
+
+  return count;
+}
+
+/* return the number of words separated by blanks of the given text, up to
+   its end or its first '\n' */
+static size_t text_words(const char *text)
+{
+  size_t count = 0;
+  bool blank = true;
+
+  for (size_t i = 0; text[i] != '\0' && text[i] != '\n'; i = i + 1)
+  {
+    if (blank && text[i] != ' ' && text[i] != '\t')
+      count = count + 1;
+
+    blank = text[i] == ' ' || text[i] == '\t';
+  }
+
+  return count;
+}
+
+/* read the word of the given text starting at *from as the colors of a cell
+   of a grid of given size: EMPTY_CELL or a number from 1. *from is moved
+   past the word and the blanks after it. return false if the word is not a
+   cell, *from is then left on it */
+static bool text_cell(const char *text, size_t *from, const size_t size,
+                      colors_t *colors)
 {
-  char list_total[66];
-  size_t size = strlen(row);
-  char *s = calloc(2, sizeof(char));
-  if (!s)
+  size_t i = *from;
+  size_t number = 0;
+
+  if (text[i] == EMPTY_CELL)
+  {
+    *colors = colors_full(size);
+    i = i + 1;
+  }
+  else
+  {
+    for (; text[i] >= '0' && text[i] <= '9' && number <= size; i = i + 1)
+      number = number * 10 + (text[i] - '0');
+
+    if (!number || number > size)
+      return false;
+
+    *colors = colors_set(number - 1);
+  }
+
+  if (text[i] != ' ' && text[i] != '\t' && text[i] != '\n' &&
+      text[i] != '\0')
     return false;
-  
+
+  while (text[i] == ' ' || text[i] == '\t')
+    i = i + 1;
+
+  *from = i;
+
+  return true;
+}
+
+size_t row_size(const char *row)
+{
+  size_t size = 0;
+
+  if (!row)
+    return 0;
+
+  size = text_chars(row);
+  if (size <= MAX_CHAR_SIZE)
+    return size;
+
+  return text_words(row);
+}
+
+bool check_row(char *row, char *who)
+{
+  char list_total[MAX_CHAR_SIZE + 2];
+  size_t size = row_size(row);
+  size_t i = 0;
+  colors_t colors = colors_empty();
+  char s[2] = {'\0', '\0'};
+
+  if (size > MAX_CHAR_SIZE)
+  {
+    while (row[i] != '\0')
+      if (!text_cell(row, &i, size, &colors))
+      {
+        *who = row[i];
+
+        return false;
+      }
+
+    return true;
+  }
+
   strcpy(list_total, color_table);
   list_total[size] = EMPTY_CELL;
   list_total[size + 1] = '\0';
 
-  for (size_t i = 0; i < size; i = i + 1)
+  for (i = 0; row[i] != '\0'; i = i + 1)
   {
     s[0] = row[i];
     s[1] = '\0';
-    if (!strspn(s,list_total))
+    if (row[i] != ' ' && !strspn(s,list_total))
     {
       *who = row[i];
-      free(s);
 
       return false;
     }
   }
-  free(s);
 
   return true; 
 }
@@ -92,6 +289,8 @@ bool check_row(char *row, char *who)
 long push_row(grid_t *grid, char *row, size_t nb_row)
 {
   size_t size = grid_get_size(grid);
+  size_t where = 0;
+  colors_t colors = colors_empty();
 
   if (!size || !row)
     return -1;
@@ -103,7 +302,21 @@ long push_row(grid_t *grid, char *row, size_t nb_row)
     return(nb_row + 1);
 
   for (size_t i = 0; i < size; i = i + 1)
-    grid_set_cell(grid, nb_row, i, row[i]);
+  {
+    if (size > MAX_CHAR_SIZE)
+    {
+      if (text_cell(row, &where, size, &colors))
+        grid_cell_update(grid, nb_row * size + i, colors);
+
+      continue;
+    }
+
+    while (row[where] == ' ')
+      where = where + 1;
+
+    grid_set_cell(grid, nb_row, i, row[where]);
+    where = where + 1;
+  }
   
   return(nb_row +1);  
 }
@@ -115,38 +328,40 @@ grid_t *grid_alloc(size_t size)
   if (!grid_check_size(size))
     return NULL;
 
-  grid = calloc(1, sizeof(grid_t));
+  grid = calloc(1, sizeof(grid_t) + size * size * sizeof(colors_t));
   if (!grid)
     return NULL;
 
-  grid->cells = calloc(size, sizeof(colors_t *));
-  if (!grid || !grid->cells)
+  grid->size = size;
+
+  return grid;
+
+}
+
+grid_t *grid_alloc_in(arena_t *arena, size_t size)
+{
+  grid_t *grid = NULL;
+
+  if (!grid_check_size(size))
+    return NULL;
+
+  grid = arena_alloc(arena, sizeof(grid_t) + size * size * sizeof(colors_t));
+  if (!grid)
     return NULL;
-  
-  for (size_t i = 0; i < size; i = i + 1)
-  {
-    grid->cells[i] = calloc(size, sizeof(colors_t));
-    if (!grid->cells[i])
-      return NULL;
-  }
 
   grid->size = size;
+  grid->in_arena = true;
 
   return grid;
-
 }
 
 void grid_free(grid_t *grid)
 {
   size_t size = grid_get_size(grid);
 
-  if (!size)
+  if (!size || grid->in_arena)
     return;
 
-  for (size_t i = 0; i < size; i = i + 1)
-    free(grid->cells[i]);
-  
-  free(grid->cells);
   free(grid);
 }
 
@@ -158,11 +373,84 @@ size_t grid_get_size(const grid_t *grid)
   return grid->size;
 }
 
+size_t grid_color_name(const size_t size, const size_t color, char *buffer)
+{
+  if (size <= MAX_CHAR_SIZE)
+  {
+    buffer[0] = color_table[color];
+    buffer[1] = '\0';
+
+    return 1;
+  }
+
+  return snprintf(buffer, 4, "%zu", color + 1);
+}
+
+bool grid_color_from_name(const size_t size, const char *name, size_t *color)
+{
+  const char *found = NULL;
+  char *end = NULL;
+  size_t number = 0;
+
+  if (!name || !color || !size)
+    return false;
+
+  if (size <= MAX_CHAR_SIZE)
+  {
+    found = name[0] ? strchr(color_table, name[0]) : NULL;
+    if (!found || name[1] != '\0' || (size_t) (found - color_table) >= size)
+      return false;
+
+    *color = found - color_table;
+
+    return true;
+  }
+
+  number = strtoul(name, &end, 10);
+  if (end == name || *end != '\0' || !number || number > size)
+    return false;
+
+  *color = number - 1;
+
+  return true;
+}
+
+/* write the colors of the given cell of the given grid in the given buffer,
+   which must hold CELL_STRING_LENGTH char, the numbers of the colors of the
+   grids beyond MAX_CHAR_SIZE being separated by ','. return the number of
+   colors */
+static size_t grid_cell_string(const grid_t *grid, const size_t row,
+                               const size_t column, char *str_color)
+{
+  colors_t color_less = colors_empty();
+  colors_t colors_box = grid->cells[row * grid->size + column];
+  size_t nb_colors = colors_count(colors_box);
+  size_t length = 0;
+
+  for (size_t i = 0; i < nb_colors; i = i + 1)
+  {
+    color_less = colors_rightmost(colors_box);
+    colors_box = colors_xor(colors_box, color_less);
+    if (i && grid->size > MAX_CHAR_SIZE)
+    {
+      str_color[length] = ',';
+      length = length + 1;
+    }
+
+    length = length + grid_color_name(grid->size, colors_index(color_less),
+                                      str_color + length);
+  }
+  str_color[length] = '\0';
+
+  return nb_colors;
+}
+
 void grid_print(const grid_t *grid, FILE *fd)
 {
 
-  char *str_color = NULL;
+  char str_color[CELL_STRING_LENGTH];
   size_t size = grid_get_size(grid);
+  size_t nb_colors = 0;
   
   if (!fd || !size)
     return;
@@ -171,16 +459,14 @@ void grid_print(const grid_t *grid, FILE *fd)
   {
     for(size_t j = 0; j < size; j = j + 1)
     {
-      str_color = grid_get_cell(grid, i, j);
-      if(!str_color)
+      nb_colors = grid_cell_string(grid, i, j, str_color);
+      if(!nb_colors)
         return;
 
-      if (strlen(str_color) == size && size > 1)
+      if (nb_colors == size && size > 1)
         fprintf(fd,"%c ", EMPTY_CELL);
       else
         fprintf(fd,"%s ", str_color);
-
-      free(str_color);
     }
 
     fprintf(fd,"%c",'\n');
@@ -190,13 +476,17 @@ void grid_print(const grid_t *grid, FILE *fd)
 bool grid_check_char(const grid_t *grid, const char c)
 {
 
-  char list_total[66];
+  char list_total[MAX_CHAR_SIZE + 2];
   size_t size = grid_get_size(grid);
   char s[2] = {c , '\0'};
   
   if (!size)
     return false;
 
+/* the chars of color_table stand for the first colors of the larger grids */
+  if (size > MAX_CHAR_SIZE)
+    size = MAX_CHAR_SIZE;
+
   strcpy(list_total, color_table);
   list_total[size] = EMPTY_CELL;
   list_total[size + 1] = '\0';
@@ -207,7 +497,11 @@ bool grid_check_char(const grid_t *grid, const char c)
 bool grid_check_size(const size_t size)
 {
   return size == 1 || size == 4 || size == 9 || size ==16 || size == 25 ||
-      size == 36 || size == 49 || size == 64;
+      size == 36 || size == 49 || size == 64
+#if MAX_GRID_SIZE > 64
+      || size == 81 || size == 100 || size == 121
+#endif
+      ;
 }
 
 grid_t *grid_copy(const grid_t *grid)
@@ -218,48 +512,68 @@ grid_t *grid_copy(const grid_t *grid)
     return NULL;
 
   grid_t *grid_cp = grid_alloc(size);
-  for (size_t i = 0; i < size; i = i + 1)
-  {
-    for(size_t j = 0; j < size; j = j + 1)
-      grid_cp->cells[i][j] = grid->cells[i][j];
-  }
+  if (!grid_cp)
+    return NULL;
+
+  memcpy(grid_cp->cells, grid->cells, size * size * sizeof(colors_t));
+  grid_cp->hashing = grid->hashing;
+  grid_cp->hash = grid->hash;
+  grid_cp->check = grid->check;
+
   return grid_cp;
 }
 
-char *grid_get_cell(const grid_t *grid, const size_t row, const size_t column)
+grid_t *grid_copy_in(arena_t *arena, const grid_t *grid)
 {
+  size_t size = grid_get_size(grid);
 
-  colors_t color_less = colors_empty();
-  colors_t colors_box = colors_empty(); 
+  if (!size)
+    return NULL;
+
+  grid_t *grid_cp = grid_alloc_in(arena, size);
+  if (!grid_cp)
+    return NULL;
+
+  memcpy(grid_cp->cells, grid->cells, size * size * sizeof(colors_t));
+  grid_cp->hashing = grid->hashing;
+  grid_cp->hash = grid->hash;
+  grid_cp->check = grid->check;
+
+  return grid_cp;
+}
+
+void grid_copy_into(grid_t *destination, const grid_t *source)
+{
+  size_t size = grid_get_size(source);
+
+  if (!size || grid_get_size(destination) != size)
+    return;
+
+  memcpy(destination->cells, source->cells, size * size * sizeof(colors_t));
+  destination->hashing = source->hashing;
+  destination->hash = source->hash;
+  destination->check = source->check;
+}
+
+char *grid_get_cell(const grid_t *grid, const size_t row, const size_t column)
+{
+  char buffer[CELL_STRING_LENGTH];
   size_t nb_colors = 0;
   size_t size = grid_get_size(grid);
   char *str_color = NULL;
-  size_t color_index = 0;
 
   if (!size || row >= size || column >= size)
     return NULL;
 
-  colors_box = grid->cells[row][column]; 
-  nb_colors = colors_count(colors_box);
+  nb_colors = grid_cell_string(grid, row, column, buffer);
   if (!nb_colors)
     return NULL;
 
-  str_color = calloc(nb_colors + 1, sizeof(char));
+  str_color = calloc(strlen(buffer) + 1, sizeof(char));
   if (!str_color)
     return NULL;
 
-  for (size_t i = 0; i < nb_colors; i = i + 1)
-  {
-    color_index = 0;
-    color_less = colors_rightmost(colors_box);
-    colors_box = colors_xor(colors_box, color_less);
-
-    while(color_less >>= 1)
-      color_index = color_index + 1;
-    
-    str_color[i] = color_table[color_index];
-  }
-  str_color[nb_colors] = '\0';
+  memcpy(str_color, buffer, strlen(buffer) + 1);
 
   return str_color;
 }
@@ -284,115 +598,304 @@ void grid_set_cell(grid_t *grid, const size_t row, const size_t column,
     colors_pool = colors_set(index_color);
   }
 
-  grid->cells[row][column] = colors_pool;
+  grid_cell_update(grid, row * size + column, colors_pool);
 }
 
-static size_t grid_size_sqrt(const grid_t *grid)
+colors_t grid_get_colors(const grid_t *grid, const size_t row,
+                         const size_t column)
 {
   size_t size = grid_get_size(grid);
-  size_t i = 0;
-  size_t sum = 0;
 
-  if (!size)
+  if (!size || row >= size || column >= size)
+    return colors_empty();
+
+  return grid->cells[row * size + column];
+}
+
+void grid_set_colors(grid_t *grid, const size_t row, const size_t column,
+                     const colors_t colors)
+{
+  size_t size = grid_get_size(grid);
+
+  if (!size || row >= size || column >= size)
+    return;
+
+  grid_cell_update(grid, row * size + column, colors);
+}
+
+/* set hash and check to those of the given grid computed from scratch.
+   They start from a key of its size, held by the cell past the largest
+   grid */
+static void grid_hash(const grid_t *grid, uint64_t *hash, uint64_t *check)
+{
+  *hash = zobrist_key(0, MAX_GRID_SIZE * MAX_GRID_SIZE, grid->size);
+  *check = zobrist_key(1, MAX_GRID_SIZE * MAX_GRID_SIZE, grid->size);
+
+  for (size_t i = 0; i < grid->size * grid->size; i = i + 1)
+    zobrist_xor(hash, check, i, zobrist_colors(grid->cells[i]));
+}
+
+void grid_set_hashing(grid_t *grid, const bool hashing)
+{
+  if (!grid_get_size(grid) || grid->hashing == hashing)
+    return;
+
+  grid->hashing = hashing;
+  if (hashing)
+    grid_hash(grid, &grid->hash, &grid->check);
+}
+
+uint64_t grid_get_hash(const grid_t *grid)
+{
+  uint64_t hash = 0;
+  uint64_t check = 0;
+
+  if (!grid_get_size(grid))
     return 0;
 
-  while (sum != size)
+  if (!grid->hashing)
+    grid_hash(grid, &hash, &check);
+  else
+    hash = grid->hash;
+
+  return hash;
+}
+
+uint64_t grid_get_check(const grid_t *grid)
+{
+  uint64_t hash = 0;
+  uint64_t check = 0;
+
+  if (!grid_get_size(grid))
+    return 0;
+
+  if (!grid->hashing)
+    grid_hash(grid, &hash, &check);
+  else
+    check = grid->check;
+
+  return check;
+}
+
+/* read a grid beyond MAX_CHAR_SIZE from the numbers of the given line */
+static grid_t *grid_from_words(const char *line)
+{
+  grid_t *grid = NULL;
+  size_t nb_cells = text_words(line);
+  size_t size = 1;
+  size_t where = 0;
+  colors_t colors = colors_empty();
+
+  while (size * size < nb_cells)
+    size = size + 1;
+
+  if (size * size != nb_cells || size <= MAX_CHAR_SIZE)
+    return NULL;
+
+  grid = grid_alloc(size);
+  if (!grid)
+    return NULL;
+
+  while (line[where] == ' ' || line[where] == '\t')
+    where = where + 1;
+
+  for (size_t i = 0; i < nb_cells; i = i + 1)
   {
-    sum = sum + 2*i + 1;
-    i = i + 1;
+    if (!text_cell(line, &where, size, &colors))
+    {
+      grid_free(grid);
+
+      return NULL;
+    }
+
+    grid_cell_update(grid, i, colors);
   }
 
-  return i;
+  return grid;
 }
 
-static colors_t ****subgrid_alloc(const size_t size)
+grid_t *grid_from_line(const char *line)
 {
-  colors_t ****subgrid = NULL;
-  
-  subgrid = calloc(NB_SUBGRID_TYPE, sizeof(colors_t ***));
-  if (!subgrid)
+  grid_t *grid = NULL;
+  size_t nb_cells = 0;
+  size_t size = 1;
+  size_t where = 0;
+
+  if (!line)
+    return NULL;
+
+  nb_cells = text_chars(line);
+  if (nb_cells > MAX_CHAR_SIZE * MAX_CHAR_SIZE)
+    return grid_from_words(line);
+
+  while (size * size < nb_cells)
+    size = size + 1;
+
+  if (size * size != nb_cells)
     return NULL;
 
-  for (size_t i = 0; i < NB_SUBGRID_TYPE; i = i + 1)
+  grid = grid_alloc(size);
+  if (!grid)
+    return NULL;
+
+  for (size_t i = 0; line[i] != '\0' && line[i] != '\n'; i = i + 1)
   {
-    subgrid[i] = calloc(size, sizeof(colors_t **));
-    if (!subgrid[i])
-      return NULL;
+    if (line[i] == ' ' || line[i] == '\t')
+      continue;
 
-    for (size_t j = 0; j < size; j = j + 1)
+    if (!grid_check_char(grid, line[i]))
     {
-      subgrid[i][j] = calloc(size, sizeof(colors_t *));
-      if (!subgrid[i][j])
-        return NULL;
+      grid_free(grid);
+
+      return NULL;
     }
+
+    grid_set_cell(grid, where / size, where % size, line[i]);
+    where = where + 1;
   }
 
-  return subgrid;
+  return grid;
 }
 
-static void subgrid_free(colors_t ****subgrid, const size_t size)
+/* write a grid beyond MAX_CHAR_SIZE as numbers in the given buffer */
+static size_t grid_to_words(const grid_t *grid, char *buffer,
+                            const size_t length)
 {
-  for (size_t i = 0; i < NB_SUBGRID_TYPE; i = i + 1)
+  size_t size = grid->size;
+  size_t where = 0;
+  char name[4];
+  size_t name_length = 0;
+  colors_t color = colors_empty();
+
+  for (size_t i = 0; i < size * size; i = i + 1)
   {
-    for (size_t j = 0; j < size; j = j + 1)
-      free(subgrid[i][j]);
+    color = grid->cells[i];
+    if (!colors_is_singleton(color))
+    {
+      name[0] = EMPTY_CELL;
+      name_length = 1;
+    }
+    else
+      name_length = grid_color_name(size, colors_index(color), name);
+
+    if (where + name_length + (i > 0) >= length)
+      return 0;
+
+    if (i)
+    {
+      buffer[where] = ' ';
+      where = where + 1;
+    }
 
-    free(subgrid[i]);
+    memcpy(buffer + where, name, name_length);
+    where = where + name_length;
   }
 
-  free(subgrid);
+  buffer[where] = '\0';
+
+  return where;
 }
 
-static colors_t ****get_grid_subgrid(const grid_t *grid)
+size_t grid_to_line(const grid_t *grid, char *buffer, const size_t length)
 {
-  colors_t ****subgrid = NULL;
   size_t size = grid_get_size(grid);
+  colors_t color = colors_empty();
 
-  if (!size)
-    return NULL;
+  if (!size || !buffer)
+    return 0;
 
-  subgrid = subgrid_alloc(size);
-  if (!subgrid)
-    return NULL;
+  if (size > MAX_CHAR_SIZE)
+    return grid_to_words(grid, buffer, length);
 
-/* get column subgrids */
-  for (size_t i = 0; i < size; i = i + 1)
-    for (size_t j = 0; j < size; j = j + 1)
-      subgrid[COL][i][j] = &grid->cells[j][i];
+  if (length < size * size + 1)
+    return 0;
 
-/* get row row subgrids */
   for (size_t i = 0; i < size; i = i + 1)
     for (size_t j = 0; j < size; j = j + 1)
-      subgrid[ROW][i][j] = &grid->cells[i][j];
+    {
+      color = grid->cells[i * size + j];
+      if (!colors_is_singleton(color))
+        buffer[i * size + j] = EMPTY_CELL;
+      else
+        buffer[i * size + j] = color_table[colors_index(color)];
+    }
 
-/* get block subgrids */
-  size_t where = 0;
-  size_t col_start = 0;
-  size_t row_start= 0;
-  colors_t sqrt = grid_size_sqrt(grid);
+  buffer[size * size] = '\0';
 
-  if (!sqrt)
-  {
-    subgrid_free(subgrid, size);
+  return size * size;
+}
 
-    return NULL;
+static size_t grid_size_sqrt(const grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  size_t i = 0;
+  size_t sum = 0;
+
+  if (!size)
+    return 0;
+
+  while (sum != size)
+  {
+    sum = sum + 2*i + 1;
+    i = i + 1;
   }
 
-  for (size_t i = 0; i < size; i = i + 1)
+  return i;
+}
+
+static void unit_init(void)
+{
+  size_t size = 0;
+  uint16_t *table = NULL;
+
+  for (size_t sqrt = 1; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
   {
-    where = 0;
-    col_start = (i % sqrt) * sqrt;
-    row_start = i - (i % sqrt);
-    for (size_t j = 0; j < sqrt; j = j + 1)
-      for (size_t k = 0; k < sqrt; k = k + 1)
+    size = sqrt * sqrt;
+    table = unit_table[sqrt];
+
+    for (size_t i = 0; i < size; i = i + 1)
+      for (size_t j = 0; j < size; j = j + 1)
       {
-        subgrid[BLOCK][i][where] = &grid->cells[row_start + j][col_start + k];
-        where = where + 1;
+        table[(COL * size + i) * size + j] = j * size + i;
+        table[(ROW * size + i) * size + j] = i * size + j;
+        table[(BLOCK * size + i) * size + j] =
+          (i - i % sqrt + j / sqrt) * size + (i % sqrt) * sqrt + j % sqrt;
       }
-
   }
+}
 
-  return subgrid;
+/* return the unit table of the given grid */
+static const uint16_t *grid_units(const grid_t *grid)
+{
+  size_t sqrt = grid_size_sqrt(grid);
+
+  if (!sqrt || sqrt > MAX_GRID_SQRT)
+    return NULL;
+
+  pthread_once(&unit_once, unit_init);
+
+  return unit_table[sqrt];
+}
+
+/* fill the given subgrid with pointers on the cells of the given unit */
+static void grid_subgrid(grid_t *grid, const uint16_t *units,
+                         const size_t unit, colors_t **subgrid)
+{
+  size_t size = grid->size;
+
+  for (size_t i = 0; i < size; i = i + 1)
+    subgrid[i] = &grid->cells[units[unit * size + i]];
+}
+
+size_t grid_count_colors(const grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  size_t count = 0;
+
+  for (size_t i = 0; i < size * size; i = i + 1)
+    count = count + colors_count(grid->cells[i]);
+
+  return count;
 }
 
 bool grid_is_solved(grid_t *grid)
@@ -403,7 +906,7 @@ bool grid_is_solved(grid_t *grid)
 
   for (size_t i = 0; i < size; i = i + 1)
     for (size_t j = 0; j < size; j = j + 1)
-      if (!colors_is_singleton(grid->cells[i][j]))
+      if (!colors_is_singleton(grid->cells[i * size + j]))
         return false;
 
   return true;
@@ -413,15 +916,16 @@ bool grid_is_consistent(grid_t *grid)
 {
   bool consistency = true;
   size_t size = grid_get_size(grid);
-  colors_t ****subgrid = get_grid_subgrid(grid);
-  if (!subgrid)
+  const uint16_t *units = grid_units(grid);
+  colors_t *subgrid[MAX_GRID_SIZE];
+  if (!units)
     return false;
 
-  for (size_t i = 0; i < NB_SUBGRID_TYPE; i = i + 1)
-    for (size_t j = 0; j < size; j = j + 1)
-      consistency = consistency && subgrid_consistency(subgrid[i][j], size);
-
-  subgrid_free(subgrid, size);
+  for (size_t i = 0; i < NB_SUBGRID_TYPE * size && consistency; i = i + 1)
+  {
+    grid_subgrid(grid, units, i, subgrid);
+    consistency = subgrid_consistency(subgrid, size);
+  }
 
   return consistency;
 }
@@ -430,20 +934,27 @@ size_t grid_heuristics(grid_t *grid)
 {
   bool alteration = true;
   size_t size = grid_get_size(grid);
-  colors_t ****subgrid = get_grid_subgrid(grid);
-  if (!subgrid)
+  const uint16_t *units = grid_units(grid);
+  colors_t *subgrid[MAX_GRID_SIZE];
+  colors_t saved[MAX_GRID_SIZE];
+  if (!units)
     return 2;
 
   while(alteration)
   {
     alteration = false;
 
-    for (size_t i = 0; i < NB_SUBGRID_TYPE; i = i + 1)
-      for (size_t j = 0; j < size; j = j + 1)
-        alteration = alteration || subgrid_heuristics(subgrid[i][j], size);
-  }
+    for (size_t i = 0; i < NB_SUBGRID_TYPE * size && !alteration; i = i + 1)
+    {
+      grid_subgrid(grid, units, i, subgrid);
+      for (size_t j = 0; j < size && grid->hashing; j = j + 1)
+        saved[j] = *subgrid[j];
 
-  subgrid_free(subgrid, size);
+      alteration = subgrid_heuristics(subgrid, size);
+      if (alteration && grid->hashing)
+        grid_subgrid_rehash(grid, subgrid, saved);
+    }
+  }
 
   if (!grid_is_consistent(grid))
     return 2;
@@ -454,8 +965,45 @@ size_t grid_heuristics(grid_t *grid)
   return 1;
 }
 
+size_t grid_technique(grid_t *grid, const technique_t technique)
+{
+  size_t count = 0;
+  size_t size = grid_get_size(grid);
+  const uint16_t *units = grid_units(grid);
+  colors_t *subgrid[MAX_GRID_SIZE];
+  colors_t saved[MAX_GRID_SIZE];
+  if (!units)
+    return 0;
+
+  if (technique == technique_fish)
+    return grid_fish(grid, FISH_DEFAULT_ORDER);
+
+  if (technique == technique_chains)
+    return grid_chains(grid, CHAINS_DEFAULT_LENGTH);
+
+  for (size_t i = 0; i < NB_SUBGRID_TYPE * size; i = i + 1)
+  {
+    grid_subgrid(grid, units, i, subgrid);
+    for (size_t j = 0; j < size && grid->hashing; j = j + 1)
+      saved[j] = *subgrid[j];
+
+    if (subgrid_technique(subgrid, size, technique))
+    {
+      if (grid->hashing)
+        grid_subgrid_rehash(grid, subgrid, saved);
+
+      count = count + 1;
+    }
+  }
+
+  return count;
+}
+
 void grid_choice_free(choice_t *choice)
 {
+  if (!choice || choice->in_arena)
+    return;
+
   free(choice);
 }
 
@@ -473,7 +1021,8 @@ void grid_choice_apply(grid_t *grid, const choice_t *choice)
   if (choice->row >= size || choice->column >= size)
     return;
 
-  grid->cells[choice->row][choice->column] = choice->color;   
+  grid_cell_update(grid, choice->row * size + choice->column,
+                   choice->color);
 }
 
 void grid_choice_blank(grid_t *grid, const choice_t *choice)
@@ -485,7 +1034,8 @@ void grid_choice_blank(grid_t *grid, const choice_t *choice)
   if (choice->row >= size || choice->column >= size)
     return;
 
-  grid->cells[choice->row][choice->column] = colors_full(size);   
+  grid_cell_update(grid, choice->row * size + choice->column,
+                   colors_full(size));
 }
 
 void grid_choice_discard(grid_t *grid, const choice_t *choice)
@@ -499,7 +1049,24 @@ void grid_choice_discard(grid_t *grid, const choice_t *choice)
   if (r >= size || c >= size)
     return;
 
-  grid->cells[r][c] = colors_subtract(grid->cells[r][c], choice->color);   
+  grid_cell_update(grid, r * size + c,
+                   colors_subtract(grid->cells[r * size + c], choice->color));
+}
+
+void grid_choice_get(const choice_t *choice, size_t *row, size_t *column,
+                     colors_t *color)
+{
+  if (!choice)
+    return;
+
+  if (row)
+    *row = choice->row;
+
+  if (column)
+    *column = choice->column;
+
+  if (color)
+    *color = choice->color;
 }
 
 void grid_choice_print(const choice_t *choice, FILE *fd)
@@ -516,48 +1083,100 @@ void grid_choice_print(const choice_t *choice, FILE *fd)
   fprintf(fd,"Next choice at grid[%ld][%ld] is %c\n",choice->row, choice->column, color_table[color_index]);
 }
 
-choice_t *grid_choice(grid_t *grid)
+void grid_choice_randomize(const grid_t *grid, choice_t *choice, rng_t *rng)
 {
   size_t size = grid_get_size(grid);
-  if (!size)
-    return NULL;
-  
-  choice_t *choice = NULL;
-  choice = calloc(1, sizeof(choice_t));
+  if (!size || !choice)
+    return;
+
+  if (choice->row >= size || choice->column >= size)
+    return;
+
+  choice->color = colors_random(grid->cells[choice->row * size +
+                                            choice->column], rng);
+}
+
+/* fill the given choice with the coordinate and the rightmost color of the
+   first cell with the least number of color in a given grid. return false
+   if every cell is a singleton */
+static bool grid_choice_fill(grid_t *grid, choice_t *choice)
+{
+  size_t size = grid->size;
   size_t min_number_color = size + 1;
   size_t nb_colors = 0;
   colors_t choix = 0;
 
-  for (size_t i = 0; i < size; i = i + 1)
-    for (size_t j = 0; j < size; j = j + 1)
+  for (size_t i = 0; i < size * size; i = i + 1)
+  {
+    choix = grid->cells[i];
+    if (!colors_is_singleton(choix))
     {
-      choix = grid->cells[i][j];
-      if (!colors_is_singleton(choix))
+      nb_colors = colors_count(choix);
+      if (nb_colors < min_number_color)
       {
-        nb_colors = colors_count(choix);
-        if (nb_colors <= min_number_color)
-          min_number_color = nb_colors;
-
+        min_number_color = nb_colors;
+        choice->row = i / size;
+        choice->column = i % size;
+        choice->color = colors_rightmost(choix);
       }
     }
+  }
+
+  return min_number_color <= size;
+}
 
-  if (min_number_color > size)
+choice_t *grid_choice(grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  if (!size)
+    return NULL;
+  
+  choice_t *choice = calloc(1, sizeof(choice_t));
+  if (!choice)
     return NULL;
 
-  for (size_t i = 0; i < size; i = i + 1)
-    for (size_t j = 0; j < size; j = j + 1)
-    {
-      choix = grid->cells[i][j];
-      nb_colors = colors_count(choix);
-      if (nb_colors == min_number_color && grid_choice_is_empty(choice))
-      {
-        choice->row = i;
-        choice->column = j;
-        choice->color = colors_rightmost(choix);
-      }
+  if (!grid_choice_fill(grid, choice))
+  {
+    free(choice);
 
-    }
+    return NULL;
+  }
 
   return choice;
-  
+}
+
+choice_t *grid_choice_in(arena_t *arena, grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  if (!size)
+    return NULL;
+
+  choice_t *choice = arena_alloc(arena, sizeof(choice_t));
+  if (!choice)
+    return NULL;
+
+  choice->in_arena = true;
+  if (!grid_choice_fill(grid, choice))
+    return NULL;
+
+  return choice;
+}
+
+choice_t *grid_choice_new_in(arena_t *arena)
+{
+  choice_t *choice = arena_alloc(arena, sizeof(choice_t));
+  if (!choice)
+    return NULL;
+
+  choice->in_arena = true;
+
+  return choice;
+}
+
+bool grid_choice_update(grid_t *grid, choice_t *choice)
+{
+  if (!grid_get_size(grid) || !choice)
+    return false;
+
+  return grid_choice_fill(grid, choice);
 }
@@ -2,29 +2,59 @@
 #define GRID_H
 
 #define EMPTY_CELL '_'
-#define MAX_GRID_SIZE 64
 #define NB_SUBGRID_TYPE 3
 
 #define COL 0
 #define ROW 1
 #define BLOCK 2
 
+#include <arena.h>
+#include <colors.h>
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
+/* the largest grids whose colors fit in a colors_t: 64x64, or 121x121 with
+   128 bits */
+#if MAX_SIZE >= 128
+#define MAX_GRID_SIZE 121
+#define MAX_GRID_SQRT 11
+#else
+#define MAX_GRID_SIZE 64
+#define MAX_GRID_SQRT 8
+#endif
+
 static const char color_table[] = 
   "123456789" "ABCDEFGHIJKLMNOPQRSTUVWXYZ" "@" "abcdefghijklmnopqrstuvwxyz"
   "&*";
 
+/* the largest grids whose colors are written with the chars of color_table.
+   The colors of the larger ones are written as numbers from 1, separated
+   by blanks, e.g "12 _ 100" */
+#define MAX_CHAR_SIZE 64
+
+/* size of the buffer filled by fill_row for a grid of given size */
+#define GRID_ROW_LENGTH(size) (4 * (size) + 2)
+
+/* size of the buffer needed by grid_to_line for a grid of given size */
+#define GRID_LINE_LENGTH(size) \
+  ((size) > MAX_CHAR_SIZE ? 4 * (size) * (size) + 1 : (size) * (size) + 1)
+
 /* Sudoku grid (forward declaration to hide the implementation) */
 typedef struct _grid_t grid_t;
 typedef struct choice_t choice_t;
 
-/* fill char in the given row from a given a given file */
+/* fill char in the given row from a given a given file, at most
+   GRID_ROW_LENGTH(size). The blanks between the cells are kept as a single
+   ' ' */
 void fill_row(size_t size, FILE *f, char *row);
 
+/* return the number of cells of the given row: its chars up to
+   MAX_CHAR_SIZE of them, its numbers separated by blanks beyond */
+size_t row_size(const char *row);
+
 /* check if the given row has only allowed char, if not the given char
    is remplaced by the first disallowed char found */
 bool check_row(char *row, char *who);
@@ -38,6 +68,10 @@ long push_row(grid_t *grid, char *row, size_t nb_row);
 /* memory allocation for a grid of a given size */
 grid_t *grid_alloc(size_t size);
 
+/* memory allocation for a grid of a given size, taken from the given arena.
+   Such a grid is given back with the arena, grid_free does nothing on it */
+grid_t *grid_alloc_in(arena_t *arena, size_t size);
+
 /* free the allocated memory of given grid */
 void grid_free(grid_t *grid);
 
@@ -47,12 +81,29 @@ void grid_print(const grid_t *grid, FILE *fd);
 /* check if the given char is allowed in the given grid */
 bool grid_check_char (const grid_t *grid, const char c);
 
-/* check if the given size is acceptable i.e 1, 4, 9, 16, 25, 36, 49, 64 */
+/* check if the given size is acceptable i.e 1, 4, 9, 16, 25, 36, 49, 64,
+   and 81, 100, 121 with colors of 128 bits */
 bool grid_check_size(const size_t size);
 
 /* return a deep copy of a given grid */
 grid_t *grid_copy(const grid_t *grid);
 
+/* return a deep copy of a given grid, taken from the given arena */
+grid_t *grid_copy_in(arena_t *arena, const grid_t *grid);
+
+/* copy the cells of the source grid into the destination grid, which must
+   have the same size */
+void grid_copy_into(grid_t *destination, const grid_t *source);
+
+/* write the name of the given color (from 0) of a grid of given size in
+   the given buffer, which must hold 4 char: a char of color_table up to
+   MAX_CHAR_SIZE, a number from 1 beyond. return its length */
+size_t grid_color_name(const size_t size, const size_t color, char *buffer);
+
+/* read the given name of a color of a grid of given size, as written by
+   grid_color_name, in color. return false if it is not a color */
+bool grid_color_from_name(const size_t size, const char *name, size_t *color);
+
 /* return the colors as a string of the given cell of the given grid */
 char *grid_get_cell(const grid_t *grid, const size_t row, const size_t column);
 
@@ -64,9 +115,45 @@ size_t grid_get_size(const grid_t *grid);
 void grid_set_cell(grid_t *grid, const size_t row, const size_t column,
                    const char color);
 
+/* return the colors of the cell at the given coordinate of the given grid */
+colors_t grid_get_colors(const grid_t *grid, const size_t row,
+                         const size_t column);
+
+/* from a given grid, set the cell at given coordinate to the given colors */
+void grid_set_colors(grid_t *grid, const size_t row, const size_t column,
+                     const colors_t colors);
+
+/* keep the hash of the given grid up to date at each modification of its
+   cells, or stop doing so. The copies of the grid inherit the setting */
+void grid_set_hashing(grid_t *grid, const bool hashing);
+
+/* return the Zobrist hash of the size of the given grid and of the colors
+   of its open cells (the fixed ones are left out), computed from scratch
+   unless the grid keeps it up to date */
+uint64_t grid_get_hash(const grid_t *grid);
+
+/* return the check of the given grid: a second hash of the same colors as
+   grid_get_hash, from keys drawn apart, so that two grids whose hashes
+   collide are still told apart */
+uint64_t grid_get_check(const grid_t *grid);
+
+/* return a grid read from a single line holding all the rows one after the
+   other (blanks are ignored, except as separators of the numbers of the
+   grids beyond MAX_CHAR_SIZE), or NULL if the line is not a valid grid */
+grid_t *grid_from_line(const char *line);
+
+/* write the given grid as a single line in the given buffer of given length
+   (see GRID_LINE_LENGTH), non singleton cells are written as EMPTY_CELL.
+   return the number of char written (without the final '\0'), or 0 if the
+   buffer is too short */
+size_t grid_to_line(const grid_t *grid, char *buffer, const size_t length);
+
 /* check if the grid has only singleton */
 bool grid_is_solved(grid_t *grid);
 
+/* return the number of colors left in all the cells of the given grid */
+size_t grid_count_colors(const grid_t *grid);
+
 /* check if all subgrid of a given grid are consistent */
 bool grid_is_consistent(grid_t *grid);
 
@@ -77,6 +164,12 @@ bool grid_is_consistent(grid_t *grid);
    - '2' if the grid is not solved and inconsistent */
 size_t grid_heuristics(grid_t *grid);
 
+/* apply the given technique once to every subgrid of a given grid, and
+   return the number of subgrids it modified. The techniques on the whole
+   grid (technique_fish, technique_chains) are applied once, and return the
+   number of patterns which modified it */
+size_t grid_technique(grid_t *grid, const technique_t technique);
+
 
 
 /* free the allocated memory of given choice */
@@ -97,11 +190,30 @@ void grid_choice_blank(grid_t *grid, const choice_t *choice);
    in the given grid */
 void grid_choice_discard(grid_t *grid, const choice_t *choice);
 
+/* read the coordinate and the color of the given choice */
+void grid_choice_get(const choice_t *choice, size_t *row, size_t *column,
+                     colors_t *color);
+
 /* print the given choice's coordinate and color on the given file descriptor */
 void grid_choice_print(const choice_t *choice, FILE *fd);
 
+/* replace the color of the given choice by a color taken randomly, with the
+   given generator, among the colors of the choice's cell in the given grid */
+void grid_choice_randomize(const grid_t *grid, choice_t *choice, rng_t *rng);
+
 /* return a choice made by taking the coordinate and the rightmost color
    of the first cell with the least number of color in a given grid */
 choice_t *grid_choice(grid_t *grid);
 
+/* same as grid_choice, but the choice is taken from the given arena and is
+   given back with it */
+choice_t *grid_choice_in(arena_t *arena, grid_t *grid);
+
+/* memory allocation for an empty choice taken from the given arena */
+choice_t *grid_choice_new_in(arena_t *arena);
+
+/* fill the given choice as grid_choice would make it from the given grid.
+   return false if the grid has only singletons */
+bool grid_choice_update(grid_t *grid, choice_t *choice);
+
 #endif /* GRID_H */
@@ -0,0 +1,151 @@
+#include <histogram.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define HISTOGRAM_SUB_BUCKETS ((uint64_t) 1 << HISTOGRAM_PRECISION)
+
+/* the exact values, then the sub-buckets of each power of two from
+   2^HISTOGRAM_PRECISION to 2^63 */
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS + \
+                           (64 - HISTOGRAM_PRECISION) * HISTOGRAM_SUB_BUCKETS)
+
+/* Interal structure (hiden from outside) to represent a histogram */
+struct histogram_t
+{
+  size_t counts[HISTOGRAM_BUCKETS];
+  size_t count;
+  uint64_t max;
+  double sum;
+};
+
+histogram_t *histogram_new(void)
+{
+  return calloc(1, sizeof(histogram_t));
+}
+
+void histogram_free(histogram_t *histogram)
+{
+  free(histogram);
+}
+
+/* return the bucket of the given value: its power of two, then the
+   HISTOGRAM_PRECISION bits which follow its leading one */
+static size_t histogram_bucket(const uint64_t value)
+{
+  size_t shift = 0;
+
+  if (value < HISTOGRAM_SUB_BUCKETS)
+    return value;
+
+  shift = 63 - __builtin_clzll(value) - HISTOGRAM_PRECISION;
+
+  return HISTOGRAM_SUB_BUCKETS + shift * HISTOGRAM_SUB_BUCKETS +
+         ((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+/* return the largest value counted in the given bucket */
+static uint64_t histogram_highest(const size_t bucket)
+{
+  size_t shift = 0;
+  uint64_t sub = 0;
+
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+
+  shift = (bucket - HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS;
+  sub = (bucket - HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS;
+
+  return ((HISTOGRAM_SUB_BUCKETS + sub) << shift) +
+         (((uint64_t) 1 << shift) - 1);
+}
+
+void histogram_record(histogram_t *histogram, const uint64_t value)
+{
+  size_t bucket = histogram_bucket(value);
+
+  if (!histogram)
+    return;
+
+  histogram->counts[bucket] = histogram->counts[bucket] + 1;
+  histogram->count = histogram->count + 1;
+  histogram->sum = histogram->sum + value;
+  if (value > histogram->max)
+    histogram->max = value;
+}
+
+void histogram_merge(histogram_t *into, const histogram_t *from)
+{
+  if (!into || !from)
+    return;
+
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i = i + 1)
+    into->counts[i] = into->counts[i] + from->counts[i];
+
+  into->count = into->count + from->count;
+  into->sum = into->sum + from->sum;
+  if (from->max > into->max)
+    into->max = from->max;
+}
+
+size_t histogram_count(const histogram_t *histogram)
+{
+  if (!histogram)
+    return 0;
+
+  return histogram->count;
+}
+
+uint64_t histogram_max(const histogram_t *histogram)
+{
+  if (!histogram)
+    return 0;
+
+  return histogram->max;
+}
+
+double histogram_mean(const histogram_t *histogram)
+{
+  if (!histogram || !histogram->count)
+    return 0;
+
+  return histogram->sum / histogram->count;
+}
+
+uint64_t histogram_percentile(const histogram_t *histogram,
+                              const double percentile)
+{
+  double exact = 0;
+  size_t rank = 0;
+  size_t seen = 0;
+  uint64_t value = 0;
+
+  if (!histogram || !histogram->count)
+    return 0;
+
+/* the rank of the value looked for, from 1, rounded up */
+  exact = percentile / 100 * histogram->count;
+  rank = (size_t) exact;
+  if (rank < exact)
+    rank = rank + 1;
+
+  if (rank < 1)
+    rank = 1;
+
+  if (rank > histogram->count)
+    rank = histogram->count;
+
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i = i + 1)
+  {
+    seen = seen + histogram->counts[i];
+    if (seen >= rank)
+    {
+      value = histogram_highest(i);
+      break;
+    }
+  }
+
+  return value < histogram->max ? value : histogram->max;
+}
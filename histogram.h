@@ -0,0 +1,45 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* sub-buckets of each power of two are 2^HISTOGRAM_PRECISION, so that a
+   value is recorded within 1/128 of itself */
+#define HISTOGRAM_PRECISION 7
+
+/* Histogram of values, in the manner of the HDR histograms (forward
+   declaration to hide the implementation): the values below
+   2^HISTOGRAM_PRECISION are counted exactly, the others in the sub-buckets
+   of their power of two, so that recording is a handful of operations and
+   the memory is fixed whatever the range of the values */
+typedef struct histogram_t histogram_t;
+
+/* memory allocation for an empty histogram */
+histogram_t *histogram_new(void);
+
+/* free the allocated memory of the given histogram */
+void histogram_free(histogram_t *histogram);
+
+/* count the given value in the given histogram */
+void histogram_record(histogram_t *histogram, const uint64_t value);
+
+/* add the counts of the histogram from to the histogram into */
+void histogram_merge(histogram_t *into, const histogram_t *from);
+
+/* return the number of values recorded in the given histogram */
+size_t histogram_count(const histogram_t *histogram);
+
+/* return the largest value recorded in the given histogram, exactly */
+uint64_t histogram_max(const histogram_t *histogram);
+
+/* return the mean of the values recorded in the given histogram */
+double histogram_mean(const histogram_t *histogram);
+
+/* return the value under which the given percentile (from 0 to 100) of the
+   values of the given histogram fall, up to the precision of its bucket */
+uint64_t histogram_percentile(const histogram_t *histogram,
+                              const double percentile);
+
+#endif /* HISTOGRAM_H */
@@ -0,0 +1,373 @@
+#include <latency.h>
+#include <grid.h>
+#include <histogram.h>
+#include <solver.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* outcomes of a search, as solver_run returns them */
+#define NB_OUTCOMES 3
+
+/* percentiles reported, and their names */
+static const double percentiles[] = {50, 90, 99, 99.9};
+static const char *const percentile_names[] = {"p50", "p90", "p99", "p999"};
+#define NB_PERCENTILES (sizeof(percentiles) / sizeof(percentiles[0]))
+
+/* a line among the slowest ones */
+typedef struct
+{
+  size_t index;
+  size_t size;
+  solver_outcome_t outcome;
+  uint64_t elapsed;
+} slow_t;
+
+/* Interal structure (hiden from outside) to represent a latency report */
+struct latency_t
+{
+  uint64_t start;
+  uint64_t end;
+  size_t count;
+
+/* histograms per square root of the grid size ('0': malformed lines) and
+   outcome, made when their first line is recorded */
+  histogram_t *histograms[MAX_GRID_SQRT + 1][NB_OUTCOMES];
+
+/* lines done in each interval of the run */
+  size_t *intervals;
+  size_t nb_intervals;
+  size_t intervals_size;
+
+/* slowest lines, the slowest first */
+  slow_t *slowest;
+  size_t nb_slowest;
+  size_t slowest_size;
+};
+
+latency_t *latency_new(const size_t nb_slowest)
+{
+  latency_t *latency = calloc(1, sizeof(latency_t));
+
+  if (!latency)
+    return NULL;
+
+  if (nb_slowest)
+  {
+    latency->slowest = calloc(nb_slowest, sizeof(slow_t));
+    if (!latency->slowest)
+    {
+      free(latency);
+
+      return NULL;
+    }
+  }
+
+  latency->slowest_size = nb_slowest;
+  latency->start = trace_clock();
+  latency->end = latency->start;
+
+  return latency;
+}
+
+void latency_free(latency_t *latency)
+{
+  if (!latency)
+    return;
+
+  for (size_t i = 0; i <= MAX_GRID_SQRT; i = i + 1)
+    for (size_t j = 0; j < NB_OUTCOMES; j = j + 1)
+      histogram_free(latency->histograms[i][j]);
+
+  free(latency->intervals);
+  free(latency->slowest);
+  free(latency);
+}
+
+/* return the square root of the given grid size, '0' if it is invalid */
+static size_t latency_root(const size_t size)
+{
+  size_t root = 0;
+
+  while ((root + 1) * (root + 1) <= size)
+    root = root + 1;
+
+  if (root * root != size || root > MAX_GRID_SQRT)
+    return 0;
+
+  return root;
+}
+
+/* count a line done at the given time in its interval */
+static void latency_interval(latency_t *latency, const uint64_t end)
+{
+  size_t interval = end > latency->start ?
+                    (end - latency->start) / LATENCY_INTERVAL : 0;
+  size_t size = latency->intervals_size ? latency->intervals_size : 16;
+  size_t *intervals = NULL;
+
+  if (interval >= latency->intervals_size)
+  {
+    while (size <= interval)
+      size = 2 * size;
+
+    intervals = realloc(latency->intervals, size * sizeof(size_t));
+    if (!intervals)
+      return;
+
+    memset(intervals + latency->intervals_size, 0,
+           (size - latency->intervals_size) * sizeof(size_t));
+    latency->intervals = intervals;
+    latency->intervals_size = size;
+  }
+
+  latency->intervals[interval] = latency->intervals[interval] + 1;
+  if (interval >= latency->nb_intervals)
+    latency->nb_intervals = interval + 1;
+}
+
+/* keep the given line if it is among the slowest ones */
+static void latency_slow(latency_t *latency, const slow_t *slow)
+{
+  size_t i = latency->nb_slowest;
+
+  if (!latency->slowest_size ||
+      (i == latency->slowest_size &&
+       latency->slowest[i - 1].elapsed >= slow->elapsed))
+    return;
+
+  if (i == latency->slowest_size)
+    i = i - 1;
+  else
+    latency->nb_slowest = latency->nb_slowest + 1;
+
+  while (i && latency->slowest[i - 1].elapsed < slow->elapsed)
+  {
+    latency->slowest[i] = latency->slowest[i - 1];
+    i = i - 1;
+  }
+
+  latency->slowest[i] = *slow;
+}
+
+void latency_record(latency_t *latency, const size_t index,
+                    const size_t size, const solver_outcome_t outcome,
+                    const uint64_t end, const uint64_t elapsed)
+{
+  size_t root = latency_root(size);
+  slow_t slow = {index, size, outcome, elapsed};
+  histogram_t **histogram = NULL;
+
+  if (!latency || (size_t) outcome >= NB_OUTCOMES)
+    return;
+
+  histogram = &latency->histograms[root][outcome];
+  if (!*histogram)
+    *histogram = histogram_new();
+
+  histogram_record(*histogram, elapsed);
+  latency->count = latency->count + 1;
+  if (end > latency->end)
+    latency->end = end;
+
+  latency_interval(latency, end);
+  latency_slow(latency, &slow);
+}
+
+static const char *latency_outcome_name(const solver_outcome_t outcome)
+{
+  switch (outcome)
+  {
+    case outcome_solved:
+      return "solved";
+
+    case outcome_unsolvable:
+      return "unsolvable";
+
+    case outcome_budget:
+      return "budget";
+  }
+
+  return "unknown";
+}
+
+/* return the histogram of all the lines of the given report, to be freed by
+   the caller, or NULL */
+static histogram_t *latency_total(const latency_t *latency)
+{
+  histogram_t *total = histogram_new();
+
+  if (!total)
+    return NULL;
+
+  for (size_t i = 0; i <= MAX_GRID_SQRT; i = i + 1)
+    for (size_t j = 0; j < NB_OUTCOMES; j = j + 1)
+      histogram_merge(total, latency->histograms[i][j]);
+
+  return total;
+}
+
+/* return the duration of the run of the given report, in seconds */
+static double latency_seconds(const latency_t *latency)
+{
+  return (latency->end - latency->start) / 1e9;
+}
+
+/* return the number of lines per second done in the given interval of the
+   given report. The last interval only lasts up to the end of the run */
+static double latency_throughput(const latency_t *latency,
+                                 const size_t interval)
+{
+  uint64_t from = interval * LATENCY_INTERVAL;
+  uint64_t length = latency->end - latency->start - from;
+
+  if (length > LATENCY_INTERVAL)
+    length = LATENCY_INTERVAL;
+
+  if (latency->end - latency->start <= from || !length)
+    return 0;
+
+  return latency->intervals[interval] / (length / 1e9);
+}
+
+/* write the statistics of the given histogram, in microseconds */
+static void latency_stats(const histogram_t *histogram, FILE *fd,
+                          const bool json)
+{
+  if (json)
+    fprintf(fd, "\"count\": %zu, \"mean\": %.1f", histogram_count(histogram),
+            histogram_mean(histogram) / 1e3);
+  else
+    fprintf(fd, "%zu line(s), mean %.1f us", histogram_count(histogram),
+            histogram_mean(histogram) / 1e3);
+
+  for (size_t i = 0; i < NB_PERCENTILES; i = i + 1)
+    fprintf(fd, json ? ", \"%s\": %.1f" : ", %s %.1f us",
+            percentile_names[i],
+            histogram_percentile(histogram, percentiles[i]) / 1e3);
+
+  fprintf(fd, json ? ", \"max\": %.1f" : ", max %.1f us",
+          histogram_max(histogram) / 1e3);
+}
+
+void latency_print(const latency_t *latency, FILE *fd)
+{
+  histogram_t *total = NULL;
+  double seconds = 0;
+  const histogram_t *histogram = NULL;
+  const slow_t *slow = NULL;
+
+  if (!latency || !fd)
+    return;
+
+  seconds = latency_seconds(latency);
+  fprintf(fd, "%zu line(s) in %.3f s, %.1f line(s)/s\n", latency->count,
+          seconds, seconds > 0 ? latency->count / seconds : 0);
+
+  total = latency_total(latency);
+  if (total)
+  {
+    fprintf(fd, "all: ");
+    latency_stats(total, fd, false);
+    fprintf(fd, "\n");
+    histogram_free(total);
+  }
+
+  for (size_t i = 0; i <= MAX_GRID_SQRT; i = i + 1)
+    for (size_t j = 0; j < NB_OUTCOMES; j = j + 1)
+    {
+      histogram = latency->histograms[i][j];
+      if (!histogram)
+        continue;
+
+      if (i)
+        fprintf(fd, "%zux%zu %s: ", i * i, i * i,
+                latency_outcome_name(j));
+      else
+        fprintf(fd, "malformed: ");
+
+      latency_stats(histogram, fd, false);
+      fprintf(fd, "\n");
+    }
+
+  for (size_t i = 0; i < latency->nb_intervals; i = i + 1)
+    fprintf(fd, "from %.0f s: %zu line(s), %.1f line(s)/s\n",
+            (double) i * LATENCY_INTERVAL / 1e9, latency->intervals[i],
+            latency_throughput(latency, i));
+
+  for (size_t i = 0; i < latency->nb_slowest; i = i + 1)
+  {
+    slow = &latency->slowest[i];
+    if (slow->size)
+      fprintf(fd, "slowest: line %zu, %zux%zu %s, %.1f us\n", slow->index,
+              slow->size, slow->size, latency_outcome_name(slow->outcome),
+              slow->elapsed / 1e3);
+    else
+      fprintf(fd, "slowest: line %zu, malformed, %.1f us\n", slow->index,
+              slow->elapsed / 1e3);
+  }
+}
+
+void latency_write_json(const latency_t *latency, FILE *fd)
+{
+  histogram_t *total = NULL;
+  double seconds = 0;
+  const slow_t *slow = NULL;
+  bool first = true;
+
+  if (!latency || !fd)
+    return;
+
+  seconds = latency_seconds(latency);
+  fprintf(fd, "{\"lines\": %zu, \"seconds\": %.6f, \"throughput\": %.1f,\n",
+          latency->count, seconds,
+          seconds > 0 ? latency->count / seconds : 0);
+
+  total = latency_total(latency);
+  if (total)
+  {
+    fprintf(fd, " \"latency\": {");
+    latency_stats(total, fd, true);
+    fprintf(fd, "},\n");
+    histogram_free(total);
+  }
+
+  fprintf(fd, " \"breakdown\": [");
+  for (size_t i = 0; i <= MAX_GRID_SQRT; i = i + 1)
+    for (size_t j = 0; j < NB_OUTCOMES; j = j + 1)
+    {
+      if (!latency->histograms[i][j])
+        continue;
+
+      fprintf(fd, "%s\n  {\"size\": %zu, \"outcome\": \"%s\", ",
+              first ? "" : ",", i * i, latency_outcome_name(j));
+      latency_stats(latency->histograms[i][j], fd, true);
+      fprintf(fd, "}");
+      first = false;
+    }
+
+  fprintf(fd, "],\n \"interval\": %.3f, \"intervals\": [",
+          LATENCY_INTERVAL / 1e9);
+  for (size_t i = 0; i < latency->nb_intervals; i = i + 1)
+    fprintf(fd, "%s%zu", i ? ", " : "", latency->intervals[i]);
+
+  fprintf(fd, "],\n \"throughputs\": [");
+  for (size_t i = 0; i < latency->nb_intervals; i = i + 1)
+    fprintf(fd, "%s%.1f", i ? ", " : "", latency_throughput(latency, i));
+
+  fprintf(fd, "],\n \"slowest\": [");
+  for (size_t i = 0; i < latency->nb_slowest; i = i + 1)
+  {
+    slow = &latency->slowest[i];
+    fprintf(fd, "%s\n  {\"line\": %zu, \"size\": %zu, \"outcome\": \"%s\","
+            " \"time\": %.1f}", i ? "," : "", slow->index, slow->size,
+            latency_outcome_name(slow->outcome), slow->elapsed / 1e3);
+  }
+
+  fprintf(fd, "]}\n");
+}
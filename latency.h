@@ -0,0 +1,50 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* slowest lines of a batch named by its report by default */
+#define LATENCY_DEFAULT_SLOWEST 10
+
+/* length of the intervals over which the throughput is reported, in
+   nanoseconds */
+#define LATENCY_INTERVAL 1000000000ULL
+
+/* Latency report of a batch (forward declaration to hide the
+   implementation): the time taken by each line, counted in a histogram per
+   grid size and outcome (see histogram_t), the lines done in each interval
+   of the run, and the slowest lines */
+typedef struct latency_t latency_t;
+
+/* memory allocation for an empty report naming the given number of slowest
+   lines. The run starts now */
+latency_t *latency_new(const size_t nb_slowest);
+
+/* free the allocated memory of the given report */
+void latency_free(latency_t *latency);
+
+/* count the line of given index (from 0) in the given report: its grid of
+   the given size ('0' if the line is malformed), the outcome of its search,
+   and the time (from trace_clock) it ended and took, in nanoseconds */
+void latency_record(latency_t *latency, const size_t index,
+                    const size_t size, const solver_outcome_t outcome,
+                    const uint64_t end, const uint64_t elapsed);
+
+/* write the given report in the given file, for people to read: the
+   percentiles and the maximum of the latencies of all the lines and per
+   grid size and outcome, the lines done and the throughput in each
+   interval (the last one cut at the end of the run), and the slowest
+   lines */
+void latency_print(const latency_t *latency, FILE *fd);
+
+/* write the same report as latency_print in JSON, with the times in
+   microseconds */
+void latency_write_json(const latency_t *latency, FILE *fd);
+
+#endif /* LATENCY_H */
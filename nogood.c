@@ -0,0 +1,184 @@
+#include <nogood.h>
+#include <colors.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  size_t length;
+  size_t activity;
+} nogood_t;
+
+/* Interal structure (hiden from outside) to represent a nogood database.
+   The decisions of the nogood i are literals[i * max_length ...] */
+struct nogood_db_t
+{
+  size_t capacity;
+  size_t max_length;
+  size_t nb_nogoods;
+  size_t nb_added;
+  nogood_t *nogoods;
+  literal_t *literals;
+};
+
+nogood_db_t *nogood_new(const size_t capacity, const size_t max_length)
+{
+  nogood_db_t *db = NULL;
+
+  if (!capacity || !max_length)
+    return NULL;
+
+  db = calloc(1, sizeof(nogood_db_t));
+  if (!db)
+    return NULL;
+
+  db->nogoods = calloc(capacity, sizeof(nogood_t));
+  db->literals = calloc(capacity * max_length, sizeof(literal_t));
+  if (!db->nogoods || !db->literals)
+  {
+    nogood_free(db);
+
+    return NULL;
+  }
+
+  db->capacity = capacity;
+  db->max_length = max_length;
+
+  return db;
+}
+
+void nogood_free(nogood_db_t *db)
+{
+  if (!db)
+    return;
+
+  free(db->nogoods);
+  free(db->literals);
+  free(db);
+}
+
+void nogood_clear(nogood_db_t *db)
+{
+  if (!db)
+    return;
+
+  db->nb_nogoods = 0;
+  db->nb_added = 0;
+}
+
+size_t nogood_max_length(const nogood_db_t *db)
+{
+  if (!db)
+    return 0;
+
+  return db->max_length;
+}
+
+/* return the index of the least active nogood */
+static size_t nogood_weakest(const nogood_db_t *db)
+{
+  size_t weakest = 0;
+
+  for (size_t i = 1; i < db->nb_nogoods; i = i + 1)
+    if (db->nogoods[i].activity < db->nogoods[weakest].activity)
+      weakest = i;
+
+  return weakest;
+}
+
+bool nogood_add(nogood_db_t *db, const literal_t *literals,
+                const size_t length)
+{
+  size_t where = 0;
+
+  if (!db || !literals || !length || length > db->max_length)
+    return false;
+
+/* activities decay, so that old nogoods make room for the new ones */
+  db->nb_added = db->nb_added + 1;
+  if (db->nb_added % db->capacity == 0)
+    for (size_t i = 0; i < db->nb_nogoods; i = i + 1)
+      db->nogoods[i].activity = db->nogoods[i].activity / 2;
+
+  if (db->nb_nogoods < db->capacity)
+  {
+    where = db->nb_nogoods;
+    db->nb_nogoods = db->nb_nogoods + 1;
+  }
+  else
+    where = nogood_weakest(db);
+
+  memcpy(db->literals + where * db->max_length, literals,
+         length * sizeof(literal_t));
+  db->nogoods[where].length = length;
+  db->nogoods[where].activity = 1;
+
+  return true;
+}
+
+size_t nogood_propagate(nogood_db_t *db, grid_t *grid)
+{
+  size_t size = grid_get_size(grid);
+  size_t status = 0;
+  size_t nb_open = 0;
+  const literal_t *literals = NULL;
+  const literal_t *open = NULL;
+  colors_t colors = colors_empty();
+  colors_t color = colors_empty();
+
+  if (!db || !size)
+    return 0;
+
+  for (size_t i = 0; i < db->nb_nogoods; i = i + 1)
+  {
+    literals = db->literals + i * db->max_length;
+    nb_open = 0;
+
+    for (size_t j = 0; j < db->nogoods[i].length && nb_open < 2; j = j + 1)
+    {
+      colors = grid_get_colors(grid, literals[j].cell / size,
+                               literals[j].cell % size);
+      color = colors_set(literals[j].color);
+
+/* a decision which cannot hold any more makes the nogood useless */
+      if (!colors_and(colors, color))
+        nb_open = 2;
+      else if (!colors_is_equal(colors, color))
+      {
+        nb_open = nb_open + 1;
+        open = &literals[j];
+      }
+    }
+
+    if (nb_open == 0)
+    {
+      db->nogoods[i].activity = db->nogoods[i].activity + 1;
+
+      return 2;
+    }
+
+    if (nb_open == 1)
+    {
+      colors = grid_get_colors(grid, open->cell / size, open->cell % size);
+      grid_set_colors(grid, open->cell / size, open->cell % size,
+                      colors_discard(colors, open->color));
+      db->nogoods[i].activity = db->nogoods[i].activity + 1;
+      status = 1;
+    }
+  }
+
+  return status;
+}
+
+size_t nogood_count(const nogood_db_t *db)
+{
+  if (!db)
+    return 0;
+
+  return db->nb_nogoods;
+}
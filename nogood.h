@@ -0,0 +1,51 @@
+#ifndef NOGOOD_H
+#define NOGOOD_H
+
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* a decision of the search: the color of index color given to the cell of
+   index cell (row * size + column) */
+typedef struct
+{
+  uint16_t cell;
+  uint8_t color;
+} literal_t;
+
+/* Bounded database of nogoods, i.e sets of decisions which cannot all hold
+   in a solution (forward declaration to hide the implementation). When it
+   is full, the least active nogoods are forgotten */
+typedef struct nogood_db_t nogood_db_t;
+
+/* memory allocation for a database of at most capacity nogoods of at most
+   max_length decisions each */
+nogood_db_t *nogood_new(const size_t capacity, const size_t max_length);
+
+/* free the allocated memory of the given database */
+void nogood_free(nogood_db_t *db);
+
+/* forget every nogood of the given database */
+void nogood_clear(nogood_db_t *db);
+
+/* return the maximum number of decisions of a nogood of the given database */
+size_t nogood_max_length(const nogood_db_t *db);
+
+/* store the given nogood of given length. return false if it is too long */
+bool nogood_add(nogood_db_t *db, const literal_t *literals,
+                const size_t length);
+
+/* check the nogoods against the given grid and discard the color of every
+   nogood whose other decisions all hold. return a number corresponding to
+   the state of the grid afterward:
+   - '0' if nothing changed
+   - '1' if some colors were discarded
+   - '2' if a nogood fully holds, i.e the grid is inconsistent */
+size_t nogood_propagate(nogood_db_t *db, grid_t *grid);
+
+/* return the number of nogoods of the given database */
+size_t nogood_count(const nogood_db_t *db);
+
+#endif /* NOGOOD_H */
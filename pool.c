@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pool.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct task_t
+{
+  pool_job_t job;
+  void *arg;
+  struct task_t *next;
+} task_t;
+
+/* Interal structure (hiden from outside) to represent a pool of workers */
+struct pool_t
+{
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t idle;
+  task_t *head;
+  task_t *tail;
+  size_t pending;
+  bool shutdown;
+
+  void *(*state_new)(void);
+  void (*state_free)(void *);
+  size_t nb_workers;
+  pthread_t *workers;
+};
+
+size_t pool_default_size(void)
+{
+  long nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (nb_cpus < 1)
+    return 1;
+
+  return nb_cpus;
+}
+
+static void *pool_worker(void *data)
+{
+  pool_t *pool = data;
+  task_t *task = NULL;
+  void *state = NULL;
+
+  if (pool->state_new)
+    state = pool->state_new();
+
+  pthread_mutex_lock(&pool->lock);
+  while (true)
+  {
+    while (!pool->head && !pool->shutdown)
+      pthread_cond_wait(&pool->work, &pool->lock);
+
+    if (!pool->head)
+      break;
+
+    task = pool->head;
+    pool->head = task->next;
+    if (!pool->head)
+      pool->tail = NULL;
+
+    pthread_mutex_unlock(&pool->lock);
+    task->job(task->arg, state);
+    free(task);
+    pthread_mutex_lock(&pool->lock);
+
+    pool->pending = pool->pending - 1;
+    if (!pool->pending)
+      pthread_cond_broadcast(&pool->idle);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (pool->state_free)
+    pool->state_free(state);
+
+  return NULL;
+}
+
+pool_t *pool_new(const size_t nb_workers, void *(*state_new)(void),
+                 void (*state_free)(void *))
+{
+  pool_t *pool = NULL;
+
+  if (!nb_workers)
+    return NULL;
+
+  pool = calloc(1, sizeof(pool_t));
+  if (!pool)
+    return NULL;
+
+  pool->workers = calloc(nb_workers, sizeof(pthread_t));
+  if (!pool->workers)
+  {
+    free(pool);
+
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  pool->state_new = state_new;
+  pool->state_free = state_free;
+
+  for (size_t i = 0; i < nb_workers; i = i + 1)
+  {
+    if (pthread_create(&pool->workers[i], NULL, pool_worker, pool))
+      break;
+
+    pool->nb_workers = pool->nb_workers + 1;
+  }
+
+  if (!pool->nb_workers)
+  {
+    pool_free(pool);
+
+    return NULL;
+  }
+
+  return pool;
+}
+
+bool pool_submit(pool_t *pool, pool_job_t job, void *arg)
+{
+  task_t *task = NULL;
+
+  if (!pool || !job)
+    return false;
+
+  task = calloc(1, sizeof(task_t));
+  if (!task)
+    return false;
+
+  task->job = job;
+  task->arg = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->shutdown)
+  {
+    pthread_mutex_unlock(&pool->lock);
+    free(task);
+
+    return false;
+  }
+
+  if (pool->tail)
+    pool->tail->next = task;
+  else
+    pool->head = task;
+
+  pool->tail = task;
+  pool->pending = pool->pending + 1;
+  pthread_cond_signal(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+void pool_wait(pool_t *pool)
+{
+  if (!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending)
+    pthread_cond_wait(&pool->idle, &pool->lock);
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_free(pool_t *pool)
+{
+  if (!pool)
+    return;
+
+  pool_wait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->work);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->nb_workers; i = i + 1)
+    pthread_join(pool->workers[i], NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->workers);
+  free(pool);
+}
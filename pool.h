@@ -0,0 +1,31 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Pool of worker threads (forward declaration to hide the implementation) */
+typedef struct pool_t pool_t;
+
+/* a job gets its argument and the private state of the worker running it */
+typedef void (*pool_job_t)(void *arg, void *state);
+
+/* return the number of workers to use when none is given by the user */
+size_t pool_default_size(void);
+
+/* memory allocation for a pool of the given number of workers. Each worker
+   owns a state made by state_new (may be NULL) which lives as long as the
+   pool, and is released with state_free */
+pool_t *pool_new(const size_t nb_workers, void *(*state_new)(void),
+                 void (*state_free)(void *));
+
+/* queue the given job, return false if the pool is shutting down */
+bool pool_submit(pool_t *pool, pool_job_t job, void *arg);
+
+/* wait until every queued job is done */
+void pool_wait(pool_t *pool);
+
+/* wait for the queued jobs, stop the workers and free the given pool */
+void pool_free(pool_t *pool);
+
+#endif /* POOL_H */
@@ -0,0 +1,167 @@
+#include <rate.h>
+#include <colors.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* difficulty of one use of each rung of the ladder */
+static const double rate_weights[NB_TECHNIQUES + 1] = {1.0, 2.0, 5.0, 8.0,
+                                                       10.0, 12.0, 16.0,
+                                                       20.0};
+
+/* search the solution of the given grid once the techniques are stuck */
+static bool rate_branch(grid_t *grid, solver_t *solver, rating_t *rating)
+{
+  solver_t *own = NULL;
+  bool solved = false;
+
+  if (!solver)
+  {
+    own = solver_new(mode_first);
+    if (!own)
+      return false;
+
+    solver = own;
+  }
+
+  solver_set_mode(solver, mode_first);
+  solved = solver_run(solver, grid) == outcome_solved;
+  rating->usage[RATE_BRANCHING] = solver_get_nodes(solver);
+  rating->hardest = RATE_BRANCHING;
+
+  solver_free(own);
+
+  return solved;
+}
+
+bool grid_rate(const grid_t *grid, solver_t *solver, rating_t *rating)
+{
+  size_t size = grid_get_size(grid);
+  size_t nb_empty = 0;
+  size_t count = 0;
+  size_t technique = 0;
+  double weighted = 0.0;
+  bool solved = true;
+  grid_t *copy = NULL;
+
+  if (!size || !rating)
+    return false;
+
+  memset(rating, 0, sizeof(rating_t));
+
+  for (size_t i = 0; i < size; i = i + 1)
+    for (size_t j = 0; j < size; j = j + 1)
+      if (!colors_is_singleton(grid_get_colors(grid, i, j)))
+        nb_empty = nb_empty + 1;
+
+  copy = grid_copy(grid);
+  if (!copy)
+    return false;
+
+  while (grid_is_consistent(copy) && !grid_is_solved(copy))
+  {
+/* the techniques are tried from the easiest, the first one which makes
+   progress is kept and the ladder starts over */
+    count = 0;
+    for (technique = 0; technique < NB_TECHNIQUES && !count;
+         technique = technique + 1)
+      count = grid_technique(copy, technique);
+
+    if (!count)
+      break;
+
+    technique = technique - 1;
+    rating->usage[technique] = rating->usage[technique] + count;
+    if (technique > rating->hardest)
+      rating->hardest = technique;
+  }
+
+  if (!grid_is_consistent(copy))
+    solved = false;
+  else if (!grid_is_solved(copy))
+    solved = rate_branch(copy, solver, rating);
+
+  grid_free(copy);
+
+  for (size_t i = 0; i <= RATE_BRANCHING; i = i + 1)
+    weighted = weighted + rate_weights[i] * rating->usage[i];
+
+  rating->grade = nb_empty ? weighted / nb_empty : 0.0;
+
+  return solved;
+}
+
+const char *rate_name(const size_t rung)
+{
+  if (rung == RATE_BRANCHING)
+    return "branching";
+
+  return technique_name(rung);
+}
+
+difficulty_t rate_difficulty(const rating_t *rating)
+{
+  if (rating->hardest >= technique_fish)
+    return difficulty_hard;
+
+  if (rating->hardest > technique_lone_number)
+    return difficulty_medium;
+
+  return difficulty_easy;
+}
+
+static const char *difficulty_names[NB_DIFFICULTIES + 1] = {"easy", "medium",
+                                                            "hard", "any"};
+
+const char *difficulty_name(const difficulty_t difficulty)
+{
+  if (difficulty > difficulty_any)
+    return "unknown";
+
+  return difficulty_names[difficulty];
+}
+
+bool difficulty_from_name(const char *name, difficulty_t *difficulty)
+{
+  for (size_t i = 0; i <= NB_DIFFICULTIES && name; i = i + 1)
+    if (!strcmp(name, difficulty_names[i]))
+    {
+      *difficulty = i;
+
+      return true;
+    }
+
+  return false;
+}
+
+size_t rate_to_line(const rating_t *rating, char *buffer,
+                    const size_t length)
+{
+  int written = 0;
+  size_t used = 0;
+
+  if (!rating || !buffer || !length)
+    return 0;
+
+  written = snprintf(buffer, length, "%.2f %s", rating->grade,
+                     rate_name(rating->hardest));
+  if (written < 0 || (size_t) written >= length)
+    return 0;
+
+  used = written;
+  for (size_t i = 0; i <= RATE_BRANCHING; i = i + 1)
+  {
+    written = snprintf(buffer + used, length - used, " %s=%zu", rate_name(i),
+                       rating->usage[i]);
+    if (written < 0 || (size_t) written >= length - used)
+      return 0;
+
+    used = used + written;
+  }
+
+  return used;
+}
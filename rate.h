@@ -0,0 +1,62 @@
+#ifndef RATE_H
+#define RATE_H
+
+#include <colors.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the last rung of the ladder, after the techniques, is the search */
+#define RATE_BRANCHING NB_TECHNIQUES
+
+/* difficulty classes of the grids: easy ones only need singles, medium ones
+   need subsets, hard ones need fishes, chains or a search */
+#define NB_DIFFICULTIES 3
+
+typedef enum
+{
+  difficulty_easy,
+  difficulty_medium,
+  difficulty_hard,
+  difficulty_any
+} difficulty_t;
+
+/* how a grid was solved: usage[t] is the number of subgrids modified by the
+   technique t, usage[RATE_BRANCHING] the number of nodes of the search if
+   the techniques were not enough */
+typedef struct
+{
+  size_t usage[NB_TECHNIQUES + 1];
+  size_t hardest;
+  double grade;
+} rating_t;
+
+/* rate the given grid, which is left untouched: at each step, the easiest
+   technique able to modify the grid is applied, and the solver takes over
+   when none can. The grade weights the usage of the techniques by their
+   difficulty, per empty cell. The given solver (may be NULL) is used for
+   the search. return false if the grid has no solution */
+bool grid_rate(const grid_t *grid, solver_t *solver, rating_t *rating);
+
+/* return the name of the given rung of the ladder */
+const char *rate_name(const size_t rung);
+
+/* return the difficulty class of the given rating */
+difficulty_t rate_difficulty(const rating_t *rating);
+
+/* return the name of the given difficulty class */
+const char *difficulty_name(const difficulty_t difficulty);
+
+/* set the difficulty class of the given name ("any" included), return
+   false if the name is unknown */
+bool difficulty_from_name(const char *name, difficulty_t *difficulty);
+
+/* write the given rating on a single line in the given buffer:
+     GRADE HARDEST cross_hatching=N ... branching=N
+   return the number of char written, or 0 if the buffer is too short */
+size_t rate_to_line(const rating_t *rating, char *buffer,
+                    const size_t length);
+
+#endif /* RATE_H */
@@ -0,0 +1,482 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <reservoir.h>
+#include <generator.h>
+#include <grid.h>
+#include <rate.h>
+#include <solver.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* number of puzzles of a size generated in a row for other classes before
+   a queue gives up its refill, so that a rare class does not keep the
+   threads busy forever. The next pop starts it again */
+#define RESERVOIR_MAX_MISSES 256
+
+/* puzzles are kept as lines, in a ring of high entries */
+typedef struct
+{
+  bool kept;
+  bool filling;
+  size_t misses;
+  size_t head;
+  size_t count;
+  char **lines;
+} queue_t;
+
+/* a refill thread and its solver, made before the thread starts so that
+   the random streams of the solvers follow the order of the threads */
+typedef struct
+{
+  reservoir_t *reservoir;
+  solver_t *solver;
+  pthread_t thread;
+} refill_t;
+
+/* Interal structure (hiden from outside) to represent a reservoir */
+struct reservoir_t
+{
+  size_t low;
+  size_t high;
+  size_t nb_threads;
+  size_t nb_started;
+  refill_t *refills;
+  char *path;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool shutdown;
+  size_t next;
+  queue_t queues[MAX_GRID_SQRT + 1][NB_DIFFICULTIES];
+};
+
+static size_t size_sqrt(const size_t size)
+{
+  size_t sqrt = 1;
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  return sqrt;
+}
+
+/* return the queue of the given size and difficulty, or NULL */
+static queue_t *reservoir_queue(reservoir_t *reservoir, const size_t size,
+                                const difficulty_t difficulty)
+{
+  if (!grid_check_size(size) || difficulty >= NB_DIFFICULTIES)
+    return NULL;
+
+  return &reservoir->queues[size_sqrt(size)][difficulty];
+}
+
+/* add the given line to the given queue, which takes its ownership. return
+   false if the queue is full */
+static bool queue_push(queue_t *queue, const size_t high, char *line)
+{
+  if (!queue->kept || queue->count >= high)
+    return false;
+
+  queue->lines[(queue->head + queue->count) % high] = line;
+  queue->count = queue->count + 1;
+
+  return true;
+}
+
+static char *queue_pop(queue_t *queue, const size_t high)
+{
+  char *line = NULL;
+
+  if (!queue->count)
+    return NULL;
+
+  line = queue->lines[queue->head];
+  queue->head = (queue->head + 1) % high;
+  queue->count = queue->count - 1;
+
+  return line;
+}
+
+reservoir_t *reservoir_new(const size_t low, const size_t high,
+                           const size_t nb_threads, const char *path)
+{
+  reservoir_t *reservoir = NULL;
+
+  if (!high || low > high || !nb_threads)
+    return NULL;
+
+  reservoir = calloc(1, sizeof(reservoir_t));
+  if (!reservoir)
+    return NULL;
+
+  reservoir->low = low;
+  reservoir->high = high;
+  reservoir->nb_threads = nb_threads;
+  reservoir->refills = calloc(nb_threads, sizeof(refill_t));
+  reservoir->path = path ? strdup(path) : NULL;
+  if (!reservoir->refills || (path && !reservoir->path))
+  {
+    free(reservoir->refills);
+    free(reservoir->path);
+    free(reservoir);
+
+    return NULL;
+  }
+
+  pthread_mutex_init(&reservoir->lock, NULL);
+  pthread_cond_init(&reservoir->wake, NULL);
+
+  return reservoir;
+}
+
+/* write the puzzles of the given reservoir in its file, one per line:
+     SIZE DIFFICULTY GRID */
+static void reservoir_save(reservoir_t *reservoir)
+{
+  FILE *fd = fopen(reservoir->path, "w");
+  queue_t *queue = NULL;
+
+  if (!fd)
+    return;
+
+  for (size_t sqrt = 1; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
+    for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+    {
+      queue = &reservoir->queues[sqrt][d];
+      for (size_t i = 0; i < queue->count; i = i + 1)
+        fprintf(fd, "%zu %s %s\n", sqrt * sqrt, difficulty_name(d),
+                queue->lines[(queue->head + i) % reservoir->high]);
+    }
+
+  fclose(fd);
+}
+
+/* read the puzzles saved in the file of the given reservoir, those whose
+   queue is not kept or full are dropped */
+static void reservoir_load(reservoir_t *reservoir)
+{
+  FILE *fd = fopen(reservoir->path, "r");
+  char *line = NULL;
+  size_t capacity = 0;
+  ssize_t length = 0;
+  char *save = NULL;
+  char *token = NULL;
+  char *copy = NULL;
+  size_t size = 0;
+  difficulty_t difficulty = difficulty_any;
+  queue_t *queue = NULL;
+
+  if (!fd)
+    return;
+
+  while ((length = getline(&line, &capacity, fd)) > 0)
+  {
+    if (line[length - 1] == '\n')
+      line[length - 1] = '\0';
+
+    token = strtok_r(line, " ", &save);
+    size = token ? strtoul(token, NULL, 10) : 0;
+    token = strtok_r(NULL, " ", &save);
+    if (!token || !difficulty_from_name(token, &difficulty))
+      continue;
+
+    token = strtok_r(NULL, " ", &save);
+    queue = reservoir_queue(reservoir, size, difficulty);
+    if (!token || !queue || strlen(token) != size * size)
+      continue;
+
+    copy = strdup(token);
+    if (copy && !queue_push(queue, reservoir->high, copy))
+      free(copy);
+  }
+
+  free(line);
+  fclose(fd);
+}
+
+void reservoir_free(reservoir_t *reservoir)
+{
+  queue_t *queue = NULL;
+
+  if (!reservoir)
+    return;
+
+  pthread_mutex_lock(&reservoir->lock);
+  reservoir->shutdown = true;
+  pthread_cond_broadcast(&reservoir->wake);
+  pthread_mutex_unlock(&reservoir->lock);
+
+  for (size_t i = 0; i < reservoir->nb_started; i = i + 1)
+    pthread_join(reservoir->refills[i].thread, NULL);
+
+  for (size_t i = 0; i < reservoir->nb_threads; i = i + 1)
+    solver_free(reservoir->refills[i].solver);
+
+  if (reservoir->path)
+    reservoir_save(reservoir);
+
+  for (size_t sqrt = 1; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
+    for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+    {
+      queue = &reservoir->queues[sqrt][d];
+      for (size_t i = 0; i < queue->count; i = i + 1)
+        free(queue->lines[(queue->head + i) % reservoir->high]);
+
+      free(queue->lines);
+    }
+
+  pthread_cond_destroy(&reservoir->wake);
+  pthread_mutex_destroy(&reservoir->lock);
+  free(reservoir->refills);
+  free(reservoir->path);
+  free(reservoir);
+}
+
+bool reservoir_add(reservoir_t *reservoir, const size_t size,
+                   const difficulty_t difficulty)
+{
+  queue_t *queue = NULL;
+
+  if (!reservoir)
+    return false;
+
+  if (difficulty == difficulty_any)
+  {
+    for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+      if (!reservoir_add(reservoir, size, d))
+        return false;
+
+    return true;
+  }
+
+  queue = reservoir_queue(reservoir, size, difficulty);
+  if (!queue)
+    return false;
+
+  pthread_mutex_lock(&reservoir->lock);
+  if (!queue->lines)
+    queue->lines = calloc(reservoir->high, sizeof(char *));
+
+  queue->kept = queue->lines != NULL;
+  pthread_mutex_unlock(&reservoir->lock);
+
+  return queue->kept;
+}
+
+/* return the size of a queue waiting for puzzles, taken in turn, or 0 */
+static size_t reservoir_starving(reservoir_t *reservoir)
+{
+  size_t sqrt = 0;
+
+  for (size_t i = 0; i < MAX_GRID_SQRT; i = i + 1)
+  {
+    sqrt = (reservoir->next + i) % MAX_GRID_SQRT + 1;
+    for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+      if (reservoir->queues[sqrt][d].filling)
+      {
+        reservoir->next = sqrt % MAX_GRID_SQRT;
+
+        return sqrt * sqrt;
+      }
+  }
+
+  return 0;
+}
+
+/* file a new puzzle of given size and difficulty, and update the refill of
+   the queues of this size */
+static void reservoir_file(reservoir_t *reservoir, const size_t size,
+                           const difficulty_t difficulty, char *line)
+{
+  queue_t *queue = NULL;
+
+  if (!queue_push(reservoir_queue(reservoir, size, difficulty),
+                  reservoir->high, line))
+    free(line);
+
+  for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+  {
+    queue = reservoir_queue(reservoir, size, d);
+    if (!queue->filling)
+      continue;
+
+    queue->misses = d == difficulty ? 0 : queue->misses + 1;
+    if (queue->count >= reservoir->high ||
+        queue->misses >= RESERVOIR_MAX_MISSES)
+    {
+      queue->filling = false;
+      queue->misses = 0;
+    }
+  }
+}
+
+static void *reservoir_thread(void *data)
+{
+  refill_t *refill = data;
+  reservoir_t *reservoir = refill->reservoir;
+  solver_t *solver = refill->solver;
+  rating_t rating;
+  difficulty_t difficulty = difficulty_any;
+  grid_t *grid = NULL;
+  char *line = NULL;
+  size_t size = 0;
+
+  pthread_mutex_lock(&reservoir->lock);
+  while (!reservoir->shutdown)
+  {
+    size = reservoir_starving(reservoir);
+    if (!size)
+    {
+      pthread_cond_wait(&reservoir->wake, &reservoir->lock);
+      continue;
+    }
+
+/* the generation runs unlocked, the puzzle is then filed in its class */
+    pthread_mutex_unlock(&reservoir->lock);
+    grid = grid_generate_from(size, true, solver_get_rng(solver));
+    line = malloc(GRID_LINE_LENGTH(size));
+    if (grid && line && grid_rate(grid, solver, &rating) &&
+        grid_to_line(grid, line, GRID_LINE_LENGTH(size)))
+      difficulty = rate_difficulty(&rating);
+    else
+    {
+      free(line);
+      line = NULL;
+    }
+    grid_free(grid);
+    pthread_mutex_lock(&reservoir->lock);
+
+    if (line)
+      reservoir_file(reservoir, size, difficulty, line);
+  }
+  pthread_mutex_unlock(&reservoir->lock);
+
+  return NULL;
+}
+
+bool reservoir_start(reservoir_t *reservoir)
+{
+  queue_t *queue = NULL;
+  refill_t *refill = NULL;
+
+  if (!reservoir)
+    return false;
+
+  pthread_mutex_lock(&reservoir->lock);
+  if (reservoir->path)
+    reservoir_load(reservoir);
+
+  for (size_t sqrt = 1; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
+    for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+    {
+      queue = &reservoir->queues[sqrt][d];
+      queue->filling = queue->kept && queue->count < reservoir->low;
+    }
+  pthread_mutex_unlock(&reservoir->lock);
+
+  while (reservoir->nb_started < reservoir->nb_threads)
+  {
+    refill = &reservoir->refills[reservoir->nb_started];
+    refill->reservoir = reservoir;
+    refill->solver = solver_new(mode_first);
+    if (!refill->solver)
+      return false;
+
+    solver_set_output(refill->solver, NULL);
+    if (pthread_create(&refill->thread, NULL, reservoir_thread, refill))
+      return false;
+
+    reservoir->nb_started = reservoir->nb_started + 1;
+  }
+
+  return true;
+}
+
+grid_t *reservoir_pop(reservoir_t *reservoir, const size_t size,
+                      const difficulty_t difficulty)
+{
+  queue_t *queue = NULL;
+  char *line = NULL;
+  grid_t *grid = NULL;
+
+  if (!reservoir)
+    return NULL;
+
+  pthread_mutex_lock(&reservoir->lock);
+  for (size_t d = 0; d < NB_DIFFICULTIES && !line; d = d + 1)
+  {
+    if (difficulty != difficulty_any && d != difficulty)
+      continue;
+
+    queue = reservoir_queue(reservoir, size, d);
+    if (!queue || !queue->kept)
+      continue;
+
+    line = queue_pop(queue, reservoir->high);
+    if (queue->count < reservoir->low && !queue->filling)
+    {
+      queue->filling = true;
+      pthread_cond_broadcast(&reservoir->wake);
+    }
+  }
+  pthread_mutex_unlock(&reservoir->lock);
+
+  if (!line)
+    return NULL;
+
+  grid = grid_from_line(line);
+  free(line);
+
+  return grid;
+}
+
+size_t reservoir_count(reservoir_t *reservoir, const size_t size,
+                       const difficulty_t difficulty)
+{
+  queue_t *queue = NULL;
+  size_t count = 0;
+
+  if (!reservoir)
+    return 0;
+
+  pthread_mutex_lock(&reservoir->lock);
+  for (size_t d = 0; d < NB_DIFFICULTIES; d = d + 1)
+  {
+    queue = reservoir_queue(reservoir, size, d);
+    if (queue && (difficulty == difficulty_any || d == difficulty))
+      count = count + queue->count;
+  }
+  pthread_mutex_unlock(&reservoir->lock);
+
+  return count;
+}
+
+grid_t *grid_generate_rated(const size_t size, const difficulty_t difficulty,
+                            const size_t attempts, solver_t *solver)
+{
+  rating_t rating;
+  grid_t *grid = NULL;
+
+  for (size_t i = 0; i < attempts; i = i + 1)
+  {
+    grid = grid_generate_from(size, true,
+                              solver ? solver_get_rng(solver) : NULL);
+    if (!grid)
+      return NULL;
+
+    if (difficulty == difficulty_any ||
+        (grid_rate(grid, solver, &rating) &&
+         rate_difficulty(&rating) == difficulty))
+      return grid;
+
+    grid_free(grid);
+  }
+
+  return NULL;
+}
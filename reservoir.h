@@ -0,0 +1,52 @@
+#ifndef RESERVOIR_H
+#define RESERVOIR_H
+
+#include <grid.h>
+#include <rate.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Reservoir of ready puzzles with a unique solution, one queue per size and
+   difficulty class (forward declaration to hide the implementation).
+   Background threads generate and rate puzzles: when a queue falls under its
+   low watermark, it is refilled up to its high watermark, so that most
+   requests are served without waiting for a generation */
+typedef struct reservoir_t reservoir_t;
+
+/* memory allocation for an empty reservoir, whose queues hold from low to
+   high puzzles, refilled by the given number of threads. If path is not
+   NULL, the puzzles saved in this file are loaded, and the content of the
+   reservoir is saved there when it is freed */
+reservoir_t *reservoir_new(const size_t low, const size_t high,
+                           const size_t nb_threads, const char *path);
+
+/* stop the threads, save the content of the given reservoir if it has a
+   file and free it */
+void reservoir_free(reservoir_t *reservoir);
+
+/* keep a queue of puzzles of the given size and difficulty (difficulty_any
+   keeps a queue for every class). return false if the size is not allowed */
+bool reservoir_add(reservoir_t *reservoir, const size_t size,
+                   const difficulty_t difficulty);
+
+/* start the refill threads of the given reservoir */
+bool reservoir_start(reservoir_t *reservoir);
+
+/* return a puzzle of the given size and difficulty taken from the
+   reservoir, or NULL if its queue is empty or not kept */
+grid_t *reservoir_pop(reservoir_t *reservoir, const size_t size,
+                      const difficulty_t difficulty);
+
+/* return the number of puzzles of the given size and difficulty ready in
+   the given reservoir */
+size_t reservoir_count(reservoir_t *reservoir, const size_t size,
+                       const difficulty_t difficulty);
+
+/* return a new puzzle of the given size and difficulty with a unique
+   solution, made in at most the given number of attempts, or NULL. The
+   random numbers are drawn from the generator of the given solver */
+grid_t *grid_generate_rated(const size_t size, const difficulty_t difficulty,
+                            const size_t attempts, solver_t *solver);
+
+#endif /* RESERVOIR_H */
@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <rng.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/* the seed of the process and the next stream given by rng_init */
+static pthread_mutex_t seed_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool seed_set = false;
+static uint64_t process_seed = 0;
+static uint64_t next_stream = 0;
+
+static uint64_t splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+  return z ^ (z >> 31);
+}
+
+static uint64_t rotl(const uint64_t x, const int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+/* take a seed from the clock if none was given, the lock is held */
+static void seed_default(void)
+{
+  struct timespec now;
+
+  if (seed_set)
+    return;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  process_seed = (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+  process_seed = process_seed ^ (uint64_t) getpid() << 32;
+  seed_set = true;
+}
+
+void rng_set_seed(const uint64_t seed)
+{
+  pthread_mutex_lock(&seed_lock);
+  process_seed = seed;
+  seed_set = true;
+  next_stream = 0;
+  pthread_mutex_unlock(&seed_lock);
+}
+
+uint64_t rng_get_seed(void)
+{
+  uint64_t seed = 0;
+
+  pthread_mutex_lock(&seed_lock);
+  seed_default();
+  seed = process_seed;
+  pthread_mutex_unlock(&seed_lock);
+
+  return seed;
+}
+
+void rng_seed(rng_t *rng, const uint64_t seed, const uint64_t stream)
+{
+  uint64_t x = seed;
+  uint64_t mix = stream;
+
+  if (!rng)
+    return;
+
+/* the stream is mixed before it shifts the seed, so that nearby streams of
+   nearby seeds do not overlap */
+  x = x ^ splitmix64(&mix);
+  for (size_t i = 0; i < 4; i = i + 1)
+    rng->state[i] = splitmix64(&x);
+}
+
+void rng_init(rng_t *rng)
+{
+  uint64_t seed = 0;
+  uint64_t stream = 0;
+
+  pthread_mutex_lock(&seed_lock);
+  seed_default();
+  seed = process_seed;
+  stream = next_stream;
+  next_stream = next_stream + 1;
+  pthread_mutex_unlock(&seed_lock);
+
+  rng_seed(rng, seed, stream);
+}
+
+void rng_fork(rng_t *rng, rng_t *child)
+{
+  if (!rng || !child)
+    return;
+
+  rng_seed(child, rng_next(rng), 0);
+}
+
+uint64_t rng_next(rng_t *rng)
+{
+  uint64_t *s = rng->state;
+  uint64_t result = rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] = s[2] ^ s[0];
+  s[3] = s[3] ^ s[1];
+  s[1] = s[1] ^ s[2];
+  s[0] = s[0] ^ s[3];
+  s[2] = s[2] ^ t;
+  s[3] = rotl(s[3], 45);
+
+  return result;
+}
+
+size_t rng_below(rng_t *rng, const size_t bound)
+{
+  uint64_t threshold = 0;
+  uint64_t r = 0;
+
+  if (!bound)
+    return 0;
+
+/* the numbers under 2^64 mod bound would make the low results more likely */
+  threshold = -(uint64_t) bound % bound;
+  do
+    r = rng_next(rng);
+  while (r < threshold);
+
+  return r % bound;
+}
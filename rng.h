@@ -0,0 +1,41 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* state of a xoshiro256** generator. Every search context owns one, so
+   that no lock is taken and no state is shared between threads */
+typedef struct
+{
+  uint64_t state[4];
+} rng_t;
+
+/* set the seed of the process, from which the generators initialized
+   afterward are seeded. Without it, a seed is taken from the clock and the
+   process id */
+void rng_set_seed(const uint64_t seed);
+
+/* return the seed of the process */
+uint64_t rng_get_seed(void);
+
+/* seed the given generator with the given stream of the given seed: the
+   streams of a seed give unrelated sequences */
+void rng_seed(rng_t *rng, const uint64_t seed, const uint64_t stream);
+
+/* seed the given generator with the next unused stream of the seed of the
+   process: generators initialized in the same order by two runs with the
+   same seed give the same sequences */
+void rng_init(rng_t *rng);
+
+/* seed the given child generator from the next number of the given one */
+void rng_fork(rng_t *rng, rng_t *child);
+
+/* return the next 64 random bits of the given generator */
+uint64_t rng_next(rng_t *rng);
+
+/* return a random number in [0, bound[ without bias, 0 if bound is 0 */
+size_t rng_below(rng_t *rng, const size_t bound);
+
+#endif /* RNG_H */
@@ -0,0 +1,285 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <schedule.h>
+#include <chains.h>
+#include <colors.h>
+#include <fish.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* a technique is judged on its recent passes, once it made enough of them:
+   it is skipped if less than one pass out of SCHEDULE_RATE modified the
+   grid, but still tried once every SCHEDULE_PROBE opportunities to notice
+   when it becomes useful again. The recent counters are halved every
+   SCHEDULE_WINDOW passes */
+#define SCHEDULE_WARMUP 64
+#define SCHEDULE_RATE 32
+#define SCHEDULE_PROBE 16
+#define SCHEDULE_WINDOW 1024
+
+/* below this size, a branch of the solver is cheaper than a pass of the
+   chains, which are then left to the fixed schedule and the rating */
+#define SCHEDULE_CHAINS_SIZE 16
+
+/* the same goes for the all-different filtering, whose matchings only pay
+   for themselves on the larger units */
+#define SCHEDULE_ALLDIFFERENT_SIZE 16
+
+typedef struct
+{
+  technique_stats_t stats;
+  size_t recent_passes;
+  size_t recent_yields;
+  size_t opportunities;
+} counter_t;
+
+/* Interal structure (hiden from outside) to represent a scheduler */
+struct schedule_t
+{
+  unsigned techniques;
+  bool adaptive;
+  size_t fish_order;
+  size_t chain_length;
+  counter_t counters[MAX_GRID_SQRT + 1][NB_TECHNIQUES];
+};
+
+schedule_t *schedule_new(const unsigned techniques, const bool adaptive)
+{
+  schedule_t *schedule = calloc(1, sizeof(schedule_t));
+  if (!schedule)
+    return NULL;
+
+  schedule_set(schedule, techniques, adaptive);
+  schedule->fish_order = FISH_DEFAULT_ORDER;
+  schedule->chain_length = CHAINS_DEFAULT_LENGTH;
+
+  return schedule;
+}
+
+void schedule_free(schedule_t *schedule)
+{
+  free(schedule);
+}
+
+void schedule_set(schedule_t *schedule, const unsigned techniques,
+                  const bool adaptive)
+{
+  if (!schedule)
+    return;
+
+  schedule->techniques = techniques & TECHNIQUES_ALL;
+  schedule->adaptive = adaptive;
+}
+
+void schedule_set_fish(schedule_t *schedule, const size_t order)
+{
+  if (schedule)
+    schedule->fish_order = order;
+}
+
+void schedule_set_chains(schedule_t *schedule, const size_t length)
+{
+  if (schedule)
+    schedule->chain_length = length;
+}
+
+bool schedule_parse(const char *list, unsigned *techniques)
+{
+  char name[32];
+  size_t length = 0;
+  size_t technique = 0;
+
+  if (!list || !techniques)
+    return false;
+
+  *techniques = 0;
+  while (*list)
+  {
+    length = strcspn(list, ",");
+    if (length >= sizeof(name))
+      return false;
+
+    memcpy(name, list, length);
+    name[length] = '\0';
+    list = list[length] ? list + length + 1 : list + length;
+
+    if (!strcmp(name, "all"))
+    {
+      *techniques = TECHNIQUES_ALL;
+      continue;
+    }
+
+    for (technique = 0; technique < NB_TECHNIQUES; technique = technique + 1)
+      if (!strcmp(name, technique_name(technique)))
+        break;
+
+    if (technique == NB_TECHNIQUES)
+      return false;
+
+    *techniques = *techniques | (1u << technique);
+  }
+
+  return true;
+}
+
+static size_t size_sqrt(const size_t size)
+{
+  size_t sqrt = 1;
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  return sqrt;
+}
+
+/* check if the given technique has to be tried now on a grid of given
+   size */
+static bool schedule_wants(schedule_t *schedule, counter_t *counter,
+                           const technique_t technique, const size_t size)
+{
+  if (!(schedule->techniques & (1u << technique)))
+    return false;
+
+  if (schedule->adaptive && technique == technique_chains &&
+      size < SCHEDULE_CHAINS_SIZE)
+    return false;
+
+  if (schedule->adaptive && technique == technique_alldifferent &&
+      size < SCHEDULE_ALLDIFFERENT_SIZE)
+    return false;
+
+  if (!schedule->adaptive || counter->recent_passes < SCHEDULE_WARMUP ||
+      counter->recent_yields * SCHEDULE_RATE >= counter->recent_passes)
+    return true;
+
+  counter->opportunities = counter->opportunities + 1;
+  if (counter->opportunities % SCHEDULE_PROBE == 0)
+    return true;
+
+  counter->stats.skipped = counter->stats.skipped + 1;
+
+  return false;
+}
+
+static uint64_t clock_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static void counter_record(counter_t *counter, const size_t modified,
+                           const uint64_t nanoseconds)
+{
+  counter->stats.passes = counter->stats.passes + 1;
+  counter->stats.modified = counter->stats.modified + modified;
+  counter->stats.nanoseconds = counter->stats.nanoseconds + nanoseconds;
+  counter->recent_passes = counter->recent_passes + 1;
+  if (modified)
+  {
+    counter->stats.yields = counter->stats.yields + 1;
+    counter->recent_yields = counter->recent_yields + 1;
+  }
+
+  if (counter->recent_passes == SCHEDULE_WINDOW)
+  {
+    counter->recent_passes = counter->recent_passes / 2;
+    counter->recent_yields = counter->recent_yields / 2;
+  }
+}
+
+/* apply the given technique with the settings of the given scheduler */
+static size_t schedule_apply(grid_t *grid, const schedule_t *schedule,
+                             const technique_t technique)
+{
+  if (technique == technique_fish)
+    return grid_fish(grid, schedule->fish_order);
+
+  if (technique == technique_chains)
+    return grid_chains(grid, schedule->chain_length);
+
+  return grid_technique(grid, technique);
+}
+
+size_t grid_schedule(grid_t *grid, schedule_t *schedule)
+{
+  size_t size = grid_get_size(grid);
+  size_t technique = 0;
+  size_t modified = 0;
+  uint64_t start = 0;
+  counter_t *counters = NULL;
+
+  if (!size)
+    return 2;
+
+  if (schedule)
+    counters = schedule->counters[size_sqrt(size)];
+
+/* a technique only runs when all the cheaper ones are stuck */
+  while (technique < NB_TECHNIQUES)
+  {
+    if (!schedule)
+      modified = grid_technique(grid, technique);
+    else if (!schedule_wants(schedule, &counters[technique], technique,
+                                 size))
+      modified = 0;
+    else
+    {
+      start = clock_ns();
+      modified = schedule_apply(grid, schedule, technique);
+      counter_record(&counters[technique], modified, clock_ns() - start);
+    }
+
+    technique = modified ? 0 : technique + 1;
+  }
+
+  if (!grid_is_consistent(grid))
+    return 2;
+
+  if (!grid_is_solved(grid))
+    return 0;
+
+  return 1;
+}
+
+const technique_stats_t *schedule_get_stats(const schedule_t *schedule,
+                                            const size_t size,
+                                            const technique_t technique)
+{
+  if (!schedule || !grid_check_size(size) || technique >= NB_TECHNIQUES)
+    return NULL;
+
+  return &schedule->counters[size_sqrt(size)][technique].stats;
+}
+
+void schedule_print(const schedule_t *schedule, FILE *fd)
+{
+  const technique_stats_t *stats = NULL;
+
+  if (!schedule || !fd)
+    return;
+
+  for (size_t sqrt = 1; sqrt <= MAX_GRID_SQRT; sqrt = sqrt + 1)
+    for (size_t t = 0; t < NB_TECHNIQUES; t = t + 1)
+    {
+      stats = &schedule->counters[sqrt][t].stats;
+      if (!stats->passes && !stats->skipped)
+        continue;
+
+      fprintf(fd, "%zux%zu %-15s %zu pass(es), %zu useful, %zu subgrid(s)"
+              " modified, %zu skipped, %.0f ns/pass\n", sqrt * sqrt,
+              sqrt * sqrt, technique_name(t), stats->passes, stats->yields,
+              stats->modified, stats->skipped,
+              stats->passes ? (double) stats->nanoseconds / stats->passes
+                            : 0.0);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <colors.h>
+#include <grid.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* mask of every technique */
+#define TECHNIQUES_ALL ((1u << NB_TECHNIQUES) - 1)
+
+/* what the passes of a technique over all the subgrids cost and gave */
+typedef struct
+{
+  size_t passes;
+  size_t yields;
+  size_t modified;
+  size_t skipped;
+  uint64_t nanoseconds;
+} technique_stats_t;
+
+/* Propagation scheduler (forward declaration to hide the implementation).
+   The cheap techniques run to a fixpoint before a more expensive one is
+   tried, and every modification starts over from the cheapest. Per grid
+   size, the techniques which rarely modify anything (e.g. when the solver
+   already propagated singles on a bitboard) are only tried once in a
+   while, and the all-different filtering and the chains are left out of the
+   grids smaller than 16x16 */
+typedef struct schedule_t schedule_t;
+
+/* memory allocation for a scheduler of the techniques of the given mask
+   (bit t for the technique t), adaptive or not */
+schedule_t *schedule_new(const unsigned techniques, const bool adaptive);
+
+/* free the allocated memory of the given scheduler */
+void schedule_free(schedule_t *schedule);
+
+/* set the techniques of the given scheduler, and whether it adapts */
+void schedule_set(schedule_t *schedule, const unsigned techniques,
+                  const bool adaptive);
+
+/* set the order of the largest fishes looked for by the given scheduler
+   (see grid_fish) */
+void schedule_set_fish(schedule_t *schedule, const size_t order);
+
+/* set the number of strong links of the longest chains looked for by the
+   given scheduler (see grid_chains) */
+void schedule_set_chains(schedule_t *schedule, const size_t length);
+
+/* read a list of technique names separated by commas ("all" for every
+   technique) in the given mask. return false if a name is unknown */
+bool schedule_parse(const char *list, unsigned *techniques);
+
+/* apply the techniques of the given scheduler to the given grid until none
+   modifies it (every technique if schedule is NULL), and return a number
+   corresponding to the state of the grid afterward, as grid_heuristics
+   does */
+size_t grid_schedule(grid_t *grid, schedule_t *schedule);
+
+/* return the counters of the given technique on grids of the given size,
+   or NULL */
+const technique_stats_t *schedule_get_stats(const schedule_t *schedule,
+                                            const size_t size,
+                                            const technique_t technique);
+
+/* print the counters of the given scheduler, one line per size and
+   technique used */
+void schedule_print(const schedule_t *schedule, FILE *fd);
+
+#endif /* SCHEDULE_H */
@@ -0,0 +1,573 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <server.h>
+#include <cache.h>
+#include <generator.h>
+#include <grid.h>
+#include <pool.h>
+#include <rate.h>
+#include <reservoir.h>
+#include <solver.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define MAX_ID_SIZE 64
+#define ANSWER_SIZE (GRID_LINE_LENGTH(MAX_GRID_SIZE) + MAX_ID_SIZE + 64)
+
+/* number of puzzles generated to find one of the requested difficulty when
+   the reservoir has none */
+#define RATED_ATTEMPTS 64
+
+/* milliseconds between two checks of a shutdown request by the listener */
+#define LISTEN_PERIOD 200
+
+/* a client, shared by its reader and by the jobs of its pending requests.
+   The connections being read are chained, to be shut down on exit */
+typedef struct connection_t
+{
+  int fd;
+  bool owned;
+  pthread_mutex_t lock;
+  size_t refs;
+  struct connection_t *next;
+} connection_t;
+
+typedef struct
+{
+  connection_t *connection;
+  char *line;
+} request_t;
+
+/* private state of a worker, kept warm from one request to the next */
+typedef struct
+{
+  solver_t *solver;
+  char *answer;
+} worker_t;
+
+static pool_t *server_pool = NULL;
+static cache_t *server_cache = NULL;
+static reservoir_t *server_reservoir = NULL;
+static void *(*server_solver)(void) = NULL;
+
+/* set by SIGINT and SIGTERM to stop the listener */
+static volatile sig_atomic_t server_stop = 0;
+
+/* connections of the listener whose requests are still being read */
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t server_done = PTHREAD_COND_INITIALIZER;
+static connection_t *server_readers = NULL;
+
+static connection_t *connection_new(const int fd, const bool owned)
+{
+  connection_t *connection = calloc(1, sizeof(connection_t));
+  if (!connection)
+    return NULL;
+
+  connection->fd = fd;
+  connection->owned = owned;
+  connection->refs = 1;
+  pthread_mutex_init(&connection->lock, NULL);
+
+  return connection;
+}
+
+static void connection_acquire(connection_t *connection)
+{
+  pthread_mutex_lock(&connection->lock);
+  connection->refs = connection->refs + 1;
+  pthread_mutex_unlock(&connection->lock);
+}
+
+static void connection_release(connection_t *connection)
+{
+  size_t refs = 0;
+
+  pthread_mutex_lock(&connection->lock);
+  connection->refs = connection->refs - 1;
+  refs = connection->refs;
+  pthread_mutex_unlock(&connection->lock);
+
+  if (refs)
+    return;
+
+  if (connection->owned)
+    close(connection->fd);
+
+  pthread_mutex_destroy(&connection->lock);
+  free(connection);
+}
+
+/* write a whole answer line at once, so that answers never interleave */
+static void connection_write(connection_t *connection, const char *answer,
+                             const size_t length)
+{
+  size_t done = 0;
+  ssize_t written = 0;
+
+  pthread_mutex_lock(&connection->lock);
+  while (done < length)
+  {
+    written = write(connection->fd, answer + done, length - done);
+    if (written < 0 && errno == EINTR)
+      continue;
+
+    if (written <= 0)
+      break;
+
+    done = done + written;
+  }
+  pthread_mutex_unlock(&connection->lock);
+}
+
+static void *worker_new(void)
+{
+  worker_t *worker = calloc(1, sizeof(worker_t));
+  if (!worker)
+    return NULL;
+
+  worker->solver = server_solver ? server_solver() : solver_new(mode_first);
+  worker->answer = calloc(ANSWER_SIZE, sizeof(char));
+  if (!worker->solver || !worker->answer)
+  {
+    solver_free(worker->solver);
+    free(worker->answer);
+    free(worker);
+
+    return NULL;
+  }
+
+  return worker;
+}
+
+static void worker_free(void *state)
+{
+  worker_t *worker = state;
+
+  if (!worker)
+    return;
+
+  solver_free(worker->solver);
+  free(worker->answer);
+  free(worker);
+}
+
+/* read the value of an option 'name=value' in the given token */
+static bool option_value(const char *token, const char *name, size_t *value)
+{
+  size_t length = strlen(name);
+
+  if (strncmp(token, name, length) || token[length] != '=')
+    return false;
+
+  *value = strtoul(token + length + 1, NULL, 10);
+
+  return true;
+}
+
+/* handle a solve or a count request, whose options start at the given token
+   and are followed by the grid. return the length of the answer */
+static int request_search(worker_t *worker, const char *id, char *token,
+                          char **save, const solver_mode_t mode)
+{
+  size_t nodes = 0;
+  size_t milliseconds = 0;
+  size_t limit = 0;
+  size_t length = 0;
+  grid_t *grid = NULL;
+  grid_t *solution = NULL;
+  solver_outcome_t outcome = outcome_unsolvable;
+
+  while (token && (option_value(token, "nodes", &nodes) ||
+                   option_value(token, "ms", &milliseconds) ||
+                   option_value(token, "limit", &limit)))
+    token = strtok_r(NULL, " \t", save);
+
+/* the grid is the rest of the line, blanks included */
+  if (token && *save != token + strlen(token))
+    token[strlen(token)] = ' ';
+
+  grid = grid_from_line(token);
+  if (!grid)
+    return snprintf(worker->answer, ANSWER_SIZE, "%s error invalid grid\n",
+                    id);
+
+  solver_set_mode(worker->solver, mode);
+  solver_set_limit(worker->solver, limit);
+  solver_set_budget(worker->solver, nodes, milliseconds);
+  if (mode == mode_first)
+    outcome = cache_solve(server_cache, worker->solver, grid, &solution);
+  else
+    outcome = solver_run(worker->solver, grid);
+
+  grid_free(grid);
+
+  if (mode == mode_count)
+    return snprintf(worker->answer, ANSWER_SIZE, "%s %s %zu\n", id,
+                    outcome == outcome_budget ? "budget" : "count",
+                    solver_get_count(worker->solver));
+
+  if (outcome == outcome_budget)
+    return snprintf(worker->answer, ANSWER_SIZE, "%s budget\n", id);
+
+  if (outcome == outcome_unsolvable)
+    return snprintf(worker->answer, ANSWER_SIZE, "%s unsolvable\n", id);
+
+  length = snprintf(worker->answer, ANSWER_SIZE, "%s solved ", id);
+  length = length + grid_to_line(solution, worker->answer + length,
+                                 ANSWER_SIZE - length - 1);
+  worker->answer[length] = '\n';
+  grid_free(solution);
+
+  return length + 1;
+}
+
+/* handle a generate request whose options start at the given token. Grids
+   with a unique solution are taken from the reservoir when it has some */
+static int request_generate(worker_t *worker, const char *id, char *token,
+                            char **save)
+{
+  size_t size = 9;
+  bool unique = false;
+  difficulty_t difficulty = difficulty_any;
+  size_t length = 0;
+  grid_t *grid = NULL;
+
+  for (; token; token = strtok_r(NULL, " \t", save))
+  {
+    if (!strcmp(token, "unique"))
+      unique = true;
+    else if (!strncmp(token, "difficulty=", 11) &&
+             difficulty_from_name(token + 11, &difficulty))
+      unique = true;
+    else if (!option_value(token, "size", &size))
+      return snprintf(worker->answer, ANSWER_SIZE,
+                      "%s error unknown option '%s'\n", id, token);
+  }
+
+  if (!grid_check_size(size))
+    return snprintf(worker->answer, ANSWER_SIZE, "%s error invalid size\n",
+                    id);
+
+  if (!unique)
+    grid = grid_generate_from(size, false, solver_get_rng(worker->solver));
+  else
+  {
+    grid = reservoir_pop(server_reservoir, size, difficulty);
+    if (!grid)
+      grid = grid_generate_rated(size, difficulty, RATED_ATTEMPTS,
+                                 worker->solver);
+  }
+
+  if (!grid)
+    return snprintf(worker->answer, ANSWER_SIZE,
+                    "%s error no grid of this difficulty\n", id);
+
+  length = snprintf(worker->answer, ANSWER_SIZE, "%s generated ", id);
+  length = length + grid_to_line(grid, worker->answer + length,
+                                 ANSWER_SIZE - length - 1);
+  worker->answer[length] = '\n';
+  grid_free(grid);
+
+  return length + 1;
+}
+
+static void request_run(void *arg, void *state)
+{
+  request_t *request = arg;
+  worker_t *worker = state;
+  char id[MAX_ID_SIZE + 1] = "?";
+  char error[MAX_ID_SIZE + 64];
+  char *save = NULL;
+  char *token = strtok_r(request->line, " \t", &save);
+  int length = 0;
+
+  if (token)
+  {
+    strncpy(id, token, MAX_ID_SIZE);
+    id[MAX_ID_SIZE] = '\0';
+    token = strtok_r(NULL, " \t", &save);
+  }
+
+  if (!worker)
+  {
+    length = snprintf(error, sizeof(error),
+                      "%s error no memory for the worker\n", id);
+    connection_write(request->connection, error, length);
+    length = 0;
+  }
+  else if (!token)
+    length = snprintf(worker->answer, ANSWER_SIZE, "%s error no command\n",
+                      id);
+  else if (!strcmp(token, "solve"))
+    length = request_search(worker, id, strtok_r(NULL, " \t", &save), &save,
+                            mode_first);
+  else if (!strcmp(token, "count"))
+    length = request_search(worker, id, strtok_r(NULL, " \t", &save), &save,
+                            mode_count);
+  else if (!strcmp(token, "generate"))
+    length = request_generate(worker, id, strtok_r(NULL, " \t", &save),
+                              &save);
+  else
+    length = snprintf(worker->answer, ANSWER_SIZE,
+                      "%s error unknown command '%s'\n", id, token);
+
+  if (length > 0)
+    connection_write(request->connection, worker->answer,
+                     length < ANSWER_SIZE ? (size_t) length : ANSWER_SIZE - 1);
+
+  connection_release(request->connection);
+  free(request->line);
+  free(request);
+}
+
+/* read the requests of the given connection until its end, and hand them
+   to the workers */
+static void connection_read(connection_t *connection, FILE *in)
+{
+  char *line = NULL;
+  size_t capacity = 0;
+  ssize_t length = 0;
+  request_t *request = NULL;
+
+  while ((length = getline(&line, &capacity, in)) > 0)
+  {
+    while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+      length = length - 1;
+
+    line[length] = '\0';
+    if (!length || line[0] == '#')
+      continue;
+
+    request = calloc(1, sizeof(request_t));
+    if (!request)
+      break;
+
+    request->connection = connection;
+    request->line = strdup(line);
+    connection_acquire(connection);
+    if (!request->line || !pool_submit(server_pool, request_run, request))
+    {
+      free(request->line);
+      free(request);
+      connection_release(connection);
+      break;
+    }
+  }
+
+  free(line);
+}
+
+/* remove the given connection from the ones being read */
+static void connection_done(connection_t *connection)
+{
+  connection_t **link = &server_readers;
+
+  pthread_mutex_lock(&server_lock);
+  while (*link && *link != connection)
+    link = &(*link)->next;
+
+  if (*link)
+    *link = connection->next;
+
+  pthread_cond_broadcast(&server_done);
+  pthread_mutex_unlock(&server_lock);
+}
+
+static void *connection_thread(void *data)
+{
+  connection_t *connection = data;
+  FILE *in = NULL;
+  int fd = dup(connection->fd);
+
+  if (fd >= 0)
+    in = fdopen(fd, "r");
+
+  if (in)
+  {
+    connection_read(connection, in);
+    fclose(in);
+  }
+  else if (fd >= 0)
+    close(fd);
+
+  connection_done(connection);
+  connection_release(connection);
+
+  return NULL;
+}
+
+static void server_signal(int signal)
+{
+  (void) signal;
+  server_stop = 1;
+}
+
+/* stop reading the connections still open, and wait for their readers: the
+   answers of the requests already read are still written */
+static void server_drain(void)
+{
+  pthread_mutex_lock(&server_lock);
+  for (connection_t *connection = server_readers; connection;
+       connection = connection->next)
+    shutdown(connection->fd, SHUT_RD);
+
+  while (server_readers)
+    pthread_cond_wait(&server_done, &server_lock);
+
+  pthread_mutex_unlock(&server_lock);
+}
+
+static bool server_listen(const char *path)
+{
+  struct sockaddr_un address;
+  struct sigaction action;
+  struct sigaction previous[3];
+  struct pollfd pending;
+  int listener = -1;
+  int ready = 0;
+  int fd = -1;
+  connection_t *connection = NULL;
+  pthread_t thread;
+  bool status = true;
+
+  if (strlen(path) >= sizeof(address.sun_path))
+    return false;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0)
+    return false;
+
+  unlink(path);
+  if (bind(listener, (struct sockaddr *) &address, sizeof(address)) ||
+      listen(listener, SOMAXCONN))
+  {
+    close(listener);
+
+    return false;
+  }
+
+/* SIGINT and SIGTERM stop the server, a client leaving does not */
+  memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = server_signal;
+  server_stop = 0;
+  sigaction(SIGINT, &action, &previous[0]);
+  sigaction(SIGTERM, &action, &previous[1]);
+  action.sa_handler = SIG_IGN;
+  sigaction(SIGPIPE, &action, &previous[2]);
+
+  pending.fd = listener;
+  pending.events = POLLIN;
+  while (!server_stop)
+  {
+    ready = poll(&pending, 1, LISTEN_PERIOD);
+    if (!ready || (ready < 0 && errno == EINTR))
+      continue;
+
+    fd = ready < 0 ? -1 : accept(listener, NULL, NULL);
+    if (fd < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      status = false;
+      break;
+    }
+
+    connection = connection_new(fd, true);
+    if (!connection)
+    {
+      close(fd);
+      continue;
+    }
+
+/* the chain holds the reference of the reader until it is done */
+    pthread_mutex_lock(&server_lock);
+    connection->next = server_readers;
+    server_readers = connection;
+    pthread_mutex_unlock(&server_lock);
+    if (pthread_create(&thread, NULL, connection_thread, connection))
+    {
+      connection_done(connection);
+      connection_release(connection);
+      continue;
+    }
+
+    pthread_detach(thread);
+  }
+
+  close(listener);
+  unlink(path);
+  server_drain();
+  sigaction(SIGINT, &previous[0], NULL);
+  sigaction(SIGTERM, &previous[1], NULL);
+  sigaction(SIGPIPE, &previous[2], NULL);
+
+  return status;
+}
+
+bool server_run(const char *path, const size_t nb_workers,
+                const size_t cache_size, reservoir_t *reservoir,
+                void *(*new_solver)(void))
+{
+  connection_t *connection = NULL;
+  bool status = true;
+
+  if (cache_size)
+  {
+    server_cache = cache_new(cache_size);
+    if (!server_cache)
+      return false;
+  }
+
+  server_reservoir = reservoir;
+  server_solver = new_solver;
+  server_pool = pool_new(nb_workers, worker_new, worker_free);
+  if (!server_pool)
+  {
+    cache_free(server_cache);
+    server_cache = NULL;
+
+    return false;
+  }
+
+  if (path)
+    status = server_listen(path);
+  else
+  {
+    connection = connection_new(STDOUT_FILENO, false);
+    if (!connection)
+      status = false;
+    else
+    {
+      connection_read(connection, stdin);
+      pool_wait(server_pool);
+      connection_release(connection);
+    }
+  }
+
+  pool_free(server_pool);
+  server_pool = NULL;
+  cache_free(server_cache);
+  server_cache = NULL;
+  server_reservoir = NULL;
+  server_solver = NULL;
+
+  return status;
+}
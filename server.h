@@ -0,0 +1,47 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <reservoir.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Line protocol of the server. Each request is one line, made of an ID
+   chosen by the client, a command, options and a grid written on a single
+   line (see grid_from_line):
+
+     ID solve [nodes=N] [ms=N] GRID
+     ID count [limit=N] [nodes=N] [ms=N] GRID
+     ID generate [size=N] [unique] [difficulty=easy|medium|hard|any]
+
+   Requests are pipelined: a client may send many of them without waiting,
+   the answers come back as soon as they are ready, in any order, each one
+   starting with the ID of its request:
+
+     ID solved GRID | ID unsolvable | ID budget
+     ID count N | ID budget N
+     ID generated GRID
+     ID error MESSAGE
+
+   'nodes' and 'ms' bound the search of one request, 'limit' stops a count
+   after N solutions. When the server has a cache, solve requests first look
+   for the canonical form of their grid in it. A difficulty implies a unique
+   solution; such grids are taken from the reservoir of ready puzzles when
+   it has one of the requested size and difficulty, and are generated and
+   rated on the spot otherwise. */
+
+/* serve the requests sent on the unix socket at the given path until
+   SIGINT or SIGTERM, or on the standard input when path is NULL (the
+   answers are then written on the standard output and the server stops at
+   the end of the input), with the given number of workers, a shared cache
+   of the given number of grids ('0' for none) and the given reservoir (may
+   be NULL). Each worker searches with a solver made by new_solver, set up
+   with the options of the command line (solver_new(mode_first) if NULL).
+   On a signal, the connections stop being read and the requests already
+   read are answered. return false if the server could not start or could
+   not accept connections any more */
+bool server_run(const char *path, const size_t nb_workers,
+                const size_t cache_size, reservoir_t *reservoir,
+                void *(*new_solver)(void));
+
+#endif /* SERVER_H */
@@ -0,0 +1,482 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <session.h>
+#include <colors.h>
+#include <grid.h>
+#include <schedule.h>
+#include <solver.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* nodes given to each search of a repair before the whole grid is searched
+   again */
+#define SESSION_REPAIR_NODES 256
+
+/* the cells freed by a repair: the units of the edited cell first, then
+   also the cells holding its old or its new color */
+#define SESSION_REPAIR_LEVELS 2
+
+/* techniques propagating the clues of a session, cheap enough to run at
+   every edit */
+#define SESSION_TECHNIQUES ((1u << technique_cross_hatching) | \
+                            (1u << technique_lone_number))
+
+/* Interal structure (hiden from outside) to represent a session */
+struct session_t
+{
+  solver_t *solver;
+  schedule_t *schedule;
+  grid_t *clues;
+/* colors left by propagating the clues, valid only if reduced_valid: an
+   added clue only narrows them, a removed one invalidates them */
+  grid_t *reduced;
+  bool reduced_valid;
+  grid_t *solution;
+  solver_outcome_t outcome;
+  session_step_t step;
+  size_t nodes;
+};
+
+session_t *session_new(solver_t *solver)
+{
+  session_t *session = NULL;
+
+  if (!solver)
+    return NULL;
+
+  session = calloc(1, sizeof(session_t));
+  if (!session)
+    return NULL;
+
+  session->schedule = schedule_new(SESSION_TECHNIQUES, false);
+  if (!session->schedule)
+  {
+    free(session);
+
+    return NULL;
+  }
+
+  session->solver = solver;
+  session->outcome = outcome_unsolvable;
+
+  return session;
+}
+
+void session_free(session_t *session)
+{
+  if (!session)
+    return;
+
+  grid_free(session->clues);
+  grid_free(session->reduced);
+  grid_free(session->solution);
+  schedule_free(session->schedule);
+  free(session);
+}
+
+/* search the given grid with the given budget of nodes ('0': no limit),
+   and keep its solution if it has one */
+static solver_outcome_t session_search(session_t *session, const grid_t *grid,
+                                       const size_t nodes)
+{
+  solver_outcome_t outcome = outcome_unsolvable;
+
+  solver_set_mode(session->solver, mode_first);
+  solver_set_budget(session->solver, nodes, 0);
+  outcome = solver_run(session->solver, grid);
+  session->nodes = session->nodes + solver_get_nodes(session->solver);
+  if (outcome == outcome_solved)
+  {
+    grid_free(session->solution);
+    session->solution = solver_take_solution(session->solver);
+  }
+
+  return outcome;
+}
+
+/* bring the colors left by the clues up to date and propagate them. return
+   false if they show the puzzle unsolvable */
+static bool session_reduce(session_t *session)
+{
+  if (!session->reduced_valid)
+  {
+    grid_free(session->reduced);
+    session->reduced = grid_copy(session->clues);
+    if (!session->reduced)
+      return false;
+
+    session->reduced_valid = true;
+  }
+
+  return grid_schedule(session->reduced, session->schedule) != 2;
+}
+
+/* check if the cell of given index is freed by a repair of the given level
+   after an edit of the given cell, whose old color is given */
+static bool session_freed(const session_t *session, const size_t index,
+                          const size_t row, const size_t column,
+                          const colors_t color, const size_t level)
+{
+  size_t size = grid_get_size(session->clues);
+  size_t sqrt = 1;
+  size_t cell_row = index / size;
+  size_t cell_column = index % size;
+  colors_t edited = grid_get_colors(session->clues, row, column);
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  if (cell_row == row || cell_column == column ||
+      (cell_row / sqrt == row / sqrt && cell_column / sqrt == column / sqrt))
+    return true;
+
+  if (level == 0)
+    return false;
+
+  return colors_and(grid_get_colors(session->solution, cell_row, cell_column),
+                    colors_or(color, edited)) != 0;
+}
+
+/* look for a solution close to the old one after an edit of the given cell,
+   by searching the colors left with the cells far from the edit held to
+   their old colors, farther and farther. return true if one is found */
+static bool session_repair(session_t *session, const size_t row,
+                           const size_t column)
+{
+  size_t size = grid_get_size(session->clues);
+  grid_t *grid = NULL;
+  colors_t old = colors_empty();
+  colors_t color = grid_get_colors(session->solution, row, column);
+
+  for (size_t level = 0; level < SESSION_REPAIR_LEVELS; level = level + 1)
+  {
+    grid = grid_copy(session->reduced);
+    if (!grid)
+      return false;
+
+    for (size_t i = 0; i < size * size; i = i + 1)
+    {
+      old = grid_get_colors(session->solution, i / size, i % size);
+      if (!session_freed(session, i, row, column, color, level) &&
+          colors_is_subset(old, grid_get_colors(grid, i / size, i % size)))
+        grid_set_colors(grid, i / size, i % size, old);
+    }
+
+    if (session_search(session, grid, SESSION_REPAIR_NODES) == outcome_solved)
+    {
+      grid_free(grid);
+
+      return true;
+    }
+
+    grid_free(grid);
+  }
+
+  return false;
+}
+
+/* answer the puzzle from the colors left by its clues, after an edit of the
+   given cell if repair is true */
+static solver_outcome_t session_solve(session_t *session, const size_t row,
+                                      const size_t column, const bool repair)
+{
+  if (!session_reduce(session))
+  {
+    session->step = step_propagated;
+
+    return outcome_unsolvable;
+  }
+
+  if (repair && session->solution && session_repair(session, row, column))
+  {
+    session->step = step_repaired;
+
+    return outcome_solved;
+  }
+
+  session->step = step_searched;
+
+  return session_search(session, session->reduced, 0);
+}
+
+solver_outcome_t session_load(session_t *session, const grid_t *grid)
+{
+  if (!session || !grid)
+    return outcome_unsolvable;
+
+  grid_free(session->clues);
+  grid_free(session->solution);
+  session->solution = NULL;
+  session->reduced_valid = false;
+  session->nodes = 0;
+  session->clues = grid_copy(grid);
+  if (!session->clues)
+    return session->outcome = outcome_unsolvable;
+
+  session->outcome = session_solve(session, 0, 0, false);
+  if (session->outcome != outcome_solved)
+  {
+    grid_free(session->solution);
+    session->solution = NULL;
+  }
+
+  return session->outcome;
+}
+
+bool session_edit(session_t *session, const size_t row, const size_t column,
+                  const colors_t color)
+{
+  size_t size = 0;
+  colors_t clue = colors_empty();
+  colors_t full = colors_empty();
+  colors_t left = colors_empty();
+
+  if (!session || !session->clues)
+    return false;
+
+  size = grid_get_size(session->clues);
+  full = colors_full(size);
+  if (row >= size || column >= size || (color &&
+      (!colors_is_singleton(color) || !colors_is_subset(color, full))))
+    return false;
+
+  session->nodes = 0;
+  session->step = step_kept;
+  clue = grid_get_colors(session->clues, row, column);
+  if (colors_is_singleton(clue) && colors_is_equal(clue, color))
+    return true;
+
+/* a removed clue, or a replaced one, leaves colors the old clue excluded */
+  if (colors_is_singleton(clue))
+    session->reduced_valid = false;
+
+  grid_set_colors(session->clues, row, column, color ? color : full);
+  if (!color)
+  {
+    if (session->outcome != outcome_solved)
+      session->outcome = session_solve(session, row, column, false);
+
+    return true;
+  }
+
+  if (session->reduced_valid)
+  {
+    left = colors_and(grid_get_colors(session->reduced, row, column), color);
+    grid_set_colors(session->reduced, row, column, left);
+    if (!left)
+    {
+      session->step = step_propagated;
+      session->outcome = outcome_unsolvable;
+      grid_free(session->solution);
+      session->solution = NULL;
+
+      return true;
+    }
+  }
+
+/* a clue added to an unsolvable puzzle keeps it unsolvable */
+  if (!colors_is_singleton(clue) && session->outcome == outcome_unsolvable)
+    return true;
+
+  if (session->outcome == outcome_solved &&
+      colors_is_equal(grid_get_colors(session->solution, row, column), color))
+    return true;
+
+  session->outcome = session_solve(session, row, column,
+                                   session->outcome == outcome_solved);
+  if (session->outcome != outcome_solved)
+  {
+    grid_free(session->solution);
+    session->solution = NULL;
+  }
+
+  return true;
+}
+
+solver_outcome_t session_get_outcome(const session_t *session)
+{
+  if (!session)
+    return outcome_unsolvable;
+
+  return session->outcome;
+}
+
+const grid_t *session_get_solution(const session_t *session)
+{
+  if (!session)
+    return NULL;
+
+  return session->solution;
+}
+
+session_step_t session_get_step(const session_t *session)
+{
+  if (!session)
+    return step_kept;
+
+  return session->step;
+}
+
+size_t session_get_nodes(const session_t *session)
+{
+  if (!session)
+    return 0;
+
+  return session->nodes;
+}
+
+const char *session_step_name(const session_step_t step)
+{
+  switch (step)
+  {
+    case step_kept:
+      return "kept";
+
+    case step_propagated:
+      return "propagated";
+
+    case step_repaired:
+      return "repaired";
+
+    case step_searched:
+      return "searched";
+  }
+
+  return "unknown";
+}
+
+/* read the edit 'ROW COLUMN COLOR' (from 1, '_' to remove the clue) of the
+   given line for the puzzle of the given session. return false if the line
+   is not an edit */
+static bool session_parse(const session_t *session, const char *line,
+                          size_t *row, size_t *column, colors_t *color)
+{
+  char name[8];
+  size_t size = grid_get_size(session->clues);
+  size_t index = 0;
+  int end = 0;
+
+  if (sscanf(line, "%zu %zu %7s %n", row, column, name, &end) != 3 ||
+      line[end] != '\0')
+    return false;
+
+  if (!*row || !*column || *row > size || *column > size)
+    return false;
+
+  *row = *row - 1;
+  *column = *column - 1;
+  *color = colors_empty();
+  if (!strcmp(name, "_"))
+    return true;
+
+  if (!grid_color_from_name(size, name, &index))
+    return false;
+
+  *color = colors_set(index);
+
+  return true;
+}
+
+/* write the answer of the last load or edit of the given session */
+static void session_answer(const session_t *session, FILE *fd, char *buffer,
+                           const size_t length)
+{
+  solver_outcome_t outcome = session_get_outcome(session);
+
+  if (outcome != outcome_solved ||
+      !grid_to_line(session->solution, buffer, length))
+    fprintf(fd, "%s %s\n",
+            outcome == outcome_budget ? "budget" : "unsolvable",
+            session_step_name(session->step));
+  else
+    fprintf(fd, "solved %s %s\n", session_step_name(session->step),
+            buffer);
+}
+
+bool session_run(const char *path, FILE *fd, solver_t *solver,
+                 const bool verbose)
+{
+  FILE *input = NULL;
+  session_t *session = NULL;
+  char *line = NULL;
+  size_t capacity = 0;
+  ssize_t length = 0;
+  char *buffer = NULL;
+  grid_t *grid = NULL;
+  size_t row = 0;
+  size_t column = 0;
+  colors_t color = colors_empty();
+  uint64_t start = 0;
+  bool success = false;
+
+  if (!path || !fd || !solver)
+    return false;
+
+  input = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!input)
+    return false;
+
+  session = session_new(solver);
+  buffer = malloc(GRID_LINE_LENGTH(MAX_GRID_SIZE));
+  if (!session || !buffer)
+    goto cleanup;
+
+  while ((length = getline(&line, &capacity, input)) > 0)
+  {
+    while (length && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+      length = length - 1;
+
+    line[length] = '\0';
+    if (!length)
+      continue;
+
+    start = trace_clock();
+    if (session->clues && session_parse(session, line, &row, &column, &color))
+    {
+      if (!session_edit(session, row, column, color))
+      {
+        fprintf(fd, "error invalid edit\n");
+        fflush(fd);
+        continue;
+      }
+    }
+    else
+    {
+/* a line which is not an edit is a new puzzle */
+      grid = grid_from_line(line);
+      if (!grid)
+      {
+        fprintf(fd, "error malformed grid\n");
+        fflush(fd);
+        continue;
+      }
+
+      session_load(session, grid);
+      grid_free(grid);
+    }
+
+    if (verbose)
+      fprintf(stderr, "%s in %.1f us, %zu node(s)\n",
+              session_step_name(session->step),
+              (trace_clock() - start) / 1000.0, session->nodes);
+
+    session_answer(session, fd, buffer, GRID_LINE_LENGTH(MAX_GRID_SIZE));
+    fflush(fd);
+  }
+
+  success = !ferror(input);
+
+  cleanup:
+    session_free(session);
+    free(buffer);
+    free(line);
+    if (input != stdin)
+      fclose(input);
+
+  return success;
+}
@@ -0,0 +1,74 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <colors.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* how the answer of the last load or edit of a session was found */
+typedef enum
+{
+  step_kept,
+  step_propagated,
+  step_repaired,
+  step_searched
+} session_step_t;
+
+/* Puzzle edited one clue at a time (forward declaration to hide the
+   implementation). The session keeps the solution of the puzzle and the
+   colors left by propagating its clues, so that an edit is answered from
+   them when it can: a removed clue, or an added one agreeing with the
+   solution, keep the solution; an added clue the colors left exclude makes
+   the puzzle unsolvable. Otherwise the search starts over from the colors
+   left, first with the cells far from the edit held to their old colors */
+typedef struct session_t session_t;
+
+/* memory allocation for a session searching with the given solver, which
+   the caller keeps and frees. The session sets the mode and the budget of
+   the solver */
+session_t *session_new(solver_t *solver);
+
+/* free the allocated memory of the given session */
+void session_free(session_t *session);
+
+/* start the given session over from the given grid, whose singletons are
+   its clues, and search its solution. return the outcome */
+solver_outcome_t session_load(session_t *session, const grid_t *grid);
+
+/* set the clue of the given cell of the puzzle of the given session to the
+   given color, or remove it if color is empty, and update the solution.
+   return false if the session has no puzzle or the edit is invalid */
+bool session_edit(session_t *session, const size_t row, const size_t column,
+                  const colors_t color);
+
+/* return the outcome of the last load or edit of the given session */
+solver_outcome_t session_get_outcome(const session_t *session);
+
+/* return the solution of the puzzle of the given session, or NULL. The grid
+   stays owned by the session until the next load or edit */
+const grid_t *session_get_solution(const session_t *session);
+
+/* return how the answer of the last load or edit was found */
+session_step_t session_get_step(const session_t *session);
+
+/* return the number of nodes searched by the last load or edit */
+size_t session_get_nodes(const session_t *session);
+
+/* return the name of the given step */
+const char *session_step_name(const session_step_t step);
+
+/* answer the lines of the file at the given path ('-' for the standard
+   input) with a session searching with the given solver: a grid on a line
+   (see grid_from_line) starts the session over, a line 'ROW COLUMN COLOR'
+   (from 1, '_' to remove the clue) edits it. Each line is answered in the
+   given file by 'solved STEP SOLUTION', 'unsolvable STEP' or 'budget STEP'
+   (see session_step_name), and the time taken is written on the standard
+   error if verbose is true. return false if the file could not be read */
+bool session_run(const char *path, FILE *fd, solver_t *solver,
+                 const bool verbose);
+
+#endif /* SESSION_H */
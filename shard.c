@@ -0,0 +1,466 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <shard.h>
+#include <colors.h>
+#include <grid.h>
+#include <schedule.h>
+#include <solver.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* techniques propagating the subgrids of a split: the split must not depend
+   on the options of the processes */
+#define SHARD_TECHNIQUES ((1u << technique_cross_hatching) | \
+                          (1u << technique_lone_number))
+
+/* statistics read in the trailer of a shard file */
+typedef struct
+{
+  bool complete;
+  double ms;
+  size_t nodes;
+} trailer_t;
+
+static const char *shard_kind_name(const shard_kind_t kind)
+{
+  switch (kind)
+  {
+    case shard_batch:
+      return "batch";
+
+    case shard_all:
+      return "all";
+
+    case shard_count:
+      return "count";
+  }
+
+  return "unknown";
+}
+
+bool shard_parse(const char *spec, size_t *shard, size_t *nb_shards)
+{
+  int end = 0;
+
+  if (!spec || !shard || !nb_shards)
+    return false;
+
+  if (sscanf(spec, "%zu/%zu%n", shard, nb_shards, &end) != 2 ||
+      spec[end] != '\0')
+    return false;
+
+  return *nb_shards && *shard < *nb_shards;
+}
+
+void shard_begin(FILE *fd, const size_t shard, const size_t nb_shards,
+                 const shard_kind_t kind)
+{
+  if (fd)
+    fprintf(fd, "# shard %zu/%zu %s\n", shard, nb_shards,
+            shard_kind_name(kind));
+}
+
+void shard_end(FILE *fd, const shard_kind_t kind, const uint64_t elapsed,
+               const size_t nodes)
+{
+  if (!fd)
+    return;
+
+  if (kind == shard_batch)
+    fprintf(fd, "# done in %.3f ms\n", elapsed / 1e6);
+  else
+    fprintf(fd, "# done in %.3f ms, %zu node(s)\n", elapsed / 1e6, nodes);
+}
+
+/* append the given grid to the given list, return false if the memory is
+   lacking */
+static bool shard_push(grid_t ***grids, size_t *nb_grids, size_t *capacity,
+                       grid_t *grid)
+{
+  grid_t **larger = NULL;
+
+  if (*nb_grids == *capacity)
+  {
+    larger = realloc(*grids, 2 * *capacity * sizeof(grid_t *));
+    if (!larger)
+      return false;
+
+    *grids = larger;
+    *capacity = 2 * *capacity;
+  }
+
+  (*grids)[*nb_grids] = grid;
+  *nb_grids = *nb_grids + 1;
+
+  return true;
+}
+
+static void shard_free_grids(grid_t **grids, const size_t nb_grids)
+{
+  if (!grids)
+    return;
+
+  for (size_t i = 0; i < nb_grids; i = i + 1)
+    grid_free(grids[i]);
+
+  free(grids);
+}
+
+/* split each grid of the given level on its choice, the grid with the
+   choice applied first, in the next level. The inconsistent grids are
+   dropped, the solved ones kept. return false if the memory is lacking,
+   and set split to false if no grid could be split */
+static bool shard_level(grid_t **level, const size_t nb_level,
+                        grid_t ***next, size_t *nb_next, size_t *capacity,
+                        schedule_t *schedule, bool *split)
+{
+  grid_t *grid = NULL;
+  grid_t *applied = NULL;
+  choice_t *choice = NULL;
+
+  *split = false;
+  for (size_t i = 0; i < nb_level; i = i + 1)
+  {
+    grid = level[i];
+    level[i] = NULL;
+    if (grid_schedule(grid, schedule) == 2)
+    {
+      grid_free(grid);
+      continue;
+    }
+
+    choice = grid_choice(grid);
+    if (!choice)
+    {
+      if (shard_push(next, nb_next, capacity, grid))
+        continue;
+
+      grid_free(grid);
+
+      return false;
+    }
+
+    applied = grid_copy(grid);
+    if (applied)
+    {
+      grid_choice_apply(applied, choice);
+      grid_choice_discard(grid, choice);
+    }
+
+    grid_choice_free(choice);
+    if (!applied || !shard_push(next, nb_next, capacity, applied))
+    {
+      grid_free(applied);
+      grid_free(grid);
+
+      return false;
+    }
+
+    if (!shard_push(next, nb_next, capacity, grid))
+    {
+      grid_free(grid);
+
+      return false;
+    }
+
+    *split = true;
+  }
+
+  return true;
+}
+
+grid_t **shard_split(const grid_t *grid, const size_t shard,
+                     const size_t nb_shards, size_t *nb_grids)
+{
+  schedule_t *schedule = NULL;
+  grid_t **level = NULL;
+  grid_t **next = NULL;
+  grid_t **kept = NULL;
+  size_t nb_level = 0;
+  size_t nb_next = 0;
+  size_t capacity = 1;
+  bool split = true;
+
+  if (!grid_get_size(grid) || !nb_shards || shard >= nb_shards ||
+      !nb_grids)
+    return NULL;
+
+  *nb_grids = 0;
+  schedule = schedule_new(SHARD_TECHNIQUES, false);
+  level = malloc(sizeof(grid_t *));
+  if (!schedule || !level)
+    goto cleanup;
+
+  level[0] = grid_copy(grid);
+  if (!level[0])
+    goto cleanup;
+
+  nb_level = 1;
+  while (split && nb_level < SHARD_SPLIT_FACTOR * nb_shards)
+  {
+    next = malloc(sizeof(grid_t *));
+    capacity = 1;
+    nb_next = 0;
+    if (!next || !shard_level(level, nb_level, &next, &nb_next, &capacity,
+                              schedule, &split))
+    {
+      shard_free_grids(next, nb_next);
+      next = NULL;
+      goto cleanup;
+    }
+
+    free(level);
+    level = next;
+    nb_level = nb_next;
+    next = NULL;
+  }
+
+/* the subgrids of the shard are taken one out of nb_shards, so that the
+   neighboring subtrees, often of the same sizes, go to different shards */
+  kept = malloc((nb_level / nb_shards + 1) * sizeof(grid_t *));
+  if (!kept)
+    goto cleanup;
+
+  for (size_t i = 0; i < nb_level; i = i + 1)
+    if (i % nb_shards == shard)
+    {
+      kept[*nb_grids] = level[i];
+      level[i] = NULL;
+      *nb_grids = *nb_grids + 1;
+    }
+
+  cleanup:
+    shard_free_grids(level, nb_level);
+    schedule_free(schedule);
+
+  return kept;
+}
+
+solver_outcome_t shard_run(solver_t *solver, const solver_mode_t mode,
+                           const grid_t *grid, const size_t shard,
+                           const size_t nb_shards, FILE *fd, size_t *count)
+{
+  shard_kind_t kind = mode == mode_all ? shard_all : shard_count;
+  grid_t **grids = NULL;
+  size_t nb_grids = 0;
+  const grid_t *solution = NULL;
+  solver_outcome_t outcome = outcome_unsolvable;
+  bool budget = false;
+  size_t nodes = 0;
+  uint64_t start = trace_clock();
+
+  if (!solver || !fd || !count)
+    return outcome_unsolvable;
+
+  *count = 0;
+  grids = shard_split(grid, shard, nb_shards, &nb_grids);
+  if (!grids)
+    return outcome_unsolvable;
+
+  shard_begin(fd, shard, nb_shards, kind);
+  for (size_t i = 0; i < nb_grids && !budget; i = i + 1)
+  {
+    if (kind == shard_count)
+      outcome = solver_run(solver, grids[i]);
+    else if (solver_begin(solver, grids[i]))
+    {
+      while ((solution = solver_next(solver)))
+      {
+        fprintf(fd, "\n");
+        grid_print(solution, fd);
+      }
+
+      outcome = solver_end(solver);
+    }
+
+    *count = *count + solver_get_count(solver);
+    nodes = nodes + solver_get_nodes(solver);
+    budget = outcome == outcome_budget;
+  }
+
+  if (kind == shard_count)
+    fprintf(fd, "%zu solution(s)\n", *count);
+
+  shard_end(fd, kind, trace_clock() - start, nodes);
+  shard_free_grids(grids, nb_grids);
+  if (budget)
+    return outcome_budget;
+
+  return *count ? outcome_solved : outcome_unsolvable;
+}
+
+/* read the next line of the body of the given shard file, return its
+   length, or -1 once the body is over. The trailer, if any, is read in the
+   given statistics */
+static ssize_t shard_line(FILE *input, char **line, size_t *capacity,
+                          trailer_t *trailer)
+{
+  ssize_t length = getline(line, capacity, input);
+
+  if (length < 0)
+    return -1;
+
+  if ((*line)[0] != '#')
+    return length;
+
+  trailer->nodes = 0;
+  trailer->complete = sscanf(*line, "# done in %lf ms, %zu", &trailer->ms,
+                             &trailer->nodes) >= 1;
+
+  return -1;
+}
+
+/* write the lines of the batch shards in the given files back in the order
+   of the batch: the line i is the (i / nb_files)-th of the shard i modulo
+   nb_files. return the number of lines, or -1 if a shard is missing
+   lines */
+static ssize_t shard_interleave(FILE **files, const size_t nb_files, FILE *fd,
+                                char **line, size_t *capacity,
+                                trailer_t *trailers)
+{
+  ssize_t nb_lines = 0;
+  size_t ended = nb_files;
+
+  while (ended == nb_files)
+    for (size_t i = 0; i < nb_files; i = i + 1)
+    {
+      if (shard_line(files[i], line, capacity, &trailers[i]) < 0)
+      {
+        ended = i;
+        break;
+      }
+
+      fputs(*line, fd);
+      nb_lines = nb_lines + 1;
+    }
+
+/* the shards after the first one ended are short of one line at most */
+  for (size_t i = 0; i < nb_files; i = i + 1)
+    if (i != ended && shard_line(files[i], line, capacity, &trailers[i]) >= 0)
+      return -1;
+
+  return nb_lines;
+}
+
+bool shard_merge(char *const *paths, const size_t nb_paths, FILE *fd,
+                 const bool verbose)
+{
+  FILE **files = NULL;
+  trailer_t *trailers = NULL;
+  char *line = NULL;
+  size_t capacity = 0;
+  char name[16];
+  char kind_name[16];
+  size_t shard = 0;
+  size_t nb_shards = 0;
+  size_t items = 0;
+  size_t count = 0;
+  size_t nodes = 0;
+  ssize_t nb_lines = 0;
+  double total = 0;
+  double slowest = 0;
+  FILE *input = NULL;
+  bool success = false;
+
+  if (!paths || !nb_paths || !fd)
+    return false;
+
+  files = calloc(nb_paths, sizeof(FILE *));
+  trailers = calloc(nb_paths, sizeof(trailer_t));
+  if (!files || !trailers)
+    goto cleanup;
+
+/* the files are ordered by the index of their shard */
+  for (size_t i = 0; i < nb_paths; i = i + 1)
+  {
+    input = fopen(paths[i], "r");
+    if (!input)
+      goto cleanup;
+
+    if (getline(&line, &capacity, input) < 0 ||
+        sscanf(line, "# shard %zu/%zu %15s", &shard, &nb_shards, name) != 3 ||
+        nb_shards != nb_paths || shard >= nb_shards || files[shard] ||
+        (i && strcmp(name, kind_name)))
+    {
+      fclose(input);
+      goto cleanup;
+    }
+
+    files[shard] = input;
+    strcpy(kind_name, name);
+  }
+
+  if (!strcmp(kind_name, shard_kind_name(shard_batch)))
+  {
+    nb_lines = shard_interleave(files, nb_paths, fd, &line, &capacity,
+                                trailers);
+    if (nb_lines < 0)
+      goto cleanup;
+
+    items = nb_lines;
+  }
+  else if (!strcmp(kind_name, shard_kind_name(shard_all)))
+  {
+    for (size_t i = 0; i < nb_paths; i = i + 1)
+      while (shard_line(files[i], &line, &capacity, &trailers[i]) >= 0)
+      {
+        fputs(line, fd);
+        if (line[0] == '\n')
+          items = items + 1;
+      }
+  }
+  else if (!strcmp(kind_name, shard_kind_name(shard_count)))
+  {
+    for (size_t i = 0; i < nb_paths; i = i + 1)
+      while (shard_line(files[i], &line, &capacity, &trailers[i]) >= 0)
+      {
+        if (sscanf(line, "%zu", &count) != 1)
+          goto cleanup;
+
+        items = items + count;
+      }
+
+    fprintf(fd, "%zu solution(s)\n", items);
+  }
+  else
+    goto cleanup;
+
+  for (size_t i = 0; i < nb_paths; i = i + 1)
+  {
+    if (!trailers[i].complete)
+      goto cleanup;
+
+    total = total + trailers[i].ms;
+    nodes = nodes + trailers[i].nodes;
+    if (trailers[i].ms > slowest)
+      slowest = trailers[i].ms;
+  }
+
+  if (verbose)
+    fprintf(stderr, "%zu shard(s), %zu %s, %.3f ms in total, %.3f ms for"
+            " the slowest, %zu node(s)\n", nb_paths, items,
+            strcmp(kind_name, shard_kind_name(shard_batch)) ? "solution(s)" :
+            "line(s)", total,
+            slowest, nodes);
+
+  success = true;
+
+  cleanup:
+    if (files)
+      for (size_t i = 0; i < nb_paths; i = i + 1)
+        if (files[i])
+          fclose(files[i]);
+
+    free(files);
+    free(trailers);
+    free(line);
+
+  return success;
+}
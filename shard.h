@@ -0,0 +1,70 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* subgrids the search tree of a grid is split into per shard, so that the
+   shards get subtrees of about the same sizes */
+#define SHARD_SPLIT_FACTOR 8
+
+/* what the body of a shard file holds: the answers of the lines of a batch,
+   the solutions of a part of a search tree, or their number */
+typedef enum
+{
+  shard_batch,
+  shard_all,
+  shard_count
+} shard_kind_t;
+
+/* read a shard 'I/N' (I from 0) in the given index and number of shards,
+   return false if it is invalid */
+bool shard_parse(const char *spec, size_t *shard, size_t *nb_shards);
+
+/* write the header of the shard of the given index out of the given number
+   of shards, whose body is of the given kind, in the given file */
+void shard_begin(FILE *fd, const size_t shard, const size_t nb_shards,
+                 const shard_kind_t kind);
+
+/* write the trailer of a shard of the given kind, with its statistics: the
+   time it took (in nanoseconds) and the nodes searched, in the given file.
+   A shard file without its trailer is incomplete */
+void shard_end(FILE *fd, const shard_kind_t kind, const uint64_t elapsed,
+               const size_t nodes);
+
+/* split the search tree of the given grid on the choices (see grid_choice)
+   of its top levels, each one propagated with the singles, into about
+   SHARD_SPLIT_FACTOR subgrids per shard, in the order of a depth-first
+   search. The subgrids whose position is the given shard modulo the given
+   number of shards are returned, and their number set in nb_grids. The
+   split only depends on the grid, so that the shards of all the processes
+   partition the solutions. return NULL if the memory is lacking */
+grid_t **shard_split(const grid_t *grid, const size_t shard,
+                     const size_t nb_shards, size_t *nb_grids);
+
+/* search the solutions of the given shard of the search tree of the given
+   grid (see shard_split) with the given solver, in the given mode (mode_all
+   or mode_count, as the solver was made), and write the shard file in the
+   given file: the header, the solutions or their number, and the trailer.
+   count is set to the number of solutions found. return the outcome, as
+   solver_run does */
+solver_outcome_t shard_run(solver_t *solver, const solver_mode_t mode,
+                           const grid_t *grid, const size_t shard,
+                           const size_t nb_shards, FILE *fd, size_t *count);
+
+/* combine the shard files at the given paths, all the shards of a same
+   split given in any order, into the output the whole work would have
+   written in the given file: the lines of a batch back in their order, the
+   solutions one shard after the other, or the sum of their numbers. The
+   combined statistics are written on the standard error if verbose is true.
+   return false if a file could not be read, is incomplete, or if the shards
+   do not match */
+bool shard_merge(char *const *paths, const size_t nb_paths, FILE *fd,
+                 const bool verbose);
+
+#endif /* SHARD_H */
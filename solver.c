@@ -0,0 +1,1112 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <solver.h>
+#include <arena.h>
+#include <bitboard.h>
+#include <colors.h>
+#include <grid.h>
+#include <nogood.h>
+#include <rng.h>
+#include <schedule.h>
+#include <trace.h>
+#include <ttable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* number of nodes between two checks of the clock */
+#define CLOCK_PERIOD 64
+
+/* size of the blocks of the arena holding the copies of the grids */
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+/* nogoods are only learned on grids at least this large, where a conflict
+   costs more than its analysis */
+#define LEARNING_MIN_SIZE 49
+#define NOGOOD_CAPACITY 1024
+#define NOGOOD_LENGTH 16
+
+/* past this size, the bitsets of the units are too sparse for the bitboards
+   to pay off */
+#define BITBOARD_MAX_SIZE 49
+
+/* only the last decisions of a conflict, at most this many, are analysed */
+#define ANALYSIS_DEPTH 32
+
+/* the probing is judged on the cells probed in the current run: once it
+   probed PROBE_WARMUP cells, it goes on at every node only if one of them
+   out of PROBE_RATE modified the grid, and otherwise at one node out of
+   PROBE_PERIOD, to notice when it pays off again */
+#define PROBE_WARMUP 16
+#define PROBE_RATE 8
+#define PROBE_PERIOD 16
+
+/* one level of the decision stack: the grid of the node and the choice
+   tried from it. When the first node of a level is kept in the
+   transposition table, its hash, its check and the counters at that time
+   are saved, so that its subtree can be stored once it is done */
+typedef struct
+{
+  grid_t *grid;
+  choice_t *choice;
+  bool keyed;
+  uint64_t hash;
+  uint64_t check;
+  size_t solutions;
+  size_t nodes;
+} frame_t;
+
+/* cells probed at each node by default, per grid size (from its square
+   root). On 9x9 grids a branch on a bitboard is cheaper than the probes,
+   from 25x25 on the nodes saved barely pay for them */
+static const size_t probe_defaults[MAX_GRID_SQRT + 1] = {0, 0, 0, 0, 8, 0,
+                                                         0, 0, 0};
+
+/* Interal structure (hiden from outside) to represent a search context */
+struct solver_t
+{
+  solver_mode_t mode;
+  size_t node_budget;
+  size_t time_budget;
+  size_t limit;
+  bool random;
+  rng_t rng;
+  FILE *fd;
+  solver_visitor_t visitor;
+  void *visitor_arg;
+
+  struct timespec start;
+  size_t nodes;
+  size_t solutions;
+  bool budget_exceeded;
+  grid_t *solution;
+
+/* enumeration by solver_next: the search stops at each solution, keeping
+   the depth of its node, and goes on from there at the next call */
+  bool iterating;
+  bool suspended;
+  size_t depth;
+
+/* decision stack, sized from the grid and kept from one run to the next.
+   The grids and choices of the frames are taken from the arena */
+  arena_t *arena;
+  frame_t *frames;
+  size_t nb_frames;
+  size_t frames_size;
+
+/* conflict analysis, on a scratch grid of the arena */
+  size_t learning;
+  bool learn;
+  nogood_db_t *nogoods;
+  grid_t *scratch;
+
+/* order and selection of the techniques of the propagation */
+  schedule_t *schedule;
+
+/* states already proven dead or counted, kept from one run to the next */
+  ttable_t *table;
+  size_t transpositions;
+
+/* digit-major copy of the grids for the first propagation pass */
+  bool bitboards;
+  bitboard_t *board;
+
+/* nodes recorded, if any, and the passes of the propagation so far */
+  trace_t *trace;
+  size_t passes;
+
+/* failed-literal probing: number of cells probed at each node per grid
+   size, on scratch grids of the arena, and the colors it discarded. The
+   probes are only propagated with the singles */
+  size_t probing[MAX_GRID_SQRT + 1];
+  schedule_t *probe_schedule;
+  grid_t *probe;
+  grid_t *implied;
+  size_t failed;
+  size_t probes;
+  size_t probe_yields;
+};
+
+solver_t *solver_new(const solver_mode_t mode)
+{
+  solver_t *solver = calloc(1, sizeof(solver_t));
+  if (!solver)
+    return NULL;
+
+  solver->arena = arena_new(ARENA_BLOCK_SIZE);
+  solver->schedule = schedule_new(TECHNIQUES_ALL, true);
+  solver->probe_schedule = schedule_new(1u << technique_cross_hatching |
+                                        1u << technique_lone_number, true);
+  if (!solver->arena || !solver->schedule || !solver->probe_schedule)
+  {
+    arena_free(solver->arena);
+    schedule_free(solver->schedule);
+    schedule_free(solver->probe_schedule);
+    free(solver);
+
+    return NULL;
+  }
+
+  solver->mode = mode;
+  solver->fd = stdout;
+  solver->learning = NOGOOD_CAPACITY;
+  solver->bitboards = true;
+  for (size_t i = 0; i <= MAX_GRID_SQRT; i = i + 1)
+    solver->probing[i] = probe_defaults[i];
+
+  rng_init(&solver->rng);
+
+  return solver;
+}
+
+void solver_free(solver_t *solver)
+{
+  if (!solver)
+    return;
+
+  grid_free(solver->solution);
+  arena_free(solver->arena);
+  free(solver->frames);
+  nogood_free(solver->nogoods);
+  bitboard_free(solver->board);
+  schedule_free(solver->schedule);
+  schedule_free(solver->probe_schedule);
+  ttable_free(solver->table);
+  free(solver);
+}
+
+void solver_set_mode(solver_t *solver, const solver_mode_t mode)
+{
+  if (solver)
+    solver->mode = mode;
+}
+
+void solver_set_budget(solver_t *solver, const size_t nodes,
+                       const size_t milliseconds)
+{
+  if (!solver)
+    return;
+
+  solver->node_budget = nodes;
+  solver->time_budget = milliseconds;
+}
+
+void solver_set_limit(solver_t *solver, const size_t solutions)
+{
+  if (solver)
+    solver->limit = solutions;
+}
+
+void solver_set_random(solver_t *solver, const bool random)
+{
+  if (solver)
+    solver->random = random;
+}
+
+rng_t *solver_get_rng(solver_t *solver)
+{
+  if (!solver)
+    return NULL;
+
+  return &solver->rng;
+}
+
+void solver_set_learning(solver_t *solver, const size_t capacity)
+{
+  if (!solver || capacity == solver->learning)
+    return;
+
+  nogood_free(solver->nogoods);
+  solver->nogoods = NULL;
+  solver->learning = capacity;
+}
+
+void solver_set_bitboards(solver_t *solver, const bool bitboards)
+{
+  if (solver)
+    solver->bitboards = bitboards;
+}
+
+void solver_set_techniques(solver_t *solver, const unsigned techniques,
+                           const bool adaptive)
+{
+  if (solver)
+    schedule_set(solver->schedule, techniques, adaptive);
+}
+
+void solver_set_fish(solver_t *solver, const size_t order)
+{
+  if (solver)
+    schedule_set_fish(solver->schedule, order);
+}
+
+void solver_set_chains(solver_t *solver, const size_t length)
+{
+  if (solver)
+    schedule_set_chains(solver->schedule, length);
+}
+
+const schedule_t *solver_get_schedule(const solver_t *solver)
+{
+  if (!solver)
+    return NULL;
+
+  return solver->schedule;
+}
+
+bool solver_set_table(solver_t *solver, const size_t bytes)
+{
+  if (!solver)
+    return false;
+
+  ttable_free(solver->table);
+  solver->table = NULL;
+  if (!bytes)
+    return true;
+
+  solver->table = ttable_new(bytes);
+
+  return solver->table != NULL;
+}
+
+void solver_set_trace(solver_t *solver, trace_t *trace)
+{
+  if (solver)
+    solver->trace = trace;
+}
+
+bool solver_set_probing(solver_t *solver, const size_t size,
+                        const size_t cells)
+{
+  size_t sqrt = 1;
+
+  if (!solver || cells > PROBE_MAX_CELLS || (size && !grid_check_size(size)))
+    return false;
+
+  for (sqrt = 1; sqrt * sqrt < size; sqrt = sqrt + 1)
+    ;
+
+  for (size_t i = 1; i <= MAX_GRID_SQRT; i = i + 1)
+    if (!size || i == sqrt)
+      solver->probing[i] = cells;
+
+  return true;
+}
+
+void solver_set_output(solver_t *solver, FILE *fd)
+{
+  if (solver)
+    solver->fd = fd;
+}
+
+void solver_set_visitor(solver_t *solver, solver_visitor_t visitor,
+                        void *arg)
+{
+  if (!solver)
+    return;
+
+  solver->visitor = visitor;
+  solver->visitor_arg = arg;
+}
+
+static size_t elapsed_ms(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (now.tv_sec - start->tv_sec) * 1000 +
+         (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/* check if the budget of the given solver is exhausted */
+static bool solver_out_of_budget(solver_t *solver)
+{
+  if (solver->budget_exceeded)
+    return true;
+
+  if (solver->node_budget && solver->nodes >= solver->node_budget)
+    solver->budget_exceeded = true;
+
+  if (solver->time_budget && solver->nodes % CLOCK_PERIOD == 0 &&
+      elapsed_ms(&solver->start) >= solver->time_budget)
+    solver->budget_exceeded = true;
+
+  return solver->budget_exceeded;
+}
+
+/* register the given solved grid, return true if the search must stop */
+static bool solver_solution(solver_t *solver, const grid_t *grid)
+{
+  solver->solutions = solver->solutions + 1;
+
+  if (!solver->solution)
+    solver->solution = grid_copy(grid);
+
+  if (solver->iterating)
+    return true;
+
+  if (solver->mode == mode_all && solver->fd)
+  {
+    fprintf(solver->fd, "\n");
+    grid_print(grid, solver->fd);
+  }
+
+  if (solver->mode == mode_all && solver->visitor)
+    solver->visitor(grid, solver->visitor_arg);
+
+  if (solver->mode == mode_first)
+    return true;
+
+  return solver->limit && solver->solutions >= solver->limit;
+}
+
+/* make the decision stack able to hold a search on grids of given size: a
+   decision turns a cell into a singleton, so the depth is at most the
+   number of cells. return false if the memory is lacking */
+static bool solver_reserve(solver_t *solver, const size_t size)
+{
+  size_t nb_frames = size * size + 1;
+  frame_t *frames = NULL;
+
+  if (solver->frames_size != size)
+  {
+    arena_reset(solver->arena);
+    for (size_t i = 0; i < solver->nb_frames; i = i + 1)
+    {
+      solver->frames[i].grid = NULL;
+      solver->frames[i].choice = NULL;
+    }
+    solver->scratch = NULL;
+    solver->probe = NULL;
+    solver->implied = NULL;
+    bitboard_free(solver->board);
+    solver->board = NULL;
+    solver->frames_size = size;
+  }
+
+  if (solver->nb_frames >= nb_frames)
+    return true;
+
+  frames = realloc(solver->frames, nb_frames * sizeof(frame_t));
+  if (!frames)
+    return false;
+
+  for (size_t i = solver->nb_frames; i < nb_frames; i = i + 1)
+  {
+    frames[i].grid = NULL;
+    frames[i].choice = NULL;
+  }
+
+  solver->frames = frames;
+  solver->nb_frames = nb_frames;
+
+  return true;
+}
+
+/* return the frame at the given depth, whose grid and choice are allocated
+   the first time the depth is reached */
+static frame_t *solver_frame(solver_t *solver, const size_t depth)
+{
+  frame_t *frame = &solver->frames[depth];
+
+  if (!frame->grid)
+    frame->grid = grid_alloc_in(solver->arena, solver->frames_size);
+
+  if (!frame->choice)
+    frame->choice = grid_choice_new_in(solver->arena);
+
+  if (!frame->grid || !frame->choice)
+    return NULL;
+
+  return frame;
+}
+
+/* apply the techniques of the given scheduler and the nogoods to the given
+   grid until nothing changes, return its state as grid_heuristics does */
+static size_t solver_propagate_with(solver_t *solver, grid_t *grid,
+                                    schedule_t *schedule)
+{
+  size_t status = 0;
+
+/* singles and hidden singles are first applied to the whole grid at once */
+  if (solver->bitboards && solver->board &&
+      bitboard_from_grid(solver->board, grid))
+  {
+    solver->passes = solver->passes + 1;
+    if (bitboard_propagate(solver->board) == 2)
+      return 2;
+
+    bitboard_to_grid(solver->board, grid);
+  }
+
+  while (true)
+  {
+    solver->passes = solver->passes + 1;
+    status = grid_schedule(grid, schedule);
+
+/* the states are kept in the table by their open cells (see grid_get_hash),
+   which needs the fixed colors crossed out of their units even when the
+   scheduler skips it */
+    if (!status && solver->table &&
+        grid_technique(grid, technique_cross_hatching))
+      continue;
+
+    if (status || !solver->learn)
+      return status;
+
+    switch (nogood_propagate(solver->nogoods, grid))
+    {
+      case 0:
+        return 0;
+
+      case 2:
+        return 2;
+    }
+  }
+}
+
+/* apply the scheduled techniques and the nogoods to the given grid until
+   nothing changes, return its state as grid_heuristics does */
+static size_t solver_propagate(solver_t *solver, grid_t *grid)
+{
+  return solver_propagate_with(solver, grid, solver->schedule);
+}
+
+/* fill the given array with the cells of the given grid with the fewest
+   colors (but at least two), at most the probing budget of the given
+   solver. return their number */
+static size_t solver_probed(const solver_t *solver, const grid_t *grid,
+                            uint16_t *cells)
+{
+  size_t size = grid_get_size(grid);
+  size_t sqrt = 1;
+  size_t budget = 0;
+  size_t nb_cells = 0;
+  size_t count = 0;
+  size_t i = 0;
+  uint16_t counts[PROBE_MAX_CELLS];
+
+  for (sqrt = 1; sqrt * sqrt < size; sqrt = sqrt + 1)
+    ;
+
+  budget = solver->probing[sqrt];
+  for (size_t cell = 0; cell < size * size && budget; cell = cell + 1)
+  {
+    count = colors_count(grid_get_colors(grid, cell / size, cell % size));
+    if (count < 2 || (nb_cells == budget && count >= counts[budget - 1]))
+      continue;
+
+/* insertion in the cells sorted by number of colors, the first ones found
+   are kept among equals */
+    if (nb_cells < budget)
+      nb_cells = nb_cells + 1;
+
+    for (i = nb_cells - 1; i > 0 && counts[i - 1] > count; i = i - 1)
+    {
+      cells[i] = cells[i - 1];
+      counts[i] = counts[i - 1];
+    }
+
+    cells[i] = cell;
+    counts[i] = count;
+  }
+
+  return nb_cells;
+}
+
+/* failed-literal probing of the given propagated grid, neither solved nor
+   inconsistent: each color of a probed cell is tried and propagated on a
+   copy. The colors whose propagation fails are discarded, and every cell
+   keeps only the colors left by at least one of the others, which are
+   implied whatever the color of the probed cell. The probing stops at the
+   first cell which modified the grid, so that it is propagated again.
+   return true if the grid was modified */
+static bool solver_probe(solver_t *solver, grid_t *grid)
+{
+  uint16_t cells[PROBE_MAX_CELLS];
+  size_t nb_cells = solver_probed(solver, grid, cells);
+  size_t size = grid_get_size(grid);
+  size_t row = 0;
+  size_t column = 0;
+  size_t color = 0;
+  colors_t colors = colors_empty();
+  colors_t kept = colors_empty();
+  bool implied = false;
+  bool modified = false;
+
+  if (!nb_cells)
+    return false;
+
+  if (solver->probes >= PROBE_WARMUP &&
+      solver->probe_yields * PROBE_RATE < solver->probes &&
+      solver->nodes % PROBE_PERIOD)
+    return false;
+
+  if (!solver->probe)
+    solver->probe = grid_alloc_in(solver->arena, size);
+
+  if (!solver->implied)
+    solver->implied = grid_alloc_in(solver->arena, size);
+
+  if (!solver->probe || !solver->implied)
+    return false;
+
+  for (size_t i = 0; i < nb_cells && !modified; i = i + 1)
+  {
+    solver->probes = solver->probes + 1;
+    row = cells[i] / size;
+    column = cells[i] % size;
+    kept = grid_get_colors(grid, row, column);
+    implied = false;
+    for (colors = kept; colors;
+         colors = colors_xor(colors, colors_rightmost(colors)))
+    {
+      color = colors_index(colors);
+      grid_copy_into(solver->probe, grid);
+      grid_set_hashing(solver->probe, false);
+      grid_set_colors(solver->probe, row, column, colors_set(color));
+      if (solver_propagate_with(solver, solver->probe,
+                                solver->probe_schedule) == 2)
+      {
+        kept = colors_discard(kept, color);
+        solver->failed = solver->failed + 1;
+        modified = true;
+        continue;
+      }
+
+      if (!implied)
+        grid_copy_into(solver->implied, solver->probe);
+      else
+        for (size_t cell = 0; cell < size * size; cell = cell + 1)
+          grid_set_colors(solver->implied, cell / size, cell % size,
+                          colors_or(grid_get_colors(solver->implied,
+                                                    cell / size,
+                                                    cell % size),
+                                    grid_get_colors(solver->probe,
+                                                    cell / size,
+                                                    cell % size)));
+
+      implied = true;
+    }
+
+/* no color left: the grid is found inconsistent by its next propagation */
+    if (!implied)
+    {
+      grid_set_colors(grid, row, column, colors_empty());
+      solver->probe_yields = solver->probe_yields + 1;
+
+      return true;
+    }
+
+    for (size_t cell = 0; cell < size * size; cell = cell + 1)
+    {
+      colors = grid_get_colors(grid, cell / size, cell % size);
+      kept = colors_and(colors, grid_get_colors(solver->implied, cell / size,
+                                                cell % size));
+      if (colors_is_equal(kept, colors))
+        continue;
+
+      grid_set_colors(grid, cell / size, cell % size, kept);
+      modified = true;
+    }
+  }
+
+  if (modified)
+    solver->probe_yields = solver->probe_yields + 1;
+
+  return modified;
+}
+
+/* check if the grid of the first frame, with the kept decisions, is found
+   inconsistent by the propagation */
+static bool solver_refutes(solver_t *solver, const literal_t *literals,
+                           const bool *keep, const size_t length)
+{
+  size_t size = solver->frames_size;
+  colors_t color = colors_empty();
+
+  grid_copy_into(solver->scratch, solver->frames[0].grid);
+  for (size_t i = 0; i < length; i = i + 1)
+  {
+    if (!keep[i])
+      continue;
+
+    color = colors_set(literals[i].color);
+    if (!colors_and(grid_get_colors(solver->scratch, literals[i].cell / size,
+                                    literals[i].cell % size), color))
+      return true;
+
+    grid_set_colors(solver->scratch, literals[i].cell / size,
+                    literals[i].cell % size, color);
+  }
+
+  return solver_propagate(solver, solver->scratch) == 2;
+}
+
+/* learn a nogood from a conflict met at the given depth: the decisions of
+   the path older than the last ANALYSIS_DEPTH ones are dropped at once,
+   then the others one by one, the most recent first, as long as the
+   remaining ones still lead to a conflict. return the depth of the most
+   recent decision kept, which is where the search jumps back, or depth - 1
+   without learning. dead is set if no decision at all is needed, i.e the
+   search is over */
+static size_t solver_analyze(solver_t *solver, const size_t depth,
+                             bool *dead)
+{
+  literal_t literals[ANALYSIS_DEPTH];
+  literal_t nogood[ANALYSIS_DEPTH];
+  bool keep[ANALYSIS_DEPTH];
+  size_t size = solver->frames_size;
+  size_t row = 0;
+  size_t column = 0;
+  colors_t color = colors_empty();
+  size_t first = depth > ANALYSIS_DEPTH ? depth - ANALYSIS_DEPTH : 0;
+  size_t nb_literals = depth - first;
+  size_t length = 0;
+  size_t target = 0;
+
+  if (!solver->learn || depth < 2)
+    return depth - 1;
+
+  if (!solver->scratch)
+    solver->scratch = grid_alloc_in(solver->arena, size);
+
+  if (!solver->scratch)
+    return depth - 1;
+
+  for (size_t i = 0; i < nb_literals; i = i + 1)
+  {
+    grid_choice_get(solver->frames[first + i].choice, &row, &column, &color);
+    literals[i].cell = row * size + column;
+    literals[i].color = colors_index(color);
+    keep[i] = true;
+  }
+
+/* a conflict the recent decisions do not explain alone is not learned */
+  if (first && !solver_refutes(solver, literals, keep, nb_literals))
+    return depth - 1;
+
+  for (size_t i = nb_literals; i > 0; i = i - 1)
+  {
+    keep[i - 1] = false;
+    keep[i - 1] = !solver_refutes(solver, literals, keep, nb_literals);
+  }
+
+  for (size_t i = 0; i < nb_literals; i = i + 1)
+    if (keep[i])
+    {
+      nogood[length] = literals[i];
+      length = length + 1;
+      target = first + i;
+    }
+
+  if (!length)
+  {
+    *dead = true;
+
+    return 0;
+  }
+
+  nogood_add(solver->nogoods, nogood, length);
+
+  return target;
+}
+
+/* look for the state of the first node of the given frame in the
+   transposition table. return true if its subtree is already known, and
+   add its solutions in mode_count. Otherwise, the state is remembered to be
+   stored when its subtree is done */
+static bool solver_transposed(solver_t *solver, frame_t *frame)
+{
+  size_t count = 0;
+
+  frame->hash = grid_get_hash(frame->grid);
+  frame->check = grid_get_check(frame->grid);
+  if (ttable_lookup(solver->table, frame->hash, frame->check, &count) &&
+      (!count || (solver->mode == mode_count && !solver->iterating)))
+  {
+    solver->solutions = solver->solutions + count;
+    solver->transpositions = solver->transpositions + 1;
+
+    return true;
+  }
+
+  frame->keyed = true;
+  frame->solutions = solver->solutions;
+  frame->nodes = solver->nodes;
+
+  return false;
+}
+
+/* store the states of the frames above the given target depth, whose
+   subtrees are done. After a backjump, the frames jumped over are dead */
+static void solver_store(solver_t *solver, const size_t depth,
+                         const size_t target)
+{
+  frame_t *frame = NULL;
+
+  for (size_t i = target + 1; i <= depth; i = i + 1)
+  {
+    frame = &solver->frames[i];
+    if (!frame->keyed)
+      continue;
+
+    ttable_store(solver->table, frame->hash, frame->check,
+                 solver->solutions - frame->solutions,
+                 solver->nodes - frame->nodes);
+    frame->keyed = false;
+  }
+}
+
+/* record the node of the given frame if the tracer wants it. The node
+   holds the time, the passes and the colors from before its propagation */
+static void solver_trace(solver_t *solver, const frame_t *frame,
+                         trace_node_t *node, const trace_outcome_t outcome)
+{
+  colors_t color = colors_empty();
+
+  if (!trace_wants(solver->trace, solver->nodes))
+    return;
+
+  node->end = trace_clock();
+  node->outcome = outcome;
+  node->passes = solver->passes - node->passes;
+  node->eliminations = node->eliminations - grid_count_colors(frame->grid);
+  if (outcome == trace_branch)
+  {
+    grid_choice_get(frame->choice, &node->row, &node->column, &color);
+    grid_color_name(grid_get_size(frame->grid), colors_index(color),
+                    node->color);
+  }
+
+  trace_node(solver->trace, node);
+}
+
+/* leave the node at the given depth, whose subtree is done, for the frame
+   at the given target depth, which discards its choice. return false if the
+   node is the root */
+static bool solver_backtrack(solver_t *solver, const size_t depth,
+                             const size_t target)
+{
+  frame_t *frame = &solver->frames[target];
+
+  if (!depth)
+    return false;
+
+  if (solver->table)
+    solver_store(solver, depth, target);
+
+  grid_choice_discard(frame->grid, frame->choice);
+
+  return true;
+}
+
+/* explore the grid of the frame at the saved depth without recursion. A
+   node whose grid is neither solved nor inconsistent pushes a frame trying
+   its choice; when the subtree of a choice is done, the frame discards the
+   choice from its grid and becomes a new node at the same depth. When
+   iterating, the search is suspended at each solution */
+static void solver_search(solver_t *solver)
+{
+  size_t depth = solver->depth;
+  frame_t *frame = &solver->frames[depth];
+  frame_t *child = NULL;
+  bool backtrack = false;
+  bool dead = false;
+  size_t target = 0;
+  trace_node_t node;
+  size_t status = 0;
+
+  while (frame)
+  {
+    if (solver_out_of_budget(solver))
+      return;
+
+    solver->nodes = solver->nodes + 1;
+    backtrack = true;
+    target = depth - 1;
+
+    if (solver->trace)
+    {
+      node.depth = depth;
+      node.start = trace_clock();
+      node.passes = solver->passes;
+      node.eliminations = grid_count_colors(frame->grid);
+    }
+
+    status = solver_propagate(solver, frame->grid);
+    while (!status && solver_probe(solver, frame->grid))
+      status = solver_propagate(solver, frame->grid);
+
+    switch (status)
+    {
+      case 2:
+        if (solver->trace)
+          solver_trace(solver, frame, &node, trace_inconsistent);
+
+        if (depth)
+          target = solver_analyze(solver, depth, &dead);
+
+        if (dead)
+          return;
+        break;
+
+      case 1:
+        if (solver->trace)
+          solver_trace(solver, frame, &node, trace_solved);
+
+        if (solver_solution(solver, frame->grid))
+        {
+          solver->suspended = solver->iterating;
+          solver->depth = depth;
+
+          return;
+        }
+        break;
+
+      case 0:
+        if (depth && solver->table && !frame->keyed &&
+            solver_transposed(solver, frame))
+        {
+          if (solver->trace)
+            solver_trace(solver, frame, &node, trace_known);
+
+          if (solver->limit && solver->solutions >= solver->limit)
+            return;
+
+          break;
+        }
+
+        if (!grid_choice_update(frame->grid, frame->choice) ||
+            depth + 1 >= solver->nb_frames)
+          break;
+
+        if (solver->random)
+          grid_choice_randomize(frame->grid, frame->choice, &solver->rng);
+
+        if (solver->trace)
+          solver_trace(solver, frame, &node, trace_branch);
+
+        child = solver_frame(solver, depth + 1);
+        if (!child)
+          return;
+
+        grid_copy_into(child->grid, frame->grid);
+        grid_choice_apply(child->grid, frame->choice);
+        child->keyed = false;
+        depth = depth + 1;
+        frame = child;
+        backtrack = false;
+        break;
+    }
+
+    if (!backtrack)
+      continue;
+
+    if (!solver_backtrack(solver, depth, target))
+      return;
+
+    depth = target;
+    frame = &solver->frames[depth];
+  }
+}
+
+/* return how the last search ended, as the tracer names it */
+static const char *solver_ending(const solver_t *solver)
+{
+  if (solver->budget_exceeded)
+    return "budget";
+
+  if (solver->suspended)
+    return "stopped";
+
+  if (solver->solutions && (solver->mode == mode_first ||
+                            (solver->limit &&
+                             solver->solutions >= solver->limit)))
+    return "solved";
+
+  return "exhausted";
+}
+
+/* get the given solver ready to search the given grid. return false if the
+   memory is lacking */
+static bool solver_start(solver_t *solver, const grid_t *grid)
+{
+  grid_free(solver->solution);
+  solver->solution = NULL;
+  solver->nodes = 0;
+  solver->solutions = 0;
+  solver->budget_exceeded = false;
+  solver->transpositions = 0;
+  solver->failed = 0;
+  solver->probes = 0;
+  solver->probe_yields = 0;
+  solver->iterating = false;
+  solver->suspended = false;
+  solver->depth = 0;
+  clock_gettime(CLOCK_MONOTONIC, &solver->start);
+
+  if (!solver_reserve(solver, grid_get_size(grid)) ||
+      !solver_frame(solver, 0))
+    return false;
+
+  if (solver->learning && grid_get_size(grid) >= LEARNING_MIN_SIZE &&
+      !solver->nogoods)
+    solver->nogoods = nogood_new(solver->learning, NOGOOD_LENGTH);
+
+  nogood_clear(solver->nogoods);
+  solver->learn = solver->nogoods && grid_get_size(grid) >= LEARNING_MIN_SIZE;
+
+  if (solver->bitboards && !solver->board &&
+      grid_get_size(grid) <= BITBOARD_MAX_SIZE)
+    solver->board = bitboard_new(grid_get_size(grid));
+
+  grid_copy_into(solver->frames[0].grid, grid);
+  grid_set_hashing(solver->frames[0].grid, solver->table != NULL);
+
+  return true;
+}
+
+/* return the outcome of the last search of the given solver */
+static solver_outcome_t solver_outcome(const solver_t *solver)
+{
+  if (solver->budget_exceeded)
+    return outcome_budget;
+
+  if (solver->solutions)
+    return outcome_solved;
+
+  return outcome_unsolvable;
+}
+
+/* end the search of the given solver and return its outcome */
+static solver_outcome_t solver_finish(solver_t *solver)
+{
+  if (solver->trace)
+    trace_end(solver->trace, trace_clock(), solver_ending(solver));
+
+  solver->iterating = false;
+  solver->suspended = false;
+
+  return solver_outcome(solver);
+}
+
+solver_outcome_t solver_run(solver_t *solver, const grid_t *grid)
+{
+  if (!solver || !grid_get_size(grid) || !solver_start(solver, grid))
+    return outcome_unsolvable;
+
+  solver_search(solver);
+
+  return solver_finish(solver);
+}
+
+bool solver_begin(solver_t *solver, const grid_t *grid)
+{
+  if (!solver || !grid_get_size(grid) || !solver_start(solver, grid))
+    return false;
+
+  solver->iterating = true;
+
+  return true;
+}
+
+const grid_t *solver_next(solver_t *solver)
+{
+  if (!solver || !solver->iterating)
+    return NULL;
+
+/* the node of the last solution is left as if its subtree were done */
+  if (solver->suspended)
+  {
+    solver->suspended = false;
+    if ((solver->limit && solver->solutions >= solver->limit) ||
+        !solver_backtrack(solver, solver->depth, solver->depth - 1))
+    {
+      solver_finish(solver);
+
+      return NULL;
+    }
+
+    solver->depth = solver->depth - 1;
+  }
+
+  solver_search(solver);
+  if (!solver->suspended)
+  {
+    solver_finish(solver);
+
+    return NULL;
+  }
+
+  return solver->frames[solver->depth].grid;
+}
+
+solver_outcome_t solver_end(solver_t *solver)
+{
+  if (!solver)
+    return outcome_unsolvable;
+
+  if (solver->iterating)
+    return solver_finish(solver);
+
+  return solver_outcome(solver);
+}
+
+const grid_t *solver_get_solution(const solver_t *solver)
+{
+  if (!solver)
+    return NULL;
+
+  return solver->solution;
+}
+
+grid_t *solver_take_solution(solver_t *solver)
+{
+  grid_t *solution = NULL;
+
+  if (!solver)
+    return NULL;
+
+  solution = solver->solution;
+  solver->solution = NULL;
+
+  return solution;
+}
+
+size_t solver_get_count(const solver_t *solver)
+{
+  if (!solver)
+    return 0;
+
+  return solver->solutions;
+}
+
+size_t solver_get_transpositions(const solver_t *solver)
+{
+  if (!solver)
+    return 0;
+
+  return solver->transpositions;
+}
+
+size_t solver_get_failed(const solver_t *solver)
+{
+  if (!solver)
+    return 0;
+
+  return solver->failed;
+}
+
+size_t solver_get_nodes(const solver_t *solver)
+{
+  if (!solver)
+    return 0;
+
+  return solver->nodes;
+}
@@ -0,0 +1,160 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <grid.h>
+#include <rng.h>
+#include <schedule.h>
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* what the solver is looking for */
+typedef enum { mode_first, mode_all, mode_count } solver_mode_t;
+
+/* how a search ended */
+typedef enum
+{
+  outcome_unsolvable,
+  outcome_solved,
+  outcome_budget
+} solver_outcome_t;
+
+/* Search context (forward declaration to hide the implementation). A solver
+   can be reused for many grids, it keeps its buffers between runs */
+typedef struct solver_t solver_t;
+
+/* memory allocation for a solver running in the given mode, without any
+   budget nor solution limit */
+solver_t *solver_new(const solver_mode_t mode);
+
+/* free the allocated memory of the given solver and of its solution */
+void solver_free(solver_t *solver);
+
+/* set the mode of the given solver */
+void solver_set_mode(solver_t *solver, const solver_mode_t mode);
+
+/* set the maximum number of nodes and of milliseconds a run may take,
+   '0' means no limit */
+void solver_set_budget(solver_t *solver, const size_t nodes,
+                       const size_t milliseconds);
+
+/* set the number of solutions after which a run stops, '0' means no limit */
+void solver_set_limit(solver_t *solver, const size_t solutions);
+
+/* take the choices' colors randomly instead of the rightmost one */
+void solver_set_random(solver_t *solver, const bool random);
+
+/* return the random generator of the given solver, seeded when it is made
+   (see rng_init) */
+rng_t *solver_get_rng(solver_t *solver);
+
+/* set the number of nogoods learned from the conflicts of a search on
+   grids of size 49 and more, '0' disables learning */
+void solver_set_learning(solver_t *solver, const size_t capacity);
+
+/* propagate singles and hidden singles on a bitboard before applying the
+   heuristics of the grid, on grids up to 49x49 (enabled by default) */
+void solver_set_bitboards(solver_t *solver, const bool bitboards);
+
+/* set the techniques of the propagation (bit t for the technique t), and
+   whether the rarely useful expensive ones are skipped. All the techniques
+   are used, adaptively, by default */
+void solver_set_techniques(solver_t *solver, const unsigned techniques,
+                           const bool adaptive);
+
+/* set the order of the largest fishes looked for by the propagation (see
+   grid_fish) */
+void solver_set_fish(solver_t *solver, const size_t order);
+
+/* set the number of strong links of the longest chains looked for by the
+   propagation (see grid_chains) */
+void solver_set_chains(solver_t *solver, const size_t length);
+
+/* return the scheduler of the propagation of the given solver and its
+   counters, which are kept from one run to the next */
+const schedule_t *solver_get_schedule(const solver_t *solver);
+
+/* give the given solver a transposition table of at most the given number
+   of bytes, '0' removes it. The states of the search found dead, or whose
+   solutions were all counted, are stored there and not explored again, in
+   this run or in the next ones. return false if the memory is lacking */
+bool solver_set_table(solver_t *solver, const size_t bytes);
+
+/* record the nodes of the next searches with the given tracer (NULL to stop
+   recording), which the caller keeps and frees */
+void solver_set_trace(solver_t *solver, trace_t *trace);
+
+/* largest number of cells probed at each node */
+#define PROBE_MAX_CELLS 64
+
+/* set the number of cells probed at each node of the search on grids of
+   the given size ('0' for every size), '0' disables the probing (8 cells
+   on 16x16 grids and none otherwise by default). The colors of the cells
+   with the fewest colors are each tried and propagated before branching:
+   the failed ones are discarded, and the colors left by none of the others
+   are discarded everywhere. return false if the size is invalid or the
+   number above PROBE_MAX_CELLS */
+bool solver_set_probing(solver_t *solver, const size_t size,
+                        const size_t cells);
+
+/* set the file descriptor on which solutions are printed in mode_all */
+void solver_set_output(solver_t *solver, FILE *fd);
+
+/* a visitor is called with each solution found in mode_all, and the given
+   argument */
+typedef void (*solver_visitor_t)(const grid_t *solution, void *arg);
+
+/* call the given visitor (NULL for none) with each solution of the next
+   runs in mode_all, after it is printed */
+void solver_set_visitor(solver_t *solver, solver_visitor_t visitor,
+                        void *arg);
+
+/* search the solutions of the given grid, which is left untouched.
+   return outcome_budget if the budget was exhausted (the count is then a
+   lower bound), outcome_solved if at least one solution was found,
+   outcome_unsolvable otherwise */
+solver_outcome_t solver_run(solver_t *solver, const grid_t *grid);
+
+/* start enumerating the solutions of the given grid, which is left
+   untouched, one at a time with solver_next: whatever the mode, they are
+   all enumerated, up to the limit, but not printed nor visited. The budget
+   counts the time between the calls too. return false if the grid is
+   invalid or the memory is lacking */
+bool solver_begin(solver_t *solver, const grid_t *grid);
+
+/* search the next solution of the enumeration of the given solver, and
+   return it, or NULL once they were all found (or the limit or the budget
+   was reached). The search is suspended until the next call, holding only
+   the grids of the decision stack; the grid stays owned by the solver until
+   the next call */
+const grid_t *solver_next(solver_t *solver);
+
+/* stop the enumeration of the given solver, if it is not over, and return
+   its outcome, as solver_run does */
+solver_outcome_t solver_end(solver_t *solver);
+
+/* return the first solution found by the last run, or NULL. The grid stays
+   owned by the solver until the next run */
+const grid_t *solver_get_solution(const solver_t *solver);
+
+/* return the first solution found by the last run and give its ownership to
+   the caller, or NULL */
+grid_t *solver_take_solution(solver_t *solver);
+
+/* return the number of solutions found by the last run */
+size_t solver_get_count(const solver_t *solver);
+
+/* return the number of subtrees of the last run found in the transposition
+   table */
+size_t solver_get_transpositions(const solver_t *solver);
+
+/* return the number of colors found failed by the probing of the last
+   run */
+size_t solver_get_failed(const solver_t *solver);
+
+/* return the number of nodes explored by the last run */
+size_t solver_get_nodes(const solver_t *solver);
+
+#endif /* SOLVER_H */
@@ -1,18 +1,82 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <batch.h>
+#include <cache.h>
+#include <canon.h>
+#include <chains.h>
+#include <check.h>
 #include <colors.h>
 #include <err.h>
+#include <estimate.h>
+#include <fish.h>
+#include <generator.h>
 #include <getopt.h>
 #include <grid.h>
+#include <latency.h>
+#include <pool.h>
+#include <rate.h>
+#include <reservoir.h>
+#include <rng.h>
+#include <schedule.h>
+#include <server.h>
+#include <session.h>
+#include <shard.h>
+#include <solver.h>
+#include <symmetry.h>
+#include <trace.h>
 #include <string.h>
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "sudoku.h"
 
-static bool verbose = false;
+/* the sizes beyond 64 of the builds with wide colors (see COLORS_BITS) */
+#if MAX_GRID_SIZE > 64
+#define LARGE_SIZES ", 81, 100, 121"
+#else
+#define LARGE_SIZES ""
+#endif
 
-typedef enum { mode_first, mode_all} mode_t;
+static bool verbose = false;
+static size_t nb_nogoods = 0;
+static unsigned techniques = TECHNIQUES_ALL;
+static bool adaptive = true;
+static size_t fish_order = FISH_DEFAULT_ORDER;
+static size_t chain_length = CHAINS_DEFAULT_LENGTH;
+static size_t table_size = 0;
+static trace_t *trace = NULL;
+
+/* solutions of the lines of a batch, shared by its workers (may be NULL) */
+static cache_t *batch_cache = NULL;
+
+/* lines of a checked batch with a conflict or malformed, counted by all its
+   workers */
+static size_t batch_wrong = 0;
+static pthread_mutex_t batch_wrong_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* budget of the search of each line of a batch ('0': no limit) */
+static size_t budget_nodes = 0;
+static size_t budget_ms = 0;
+
+/* whether the solutions are searched up to the relabelings of the free
+   colors and the automorphisms of the grid (see symmetry_run), and the
+   orbits printed whole */
+static bool relabel = false;
+static bool expand = false;
+
+/* shard of the work done by this process, out of nb_shards ('0': the whole
+   work), see shard_split */
+static size_t shard = 0;
+static size_t nb_shards = 0;
+
+/* cells probed at each node per grid size ('0' for every size), set in the
+   order given */
+static size_t probe_sizes[MAX_GRID_SIZE];
+static size_t probe_cells[MAX_GRID_SIZE];
+static size_t nb_probes = 0;
 
 static grid_t *file_parser(char *filename)
 {
@@ -25,7 +89,7 @@ static grid_t *file_parser(char *filename)
   if (!f)
     goto open_file_pb;
   
-  first_row = calloc(MAX_GRID_SIZE + 2, sizeof(char));
+  first_row = calloc(GRID_ROW_LENGTH(MAX_GRID_SIZE), sizeof(char));
   if (!first_row)
     goto memory_allocation_pb;
 
@@ -34,7 +98,7 @@ static grid_t *file_parser(char *filename)
     fill_row(MAX_GRID_SIZE, f, first_row);
   } while(!strlen(first_row) && !feof(f));
 
-  size = strlen(first_row);
+  size = row_size(first_row);
 
 /* check if the size of the first line is acceptable */ 
   if (!grid_check_size(size)) 
@@ -52,7 +116,7 @@ static grid_t *file_parser(char *filename)
 
   free(first_row);
 
-  char *row = calloc((size + 2), sizeof(char));
+  char *row = calloc(GRID_ROW_LENGTH(size), sizeof(char));
   if (!row)
     goto memory_allocation_pb;
 
@@ -61,7 +125,7 @@ static grid_t *file_parser(char *filename)
     fill_row(size,f,row);
 
 /* check if the row is at the correct size */
-    if (strlen(row) != size && strlen(row) != 0)
+    if (row_size(row) != size && strlen(row) != 0)
       goto row_size_pb;
 
     nb_row = push_row(grid, row, nb_row);
@@ -149,76 +213,324 @@ static grid_t *file_parser(char *filename)
   }
 }
 
-static grid_t *grid_solver(grid_t *grid, const mode_t mode, FILE *fd)
+/* keep the probing budgets of the given list '[SIZE:]N,...', return false
+   if an entry is invalid */
+static bool probe_parse(char *spec)
 {
-  if (!grid)
-    return NULL;
+  char *save = NULL;
+  char *cells = NULL;
+  size_t size = 0;
 
-  size_t grid_status = grid_heuristics(grid);
-  printf("grid_status = %ld\n", grid_status);
-  choice_t *choice = NULL;
-  grid_t *grid_cp = NULL;
-  grid_t *status_check = NULL;
-  bool  is_a_solution = false;
+  for (char *entry = strtok_r(spec, ",", &save); entry;
+       entry = strtok_r(NULL, ",", &save))
+  {
+    if (nb_probes == MAX_GRID_SIZE)
+      return false;
 
-  switch (grid_status)
+    size = 0;
+    cells = strchr(entry, ':');
+    if (cells)
     {
-      case 0:
-          grid_cp = grid_copy(grid);
-          choice = grid_choice(grid_cp);
-          if (!choice || !grid_cp)
-            return NULL;
-
-          grid_choice_apply(grid_cp, choice);
-          grid_choice_free(choice);
-          status_check = grid_solver(grid_cp, mode, fd);
-          grid_free(grid_cp);
-
-          if (!status_check)
-          {
-            choice = grid_choice(grid);
-            if (!choice)
-              return NULL;
+      *cells = '\0';
+      size = strtoul(entry, NULL, 10);
+      if (!grid_check_size(size))
+        return false;
+    }
 
-            grid_choice_discard(grid, choice);
-            grid_choice_free(choice);
-            grid = grid_solver(grid, mode, fd);
-          }
+    probe_sizes[nb_probes] = size;
+    probe_cells[nb_probes] = strtoul(cells ? cells + 1 : entry, NULL, 10);
+    if (probe_cells[nb_probes] > PROBE_MAX_CELLS)
+      return false;
 
-        break;
+    nb_probes = nb_probes + 1;
+  }
 
-      case 1:
-          if (mode == mode_all)
-          {
-            fprintf(fd, "\n");
-            grid_print(grid, fd);
-            return NULL;
-          }
-          else
-          {
-            is_a_solution = true;
-            goto solution;
-          }
+  return true;
+}
 
-      case 2:
-          return NULL;
-        break;
-    }
-  solution:
+/* give the probing budgets to the given solver */
+static void probe_apply(solver_t *solver)
+{
+  for (size_t i = 0; i < nb_probes; i = i + 1)
+    solver_set_probing(solver, probe_sizes[i], probe_cells[i]);
+}
+
+static grid_t *grid_solver(grid_t *grid, const solver_mode_t mode, FILE *fd,
+                           cache_t *cache)
+{
+  grid_t *solution = NULL;
+  solver_t *solver = solver_new(mode);
+  const grid_t *next = NULL;
+  symmetry_t *symmetry = NULL;
+  size_t count = 0;
+
+  if (!grid || !solver)
   {
-    if (!is_a_solution)
+    solver_free(solver);
+
+    return NULL;
+  }
+
+  solver_set_output(solver, fd);
+  solver_set_trace(solver, trace);
+  solver_set_learning(solver, nb_nogoods);
+  solver_set_techniques(solver, techniques, adaptive);
+  solver_set_fish(solver, fish_order);
+  solver_set_chains(solver, chain_length);
+  probe_apply(solver);
+  if (!solver_set_table(solver, table_size))
+    warnx("warning: no memory for the transposition table\n");
+
+  if (mode == mode_first)
+    cache_solve(cache, solver, grid, &solution);
+  else if (nb_shards)
+    shard_run(solver, mode, grid, shard, nb_shards, fd, &count);
+  else if (relabel && (symmetry = symmetry_new(grid)))
+  {
+    symmetry_run(solver, grid, symmetry, expand ? fd : NULL, &count);
+    if (verbose)
+      fprintf(stderr, "%zu free color(s), %zu automorphism(s), orbits of"
+              " at most %zu solution(s)\n", symmetry_get_free(symmetry),
+              symmetry_get_automorphisms(symmetry),
+              symmetry_get_order(symmetry));
+
+    symmetry_free(symmetry);
+  }
+  else if (mode == mode_all && solver_begin(solver, grid))
+  {
+    while ((next = solver_next(solver)))
     {
-      printf("------STOP!------\n");
-      return grid;
+      fprintf(fd, "\n");
+      grid_print(next, fd);
     }
-    else
+
+    solver_end(solver);
+    count = solver_get_count(solver);
+  }
+  else
+  {
+    solver_run(solver, grid);
+    count = solver_get_count(solver);
+  }
+
+  if (mode == mode_count && !nb_shards)
+    fprintf(fd, "%zu solution(s)\n", count);
+
+  if (verbose)
+    fprintf(stderr, "%zu solution(s), %zu node(s), %zu cache hit(s), %zu"
+            " transposition(s), %zu failed literal(s)\n",
+            mode == mode_first ? solver_get_count(solver) : count,
+            solver_get_nodes(solver),
+            cache_get_hits(cache), solver_get_transpositions(solver),
+            solver_get_failed(solver));
+
+  if (verbose)
+    schedule_print(solver_get_schedule(solver), stderr);
+
+  solver_free(solver);
+
+  return solution;
+}
+
+/* keep the queues of the given list 'SIZE[:DIFFICULTY],...' in the given
+   reservoir, return false if an entry is invalid */
+static bool reservoir_parse(reservoir_t *reservoir, char *spec)
+{
+  char *save = NULL;
+  char *size = NULL;
+  char *name = NULL;
+  difficulty_t difficulty = difficulty_any;
+
+  for (char *entry = strtok_r(spec, ",", &save); entry;
+       entry = strtok_r(NULL, ",", &save))
+  {
+    size = entry;
+    name = strchr(entry, ':');
+    difficulty = difficulty_any;
+    if (name)
     {
-      printf("------START------\n");
-      grid_print(grid,fd);
-      return grid;
+      *name = '\0';
+      if (!difficulty_from_name(name + 1, &difficulty))
+        return false;
     }
 
+    if (!reservoir_add(reservoir, strtoul(size, NULL, 10), difficulty))
+      return false;
+  }
+
+  return true;
+}
+
+static void *batch_state_new(void)
+{
+  solver_t *solver = solver_new(mode_first);
+
+  solver_set_output(solver, NULL);
+  solver_set_learning(solver, nb_nogoods);
+  solver_set_techniques(solver, techniques, adaptive);
+  solver_set_fish(solver, fish_order);
+  solver_set_chains(solver, chain_length);
+  probe_apply(solver);
+  solver_set_table(solver, table_size);
+  solver_set_budget(solver, budget_nodes, budget_ms);
+
+  return solver;
+}
+
+static void batch_state_free(void *state)
+{
+  solver_free(state);
+}
+
+/* seed the generator of the given solver with the stream of the line of
+   given index, so that a line draws the same numbers whichever worker runs
+   it, after whichever lines */
+static void batch_seed(void *state, const size_t index)
+{
+  rng_seed(solver_get_rng(state), rng_get_seed(), index);
+}
+
+/* answer a line of a batch with the rating of its grid */
+static void batch_rate(const size_t index, const char *line, char *answer,
+                       const size_t length, batch_result_t *result,
+                       void *state)
+{
+  rating_t rating;
+  grid_t *grid = grid_from_line(line);
+
+  batch_seed(state, index);
+
+  if (!grid)
+    snprintf(answer, length, "error malformed grid");
+  else if (!grid_rate(grid, state, &rating))
+    snprintf(answer, length, "unsolvable");
+  else
+  {
+    rate_to_line(&rating, answer, length);
+    result->outcome = outcome_solved;
+  }
+
+  result->size = grid_get_size(grid);
+  grid_free(grid);
+}
+
+/* answer a line of a batch with the estimated cost of its search */
+static void batch_estimate(const size_t index, const char *line,
+                           char *answer, const size_t length,
+                           batch_result_t *result, void *state)
+{
+  estimate_t estimate;
+  grid_t *grid = grid_from_line(line);
+
+  batch_seed(state, index);
+
+  if (!grid)
+    snprintf(answer, length, "error malformed grid");
+  else if (grid_estimate(grid, state, ESTIMATE_DEFAULT_PROBES, &estimate))
+  {
+    estimate_to_line(&estimate, answer, length);
+    result->outcome = outcome_solved;
+  }
+
+  result->size = grid_get_size(grid);
+  grid_free(grid);
+}
+
+/* predict the cost of a line of a batch by the estimated size of the
+   search of its grid */
+static double batch_cost(const size_t index, const char *line, void *state)
+{
+  estimate_t estimate;
+  grid_t *grid = grid_from_line(line);
+  double nodes = 0;
+
+  batch_seed(state, index);
+
+  if (grid && grid_estimate(grid, state, ESTIMATE_DEFAULT_PROBES, &estimate))
+    nodes = estimate.nodes;
+
+  grid_free(grid);
+
+  return nodes;
+}
+
+/* answer a line of a batch with the verdict on its grid */
+static void batch_check(const size_t index, const char *line, char *answer,
+                        const size_t length, batch_result_t *result,
+                        void *state)
+{
+  check_t check;
+
+  (void) index;
+  (void) state;
+  if (check_line(line, &check))
+    result->outcome = outcome_solved;
+  else
+  {
+    pthread_mutex_lock(&batch_wrong_lock);
+    batch_wrong = batch_wrong + 1;
+    pthread_mutex_unlock(&batch_wrong_lock);
+  }
+
+  if (check.status != check_malformed)
+    result->size = check.size;
+
+  check_to_line(&check, answer, length);
+}
+
+/* answer a line of a batch with the hash and the canonical form of its
+   grid */
+static void batch_canonical(const size_t index, const char *line,
+                            char *answer, const size_t length,
+                            batch_result_t *result, void *state)
+{
+  canon_t canon;
+  grid_t *grid = grid_from_line(line);
+  int written = 0;
+
+  (void) index;
+  (void) state;
+  if (!grid || !grid_canonical(grid, &canon))
+    snprintf(answer, length, "error malformed grid");
+  else
+  {
+    written = snprintf(answer, length, "%016llx ",
+                       (unsigned long long) canon.hash);
+    canon_to_line(&canon, answer + written, length - written);
+    result->outcome = outcome_solved;
+  }
+
+  result->size = grid_get_size(grid);
+  grid_free(grid);
+}
+
+/* answer a line of a batch with the solution of its grid, through the cache
+   of the batch */
+static void batch_solve(const size_t index, const char *line, char *answer,
+                        const size_t length, batch_result_t *result,
+                        void *state)
+{
+  grid_t *grid = grid_from_line(line);
+  grid_t *solution = NULL;
+
+  batch_seed(state, index);
+  if (!grid)
+  {
+    snprintf(answer, length, "error malformed grid");
+
+    return;
   }
+
+  result->size = grid_get_size(grid);
+  result->outcome = cache_solve(batch_cache, state, grid, &solution);
+
+  if (result->outcome == outcome_budget)
+    snprintf(answer, length, "budget");
+  else if (!solution || !grid_to_line(solution, answer, length))
+    snprintf(answer, length, "unsolvable");
+
+  grid_free(solution);
+  grid_free(grid);
 }
 
 int main (int argc, char **argv)
@@ -229,7 +541,42 @@ int main (int argc, char **argv)
   FILE *fd = stdout;
   bool solver = true; 
   bool unique = false;
-  mode_t all = false;
+  solver_mode_t all = mode_first;
+  bool serve = false;
+  char *socket_path = NULL;
+  size_t nb_jobs = pool_default_size();
+  size_t cache_size = 0;
+  cache_t *cache = NULL;
+  bool canonical = false;
+  bool rate = false;
+  bool estimate = false;
+  bool longest = false;
+  estimate_t prediction;
+  bool check = false;
+  size_t nb_wrong = 0;
+  size_t nb_invalid = 0;
+  char *trace_path = NULL;
+  size_t sampling = 1;
+  rating_t rating;
+  char *batch_path = NULL;
+  batch_slice_t slice = {0, 0, 0, 1};
+  bool merge = false;
+  uint64_t start = 0;
+  bool report = false;
+  char *report_path = NULL;
+  size_t nb_slowest = LATENCY_DEFAULT_SLOWEST;
+  latency_t *latency = NULL;
+  FILE *report_fd = NULL;
+  char *session_path = NULL;
+  solver_t *session_solver = NULL;
+  char *reservoir_spec = NULL;
+  char *reservoir_path = NULL;
+  size_t low = 16;
+  size_t high = 64;
+  size_t nb_refills = 1;
+  reservoir_t *reservoir = NULL;
+  canon_t canon;
+  char line[GRID_LINE_LENGTH(MAX_GRID_SIZE)];
 
   static struct option long_opts[] =
   {
@@ -240,23 +587,131 @@ int main (int argc, char **argv)
     {"unique", no_argument, NULL, 'u'},
     {"generate", optional_argument, NULL, 'g'},
     {"all", no_argument, NULL, 'a'},
+    {"count", no_argument, NULL, 'Y'},
+    {"relabel", optional_argument, NULL, 'y'},
+    {"serve", optional_argument, NULL, 's'},
+    {"jobs", required_argument, NULL, 'j'},
+    {"cache", required_argument, NULL, 'c'},
+    {"canonical", no_argument, NULL, 'C'},
+    {"nogoods", required_argument, NULL, 'n'},
+    {"rate", no_argument, NULL, 'r'},
+    {"estimate", no_argument, NULL, 'E'},
+    {"longest-first", no_argument, NULL, 'G'},
+    {"check", no_argument, NULL, 'k'},
+    {"batch", required_argument, NULL, 'b'},
+    {"shard", required_argument, NULL, 'D'},
+    {"range", required_argument, NULL, 'Z'},
+    {"merge", no_argument, NULL, 'M'},
+    {"latency", optional_argument, NULL, 'H'},
+    {"slowest", required_argument, NULL, 'O'},
+    {"nodes", required_argument, NULL, 'K'},
+    {"ms", required_argument, NULL, 'Q'},
+    {"session", required_argument, NULL, 'I'},
+    {"reservoir", required_argument, NULL, 'R'},
+    {"watermarks", required_argument, NULL, 'W'},
+    {"store", required_argument, NULL, 'S'},
+    {"refill", required_argument, NULL, 'F'},
+    {"techniques", required_argument, NULL, 'T'},
+    {"fixed", no_argument, NULL, 'X'},
+    {"fish", required_argument, NULL, 'f'},
+    {"chains", required_argument, NULL, 'L'},
+    {"probe", required_argument, NULL, 'p'},
+    {"table", required_argument, NULL, 't'},
+    {"seed", required_argument, NULL, 'e'},
+    {"trace", required_argument, NULL, 'P'},
+    {"sample", required_argument, NULL, 'N'},
     {NULL, no_argument, NULL, 0}
   };
 
   int optc;
 
-  while ((optc = getopt_long (argc, argv, "vuao:g::hV",long_opts, NULL)) != -1)
+  while ((optc = getopt_long (argc, argv, "vuao:g::hVj:c:n:",long_opts, NULL)) != -1)
     switch (optc)                                                                 
       {                                                                           
       case 'h':
           fprintf(stdout, "Usage:\tsudoku [-a|-o FILE|-v|-V|-h] FILE ...\n"
             "\tsudoku -g[SIZE] [-u|-o FILE|-v|-V|-h]\n"
+            "\tsudoku --serve[=SOCKET] [-j N] [--reservoir LIST]\n"
+            "\tsudoku [--rate|--estimate|--check|--canonical] --batch FILE"
+            " [-j N|-c N|-o FILE]\n"
+            "\tsudoku --check [-o FILE] FILE ...\n"
+            "\tsudoku --session FILE [-o FILE|-v]\n"
+            "\tsudoku --merge [-o FILE|-v] FILE ...\n"
             "Solve or generate Sudoku grids of various sizes"
-            " (1,4,9,16,25,36,49,64)\n\n"
+            " (1, 4, 9, 16, 25, 36, 49, 64" LARGE_SIZES ")\n\n"
             " -a,--all\t\tsearch for all possible solutions\n"
+            " --count\t\tonly print the number of solutions\n"
+            " --relabel[=expand]\tsearch one solution per relabeling of the"
+            " colors given by\n\t\t\tno clue and automorphism of the grid"
+            " (when its canonical\n\t\t\tform is exact) with --all or"
+            " --count, and print all of\n\t\t\tthem if expanded\n"
             " -g[N],--generate[=N]\tgenerate a grid of size NxN (default:9)\n"
             " -u,--unique\t\tgenerate a grid with unique solution\n"
             " -o FILE,--o FILE\twrite solution to FILE\n"
+            " --serve[=SOCKET]\tanswer requests read on SOCKET (default:"
+            " standard input)\n"
+            " -j N,--jobs N\t\tuse N worker threads\n"
+            " --reservoir LIST\tkeep ready puzzles for the generate requests,"
+            " LIST is\n\t\t\tSIZE[:easy|medium|hard],...\n"
+            " --watermarks LOW:HIGH\trefill a queue of the reservoir under LOW"
+            " up to HIGH\n\t\t\t(default:16:64)\n"
+            " --refill N\t\trefill the reservoir with N threads (default:1)\n"
+            " --store FILE\t\tload the reservoir from FILE and save it"
+            " there\n"
+            " -c N,--cache N\t\tcache up to N solutions, found again by"
+            " grid or by canonical\n\t\t\tform\n"
+            " --canonical\t\tprint the hash and the canonical form of the"
+            " grids\n"
+            " -n N,--nogoods N\tlearn up to N nogoods on grids of size 49"
+            " and more (default: 0, off)\n"
+            " --rate\t\t\tprint the difficulty of the grids instead of"
+            " solving them\n"
+            " --check\t\tonly tell if the grids are solved, partial or"
+            " have a\n\t\t\tconflict, and where\n"
+            " --estimate\t\tprint the predicted cost of the search of the"
+            " grids\n\t\t\tinstead of solving them\n"
+            " --batch FILE\t\tprocess the grids of FILE, one per line"
+            " ('-': standard\n\t\t\tinput)\n"
+            " --longest-first\tprocess the grids of a batch predicted the"
+            " longest first\n"
+            " --shard I/N\t\tonly do the I-th (from 0) of N shares of a"
+            " batch, or of\n\t\t\tthe search tree with --all or --count,"
+            " in a shard file\n"
+            " --range START:COUNT\tonly process COUNT lines of a batch from"
+            " the line START\n\t\t\t(from 0, COUNT 0: up to the end)\n"
+            " --merge\t\tcombine the shard files given in one output\n"
+            " --latency[=FILE]\treport the percentiles of the time taken by"
+            " the lines of\n\t\t\ta batch, per size and outcome, the"
+            " throughput and the\n\t\t\tslowest lines on the standard"
+            " error, or in JSON in FILE\n"
+            " --slowest N\t\tname the N slowest lines in the latency report"
+            " (default:10)\n"
+            " --nodes N\t\tgive up the search of a line of a batch after N"
+            " nodes,\n\t\t\tanswering 'budget' (default:0, no limit)\n"
+            " --ms N\t\t\tgive up the search of a line of a batch after N"
+            "\n\t\t\tmilliseconds, answering 'budget' (default:0, no"
+            " limit)\n"
+            " --session FILE\t\tsolve the grid read on a line of FILE again"
+            " after each\n\t\t\tedit 'ROW COLUMN COLOR' of the next lines"
+            " ('_' removes\n\t\t\tthe clue)\n"
+            " --techniques LIST\tpropagate with the techniques of LIST only"
+            " (default:all):\n\t\t\tcross_hatching,lone_number,"
+            "naked_subset,hidden_subset,\n\t\t\talldifferent,fish,chains\n"
+            " --fish N\t\tlook for fishes of up to N rows or columns"
+            " (default:4)\n"
+            " --chains N\t\tlook for chains of up to N strong links"
+            " (default:4)\n"
+            " --probe LIST\t\ttry the colors of the N cells with the fewest"
+            " colors\n\t\t\tbefore branching, LIST is '[SIZE:]N,...'"
+            " (default:\n\t\t\t16:8)\n"
+            " --fixed\t\tnever skip the techniques which rarely help\n"
+            " --table N\t\tremember the dead or counted states of the"
+            " search in\n\t\t\tN megabytes (default:0)\n"
+            " --seed N\t\tdraw the random numbers from the seed N, to"
+            " repeat a\n\t\t\tgeneration\n"
+            " --trace FILE\t\twrite the nodes of the searches in FILE, in the"
+            " Chrome\n\t\t\ttrace-event format\n"
+            " --sample N\t\tonly trace one node out of N (default:1)\n"
             " -v,--verbose\t\tverbose output\n"
             " -V,--version\t\tdisplay version and exit\n"
             " -h,--help\t\tdisplay this help and exit\n");
@@ -265,8 +720,8 @@ int main (int argc, char **argv)
       case 'V':
           fprintf(stdout,"sudoku %d.%d.%d\n"
             "Solve/generate sudoku grids"
-            "(possible sizes: 1, 4, 9, 16, 25, 36, 49, 64)\n", VERSION,
-            SUBVERSION, REVISION);
+            "(possible sizes: 1, 4, 9, 16, 25, 36, 49, 64" LARGE_SIZES ")\n",
+            VERSION, SUBVERSION, REVISION);
         return EXIT_SUCCESS;
 
       case 'v':
@@ -286,16 +741,177 @@ int main (int argc, char **argv)
         break;
 
       case 'a':
-          all = true;
+          all = mode_all;
           if (!solver)
           {
             warnx("warning: option 'all' conflict with generator mode, disabl"
                   "ing it!\n");
 
-            all = false;
+            all = mode_first;
+          }
+        break;
+
+      case 'Y':
+          all = mode_count;
+          if (!solver)
+          {
+            warnx("warning: option 'count' conflict with generator mode,"
+                  " disabling it!\n");
+
+            all = mode_first;
           }
         break;
 
+      case 'y':
+          relabel = true;
+          if (optarg && strcmp(optarg, "expand"))
+            goto option_pb;
+
+          expand = optarg != NULL;
+        break;
+
+      case 's':
+          serve = true;
+          socket_path = optarg;
+        break;
+
+      case 'j':
+          nb_jobs = strtoul(optarg, NULL, 10);
+          if (!nb_jobs)
+            goto option_pb;
+        break;
+
+      case 'c':
+          cache_size = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'C':
+          canonical = true;
+        break;
+
+      case 'n':
+          nb_nogoods = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'r':
+          rate = true;
+        break;
+
+      case 'E':
+          estimate = true;
+        break;
+
+      case 'G':
+          longest = true;
+        break;
+
+      case 'k':
+          check = true;
+        break;
+
+      case 'b':
+          batch_path = optarg;
+        break;
+
+      case 'D':
+          if (!shard_parse(optarg, &shard, &nb_shards))
+            goto option_pb;
+        break;
+
+      case 'Z':
+          if (!batch_slice_parse(optarg, &slice))
+            goto option_pb;
+        break;
+
+      case 'M':
+          merge = true;
+        break;
+
+      case 'H':
+          report = true;
+          report_path = optarg;
+        break;
+
+      case 'O':
+          nb_slowest = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'K':
+          budget_nodes = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'Q':
+          budget_ms = strtoul(optarg, NULL, 10);
+        break;
+
+      case 'I':
+          session_path = optarg;
+        break;
+
+      case 'R':
+          reservoir_spec = optarg;
+        break;
+
+      case 'W':
+          if (sscanf(optarg, "%zu:%zu", &low, &high) != 2 || !high ||
+              low > high)
+            goto option_pb;
+        break;
+
+      case 'S':
+          reservoir_path = optarg;
+        break;
+
+      case 'T':
+          if (!schedule_parse(optarg, &techniques))
+            goto option_pb;
+        break;
+
+      case 'f':
+          fish_order = strtoul(optarg, NULL, 10);
+          if (fish_order < 2 || fish_order > FISH_MAX_ORDER)
+            goto option_pb;
+        break;
+
+      case 'L':
+          chain_length = strtoul(optarg, NULL, 10);
+          if (chain_length < 1 || chain_length > CHAINS_MAX_LENGTH)
+            goto option_pb;
+        break;
+
+      case 'p':
+          if (!probe_parse(optarg))
+            goto option_pb;
+        break;
+
+      case 'X':
+          adaptive = false;
+        break;
+
+      case 't':
+          table_size = strtoul(optarg, NULL, 10) << 20;
+        break;
+
+      case 'e':
+          rng_set_seed(strtoull(optarg, NULL, 10));
+        break;
+
+      case 'P':
+          trace_path = optarg;
+        break;
+
+      case 'N':
+          sampling = strtoul(optarg, NULL, 10);
+          if (!sampling)
+            goto option_pb;
+        break;
+
+      case 'F':
+          nb_refills = strtoul(optarg, NULL, 10);
+          if (!nb_refills)
+            goto option_pb;
+        break;
+
       case 'g':
           if (optarg)
             grid_size = strtol(optarg, NULL, 10);
@@ -323,8 +939,148 @@ int main (int argc, char **argv)
           goto option_pb;
       }
 
+/* server mode */
+  if (serve)
+  {
+    if (reservoir_spec)
+    {
+      reservoir = reservoir_new(low, high, nb_refills, reservoir_path);
+      if (!reservoir || !reservoir_parse(reservoir, reservoir_spec) ||
+          !reservoir_start(reservoir))
+        errx(EXIT_FAILURE, "error: invalid reservoir '%s'\n",
+             reservoir_spec);
+    }
+
+    if (!server_run(socket_path, nb_jobs, cache_size, reservoir,
+                    batch_state_new))
+      errx(EXIT_FAILURE, "error: server could not start or accept\n");
+
+    reservoir_free(reservoir);
+
+    return EXIT_SUCCESS;
+  }
+
+/* batch mode, the lines of a shard are framed for the merge */
+  if (batch_path)
+  {
+    if (nb_shards)
+    {
+      slice.shard = shard;
+      slice.nb_shards = nb_shards;
+      shard_begin(fd, shard, nb_shards, shard_batch);
+    }
+
+    if (report)
+    {
+      latency = latency_new(nb_slowest);
+      if (!latency)
+        errx(EXIT_FAILURE, "error: memory allocation failed\n");
+    }
+
+    if (cache_size)
+    {
+      batch_cache = cache_new(cache_size);
+      if (!batch_cache)
+        errx(EXIT_FAILURE, "error: memory allocation failed\n");
+    }
+
+    start = trace_clock();
+    if (check || canonical)
+    {
+      if (!batch_run(batch_path, fd, nb_jobs,
+                     check ? batch_check : batch_canonical, NULL, &slice,
+                     latency, NULL, NULL))
+        goto open_file_pb;
+    }
+    else if (!batch_run(batch_path, fd, nb_jobs,
+                        estimate ? batch_estimate :
+                        rate ? batch_rate : batch_solve,
+                        longest ? batch_cost : NULL, &slice, latency,
+                        batch_state_new, batch_state_free))
+      goto open_file_pb;
+
+    if (nb_shards)
+      shard_end(fd, shard_batch, trace_clock() - start, 0);
+
+/* the latency report goes on the standard error, or in JSON in its file */
+    if (latency && report_path)
+    {
+      report_fd = fopen(report_path, "w");
+      if (!report_fd)
+        goto open_file_pb;
+
+      latency_write_json(latency, report_fd);
+      fclose(report_fd);
+    }
+    else if (latency)
+      latency_print(latency, stderr);
+
+    latency_free(latency);
+    cache_free(batch_cache);
+
+    if (fd != stdout)
+      fclose(fd);
+
+/* a checked batch fails on a wrong line, as the check of files does */
+    return batch_wrong ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
+/* session mode, the grid is solved again after each edit */
+  if (session_path)
+  {
+    session_solver = batch_state_new();
+    if (!session_solver)
+      errx(EXIT_FAILURE, "error: memory allocation failed\n");
+
+    if (!session_run(session_path, fd, session_solver, verbose))
+      goto open_file_pb;
+
+    solver_free(session_solver);
+    if (fd != stdout)
+      fclose(fd);
+
+    return EXIT_SUCCESS;
+  }
+
+/* merge mode, the shard files are combined */
+  if (merge)
+  {
+    if (optind >= argc)
+      goto no_input_pb;
+
+    if (!shard_merge(argv + optind, argc - optind, fd, verbose))
+      errx(EXIT_FAILURE, "error: the shards could not be merged\n");
+
+    if (fd != stdout)
+      fclose(fd);
+
+    return EXIT_SUCCESS;
+  }
+
+/* check mode, every grid of the files */
+  if (check)
+  {
+    if (optind >= argc)
+      goto no_input_pb;
+
+    while (optind < argc)
+    {
+      if (!check_file(argv[optind], fd, &nb_wrong))
+        goto open_file_pb;
+
+      nb_invalid = nb_invalid + nb_wrong;
+      optind = optind + 1;
+    }
+
+    if (fd != stdout)
+      fclose(fd);
+
+    return nb_invalid ? EXIT_FAILURE : EXIT_SUCCESS;
+  }
+
 /* solver mode */
   grid_t *grid = NULL;
+  grid_t *solution = NULL;
   FILE *open_test = NULL;
 
 /* check if a grid is provided */
@@ -333,6 +1089,19 @@ int main (int argc, char **argv)
     if (optind >= argc)
       goto no_input_pb;
 
+    if (nb_shards && all == mode_first)
+      errx(EXIT_FAILURE, "error: a shard needs --batch, --all or --count\n");
+
+    if (cache_size)
+      cache = cache_new(cache_size);
+
+    if (trace_path)
+    {
+      trace = trace_new(trace_path, sampling);
+      if (!trace)
+        goto open_file_pb;
+    }
+
     while (optind < argc)
     {
       open_test = fopen(argv[optind],"r");
@@ -343,15 +1112,76 @@ int main (int argc, char **argv)
 
 /* grid parser */
       grid = file_parser(argv[optind]);
-      grid_print(grid, fd);
+
+/* canonical form only */
+      if (canonical)
+      {
+        grid_canonical(grid, &canon);
+        canon_to_line(&canon, line, sizeof(line));
+        fprintf(fd, "%016llx %s\n", (unsigned long long) canon.hash, line);
+        grid_free(grid);
+        optind = optind + 1;
+        continue;
+      }
+
+/* estimated cost only */
+      if (estimate)
+      {
+        if (grid_estimate(grid, NULL, ESTIMATE_DEFAULT_PROBES, &prediction))
+        {
+          estimate_to_line(&prediction, line, sizeof(line));
+          fprintf(fd, "%s: %s\n", argv[optind], line);
+        }
+
+        grid_free(grid);
+        optind = optind + 1;
+        continue;
+      }
+
+/* difficulty only */
+      if (rate)
+      {
+        if (grid_rate(grid, NULL, &rating))
+        {
+          rate_to_line(&rating, line, sizeof(line));
+          fprintf(fd, "%s: %s\n", argv[optind], line);
+        }
+        else
+          fprintf(fd, "%s: unsolvable\n", argv[optind]);
+
+        grid_free(grid);
+        optind = optind + 1;
+        continue;
+      }
+
+      if (!nb_shards)
+        grid_print(grid, fd);
+
+      trace_run(trace, argv[optind]);
 
 /* grid solver */
-      grid = grid_solver(grid, all, fd);
-      fprintf(fd, "\n");
-      grid_print(grid, fd);
+      solution = grid_solver(grid, all, fd, cache);
+      if (solution)
+      {
+        fprintf(fd, "\n");
+        grid_print(solution, fd);
+        grid_free(solution);
+      }
       grid_free(grid);
       optind = optind + 1;
     }
+    cache_free(cache);
+    trace_free(trace);
+  }
+/* generator mode */
+  else
+  {
+    if (verbose)
+      fprintf(stderr, "seed %llu\n", (unsigned long long) rng_get_seed());
+
+    grid = grid_generate(grid_size, unique);
+    grid_print(grid, fd);
+    grid_free(grid);
   }
   if (fd != stdout)
     fclose(fd);
@@ -0,0 +1,676 @@
+#include <symmetry.h>
+#include <canon.h>
+#include <colors.h>
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Interal structure (hiden from outside) to represent the symmetry of a
+   grid */
+struct symmetry_t
+{
+  size_t size;
+  colors_t free;
+  size_t nb_free;
+  /* automorphisms as given by grid_automorphisms, the identity first */
+  size_t nb_automorphisms;
+  uint16_t *cells;
+  uint8_t *colors;
+};
+
+/* a cell branched on: the orbit of one of its candidates was explored
+   through its representative color, the other colors of the orbit being
+   its images by the given automorphisms */
+typedef struct
+{
+  size_t nb_images;
+  uint16_t images[MAX_GRID_SIZE];
+} level_t;
+
+/* state of the search of the representatives of a symmetry */
+typedef struct
+{
+  solver_t *solver;
+  const symmetry_t *symmetry;
+  grid_t *grid;
+  size_t order;
+  size_t row;
+  size_t cells[MAX_GRID_SIZE];
+  colors_t saved[MAX_GRID_SIZE];
+  size_t nb_cells;
+  size_t count;
+  solver_outcome_t outcome;
+  FILE *expand;
+  size_t *stabilizer;
+  level_t levels[SYMMETRY_MAX_DEPTH];
+  size_t depth;
+  grid_t *images[SYMMETRY_MAX_DEPTH + 1];
+} split_t;
+
+/* return the image of the given colors by the relabeling of automorphism
+   a */
+static colors_t symmetry_map(const symmetry_t *symmetry, const size_t a,
+                             const colors_t colors)
+{
+  colors_t mapped = colors_empty();
+
+  for (size_t c = 0; c < symmetry->size; c = c + 1)
+    if (colors_is_in(colors, c))
+      mapped = colors_add(mapped, symmetry->colors[a * symmetry->size + c]);
+
+  return mapped;
+}
+
+/* keep the automorphisms leaving every cell of the given grid as it is:
+   the search of the canonical form only looks at the singletons */
+static void symmetry_check(symmetry_t *symmetry, const grid_t *grid)
+{
+  size_t size = symmetry->size;
+  size_t nb_cells = size * size;
+  size_t kept = 0;
+  size_t to = 0;
+  bool fixed = true;
+
+  for (size_t a = 0; a < symmetry->nb_automorphisms; a = a + 1)
+  {
+    fixed = true;
+    for (size_t i = 0; i < nb_cells && fixed; i = i + 1)
+    {
+      to = symmetry->cells[a * nb_cells + i];
+      fixed = colors_is_equal(grid_get_colors(grid, to / size, to % size),
+                              symmetry_map(symmetry, a,
+                                           grid_get_colors(grid, i / size,
+                                                           i % size)));
+    }
+
+    if (!fixed)
+      continue;
+
+    for (size_t i = 0; i < nb_cells && kept != a; i = i + 1)
+      symmetry->cells[kept * nb_cells + i] =
+        symmetry->cells[a * nb_cells + i];
+
+    for (size_t c = 0; c < size && kept != a; c = c + 1)
+      symmetry->colors[kept * size + c] = symmetry->colors[a * size + c];
+
+    kept = kept + 1;
+  }
+
+  symmetry->nb_automorphisms = kept;
+}
+
+symmetry_t *symmetry_new(const grid_t *grid)
+{
+  symmetry_t *symmetry = NULL;
+  size_t size = grid_get_size(grid);
+  colors_t free = colors_full(size);
+  colors_t cell = colors_empty();
+  colors_t inside = colors_empty();
+  bool stable = false;
+
+  if (!size)
+    return NULL;
+
+  symmetry = calloc(1, sizeof(symmetry_t));
+  if (!symmetry)
+    return NULL;
+
+  symmetry->size = size;
+  for (size_t i = 0; i < size * size; i = i + 1)
+  {
+    cell = grid_get_colors(grid, i / size, i % size);
+    if (colors_is_singleton(cell))
+      free = colors_subtract(free, cell);
+  }
+
+/* a cell holding part of the free colors only keeps the larger part */
+  while (!stable)
+  {
+    stable = true;
+    for (size_t i = 0; i < size * size && free; i = i + 1)
+    {
+      inside = colors_and(grid_get_colors(grid, i / size, i % size), free);
+      if (!inside || colors_is_equal(inside, free))
+        continue;
+
+      if (2 * colors_count(inside) >= colors_count(free))
+        free = inside;
+      else
+        free = colors_subtract(free, inside);
+
+      stable = false;
+    }
+  }
+
+  while (colors_count(free) > SYMMETRY_MAX_FREE)
+    free = colors_xor(free, colors_leftmost(free));
+
+  symmetry->free = free;
+  symmetry->nb_free = colors_count(free);
+
+/* without the automorphisms, the identity is the only one */
+  symmetry->nb_automorphisms = grid_automorphisms(grid,
+                                                  SYMMETRY_MAX_AUTOMORPHISMS,
+                                                  &symmetry->cells,
+                                                  &symmetry->colors);
+  if (symmetry->nb_automorphisms)
+    symmetry_check(symmetry, grid);
+  else
+  {
+    symmetry->cells = malloc(size * size * sizeof(uint16_t));
+    symmetry->colors = malloc(size * sizeof(uint8_t));
+    if (!symmetry->cells || !symmetry->colors)
+    {
+      symmetry_free(symmetry);
+
+      return NULL;
+    }
+
+    for (size_t i = 0; i < size * size; i = i + 1)
+      symmetry->cells[i] = i;
+
+    for (size_t c = 0; c < size; c = c + 1)
+      symmetry->colors[c] = c;
+
+    symmetry->nb_automorphisms = 1;
+  }
+
+  return symmetry;
+}
+
+void symmetry_free(symmetry_t *symmetry)
+{
+  if (!symmetry)
+    return;
+
+  free(symmetry->cells);
+  free(symmetry->colors);
+  free(symmetry);
+}
+
+size_t symmetry_get_free(const symmetry_t *symmetry)
+{
+  return symmetry->nb_free;
+}
+
+size_t symmetry_get_automorphisms(const symmetry_t *symmetry)
+{
+  return symmetry->nb_automorphisms;
+}
+
+size_t symmetry_get_order(const symmetry_t *symmetry)
+{
+  size_t order = symmetry->nb_automorphisms;
+
+  for (size_t i = 2; i <= symmetry->nb_free; i = i + 1)
+    order = order * i;
+
+  return order;
+}
+
+/* set image to the image of the given solution by automorphism a */
+static void symmetry_apply(const symmetry_t *symmetry, const size_t a,
+                           const grid_t *solution, grid_t *image)
+{
+  size_t size = symmetry->size;
+  size_t nb_cells = size * size;
+  size_t to = 0;
+
+  for (size_t i = 0; i < nb_cells; i = i + 1)
+  {
+    to = symmetry->cells[a * nb_cells + i];
+    grid_set_colors(image, to / size, to % size,
+                    symmetry_map(symmetry, a,
+                                 grid_get_colors(solution, i / size,
+                                                 i % size)));
+  }
+}
+
+/* print the images of the given solution by every relabeling of the free
+   colors, the permutations being taken in lexicographic order */
+static void symmetry_relabel(split_t *split, const grid_t *solution)
+{
+  size_t size = grid_get_size(solution);
+  size_t colors[SYMMETRY_MAX_FREE];
+  size_t permutation[SYMMETRY_MAX_FREE];
+  size_t nb_free = split->symmetry->nb_free;
+  size_t index[MAX_SIZE];
+  colors_t free = split->symmetry->free;
+  colors_t cell = colors_empty();
+  size_t i = 0;
+  size_t j = 0;
+  size_t swap = 0;
+
+  for (i = 0; i < nb_free; i = i + 1)
+  {
+    colors[i] = colors_index(free);
+    index[colors[i]] = i;
+    permutation[i] = i;
+    free = colors_xor(free, colors_rightmost(free));
+  }
+
+  while (true)
+  {
+    grid_copy_into(split->images[0], solution);
+    for (size_t k = 0; k < size * size; k = k + 1)
+    {
+      cell = grid_get_colors(solution, k / size, k % size);
+      if (colors_and(cell, split->symmetry->free))
+        grid_set_colors(split->images[0], k / size, k % size,
+                        colors_set(colors[permutation[index[
+                          colors_index(cell)]]]));
+    }
+
+    fprintf(split->expand, "\n");
+    grid_print(split->images[0], split->expand);
+
+/* next permutation: the longest decreasing suffix is reversed after its
+   predecessor is swapped with the smallest larger element of it */
+    if (nb_free < 2)
+      return;
+
+    i = nb_free - 1;
+    while (i > 0 && permutation[i - 1] > permutation[i])
+      i = i - 1;
+
+    if (i == 0)
+      return;
+
+    j = nb_free - 1;
+    while (permutation[j] < permutation[i - 1])
+      j = j - 1;
+
+    swap = permutation[i - 1];
+    permutation[i - 1] = permutation[j];
+    permutation[j] = swap;
+    for (j = nb_free - 1; i < j; i = i + 1, j = j - 1)
+    {
+      swap = permutation[i];
+      permutation[i] = permutation[j];
+      permutation[j] = swap;
+    }
+  }
+}
+
+/* print the images of the given solution by the automorphisms of the
+   levels below the given depth, the deepest being applied first, then by
+   the relabelings of the free colors */
+static void symmetry_print(split_t *split, const grid_t *solution,
+                           const size_t depth)
+{
+  const level_t *level = NULL;
+
+  if (!depth)
+  {
+    symmetry_relabel(split, solution);
+
+    return;
+  }
+
+  level = &split->levels[depth - 1];
+  for (size_t k = 0; k < level->nb_images; k = k + 1)
+  {
+    symmetry_apply(split->symmetry, level->images[k], solution,
+                   split->images[depth]);
+    symmetry_print(split, split->images[depth], depth - 1);
+  }
+}
+
+/* print the whole orbit of the given solution */
+static void symmetry_expand(const grid_t *solution, void *arg)
+{
+  split_t *split = arg;
+
+  symmetry_print(split, solution, split->depth);
+}
+
+/* return the candidates of the given cell which no singleton of its row,
+   column or box rules out */
+static colors_t symmetry_candidates(const grid_t *grid, const size_t cell)
+{
+  size_t size = grid_get_size(grid);
+  size_t sqrt = 1;
+  size_t row = cell / size;
+  size_t column = cell % size;
+  size_t top = 0;
+  size_t left = 0;
+  colors_t candidates = grid_get_colors(grid, row, column);
+  colors_t peer = colors_empty();
+
+  while (sqrt * sqrt < size)
+    sqrt = sqrt + 1;
+
+  top = row - row % sqrt;
+  left = column - column % sqrt;
+  for (size_t k = 0; k < size; k = k + 1)
+  {
+    peer = grid_get_colors(grid, row, k);
+    if (k != column && colors_is_singleton(peer))
+      candidates = colors_subtract(candidates, peer);
+
+    peer = grid_get_colors(grid, k, column);
+    if (k != row && colors_is_singleton(peer))
+      candidates = colors_subtract(candidates, peer);
+
+    peer = grid_get_colors(grid, top + k / sqrt, left + k % sqrt);
+    if ((top + k / sqrt != row || left + k % sqrt != column) &&
+        colors_is_singleton(peer))
+      candidates = colors_subtract(candidates, peer);
+  }
+
+  return candidates;
+}
+
+/* return the number of candidates of the given cell that the given
+   automorphisms keeping the cell in place merge into orbits: the number of
+   representatives branching on it saves. If orbit is given, set it to the
+   smallest color of the orbit of each candidate */
+static size_t symmetry_score(const split_t *split, const size_t *active,
+                             const size_t nb_active, const size_t cell,
+                             size_t *orbit)
+{
+  const symmetry_t *symmetry = split->symmetry;
+  size_t size = symmetry->size;
+  size_t nb_cells = size * size;
+  colors_t candidates = symmetry_candidates(split->grid, cell);
+  colors_t merged = colors_empty();
+  size_t color = 0;
+  size_t image = 0;
+  size_t saved = 0;
+
+  while (candidates)
+  {
+    color = colors_index(candidates);
+    candidates = colors_xor(candidates, colors_rightmost(candidates));
+    if (colors_is_in(merged, color))
+      continue;
+
+    if (orbit)
+      orbit[color] = color;
+
+    for (size_t k = 0; k < nb_active; k = k + 1)
+    {
+      image = symmetry->colors[active[k] * size + color];
+      if (symmetry->cells[active[k] * nb_cells + cell] != cell ||
+          image == color || colors_is_in(merged, image))
+        continue;
+
+      merged = colors_add(merged, image);
+      if (orbit)
+        orbit[image] = color;
+
+      saved = saved + 1;
+    }
+  }
+
+  return saved;
+}
+
+/* search the representatives of the grid under the given automorphisms,
+   each one standing for factor times their number of solutions, by
+   branching on the cell whose candidates the automorphisms merge most */
+static bool symmetry_branch(split_t *split, const size_t *active,
+                            const size_t nb_active, const size_t factor)
+{
+  const symmetry_t *symmetry = split->symmetry;
+  size_t size = symmetry->size;
+  size_t nb_cells = size * size;
+  size_t orbit[MAX_GRID_SIZE];
+  size_t *kept = NULL;
+  size_t nb_kept = 0;
+  size_t cell = nb_cells;
+  size_t best = 0;
+  size_t score = 0;
+  size_t image = 0;
+  size_t found = 0;
+  level_t *level = NULL;
+  colors_t saved = colors_empty();
+  colors_t candidates = colors_empty();
+  bool go_on = true;
+
+  for (size_t i = 0; i < nb_cells && nb_active > 1 &&
+       split->depth < SYMMETRY_MAX_DEPTH; i = i + 1)
+    if (!colors_is_singleton(grid_get_colors(split->grid, i / size,
+                                             i % size)))
+    {
+      score = symmetry_score(split, active, nb_active, i, NULL);
+      if (score > best)
+      {
+        best = score;
+        cell = i;
+      }
+    }
+
+  if (best)
+  {
+    kept = malloc(nb_active * sizeof(size_t));
+    if (split->expand && !split->images[split->depth + 1])
+      split->images[split->depth + 1] = grid_copy(split->grid);
+  }
+
+  if (!kept || (split->expand && !split->images[split->depth + 1]))
+  {
+    free(kept);
+    split->outcome = solver_run(split->solver, split->grid);
+    split->count = split->count + factor * solver_get_count(split->solver);
+
+    return split->outcome != outcome_budget;
+  }
+
+  symmetry_score(split, active, nb_active, cell, orbit);
+  saved = grid_get_colors(split->grid, cell / size, cell % size);
+  candidates = symmetry_candidates(split->grid, cell);
+  level = &split->levels[split->depth];
+  split->depth = split->depth + 1;
+
+/* one branch per orbit of the candidates, the automorphisms keeping its
+   representative in place going on */
+  for (size_t c = 0; c < size && go_on; c = c + 1)
+  {
+    if (!colors_is_in(candidates, c) || orbit[c] != c)
+      continue;
+
+    level->nb_images = 0;
+    nb_kept = 0;
+    for (size_t k = 0; k < nb_active; k = k + 1)
+    {
+      if (symmetry->cells[active[k] * nb_cells + cell] != cell)
+        continue;
+
+      image = symmetry->colors[active[k] * size + c];
+      if (image == c)
+      {
+        kept[nb_kept] = active[k];
+        nb_kept = nb_kept + 1;
+      }
+
+      found = 0;
+      while (found < level->nb_images &&
+             symmetry->colors[level->images[found] * size + c] != image)
+        found = found + 1;
+
+      if (found == level->nb_images)
+      {
+        level->images[level->nb_images] = active[k];
+        level->nb_images = level->nb_images + 1;
+      }
+    }
+
+    grid_set_colors(split->grid, cell / size, cell % size, colors_set(c));
+    go_on = symmetry_branch(split, kept, nb_kept,
+                            factor * level->nb_images);
+  }
+
+  grid_set_colors(split->grid, cell / size, cell % size, saved);
+  split->depth = split->depth - 1;
+  free(kept);
+
+  return go_on;
+}
+
+/* set the stabilizer of the split to the automorphisms leaving the grid as
+   it is, now that the split row holds free colors, and return their
+   number */
+static size_t symmetry_stabilizer(split_t *split)
+{
+  const symmetry_t *symmetry = split->symmetry;
+  size_t size = symmetry->size;
+  size_t nb_cells = size * size;
+  size_t nb_kept = 0;
+  size_t to = 0;
+  bool fixed = true;
+
+  for (size_t a = 0; a < symmetry->nb_automorphisms; a = a + 1)
+  {
+    fixed = true;
+    for (size_t i = 0; i < nb_cells && fixed; i = i + 1)
+    {
+      to = symmetry->cells[a * nb_cells + i];
+      if (i / size != split->row && to / size != split->row)
+        continue;
+
+      fixed = colors_is_equal(grid_get_colors(split->grid, to / size,
+                                              to % size),
+                              symmetry_map(symmetry, a,
+                                           grid_get_colors(split->grid,
+                                                           i / size,
+                                                           i % size)));
+    }
+
+    if (fixed)
+    {
+      split->stabilizer[nb_kept] = a;
+      nb_kept = nb_kept + 1;
+    }
+  }
+
+  return nb_kept;
+}
+
+/* search the representatives whose free colors left, from the smallest, go
+   in the cells of the split row from the given one on. The cells skipped
+   hold none of them */
+static bool symmetry_split(split_t *split, const size_t from,
+                           const colors_t left)
+{
+  size_t size = grid_get_size(split->grid);
+  size_t row = split->row;
+  colors_t color = colors_rightmost(left);
+  colors_t free = split->symmetry->free;
+  size_t column = 0;
+  size_t last = split->nb_cells - colors_count(left);
+  bool go_on = true;
+
+  if (!left)
+  {
+    for (size_t i = from; i < split->nb_cells; i = i + 1)
+      grid_set_colors(split->grid, row, split->cells[i],
+                      colors_subtract(split->saved[i], free));
+
+    go_on = symmetry_branch(split, split->stabilizer,
+                            symmetry_stabilizer(split), split->order);
+  }
+  else
+    for (size_t i = from; i <= last && go_on && i < size; i = i + 1)
+    {
+      column = split->cells[i];
+      grid_set_colors(split->grid, row, column, color);
+      go_on = symmetry_split(split, i + 1, colors_xor(left, color));
+      grid_set_colors(split->grid, row, column,
+                      colors_subtract(split->saved[i], free));
+    }
+
+  for (size_t i = from; i < split->nb_cells; i = i + 1)
+    grid_set_colors(split->grid, row, split->cells[i], split->saved[i]);
+
+  return go_on;
+}
+
+solver_outcome_t symmetry_run(solver_t *solver, const grid_t *grid,
+                              const symmetry_t *symmetry, FILE *expand,
+                              size_t *count)
+{
+  size_t size = grid_get_size(grid);
+  size_t best = size + 1;
+  size_t nb_cells = 0;
+  split_t split;
+
+  if (!solver || !size || !symmetry || !count || symmetry->size != size)
+    return outcome_unsolvable;
+
+  split.solver = solver;
+  split.symmetry = symmetry;
+  split.order = symmetry_get_order(symmetry) / symmetry->nb_automorphisms;
+  split.count = 0;
+  split.outcome = outcome_unsolvable;
+  split.expand = expand;
+  split.row = 0;
+  split.nb_cells = 0;
+  split.depth = 0;
+  for (size_t i = 0; i <= SYMMETRY_MAX_DEPTH; i = i + 1)
+    split.images[i] = NULL;
+
+  split.grid = grid_copy(grid);
+  split.images[0] = expand ? grid_copy(grid) : NULL;
+  split.stabilizer = malloc(symmetry->nb_automorphisms * sizeof(size_t));
+  if (!split.grid || (expand && !split.images[0]) || !split.stabilizer)
+  {
+    grid_free(split.grid);
+    grid_free(split.images[0]);
+    free(split.stabilizer);
+
+    return outcome_unsolvable;
+  }
+
+/* the row with the fewest cells holding the free colors gives the fewest
+   representatives to search */
+  for (size_t row = 0; row < size && symmetry->nb_free; row = row + 1)
+  {
+    nb_cells = 0;
+    for (size_t column = 0; column < size; column = column + 1)
+      if (colors_and(grid_get_colors(grid, row, column), symmetry->free))
+        nb_cells = nb_cells + 1;
+
+    if (nb_cells < best)
+    {
+      best = nb_cells;
+      split.row = row;
+    }
+  }
+
+  for (size_t column = 0; column < size; column = column + 1)
+    if (colors_and(grid_get_colors(grid, split.row, column), symmetry->free))
+    {
+      split.cells[split.nb_cells] = column;
+      split.saved[split.nb_cells] = grid_get_colors(grid, split.row, column);
+      split.nb_cells = split.nb_cells + 1;
+    }
+
+  if (expand)
+  {
+    solver_set_output(solver, NULL);
+    solver_set_visitor(solver, symmetry_expand, &split);
+  }
+
+/* a row too short for the free colors holds no solution */
+  if (split.nb_cells >= symmetry->nb_free)
+    symmetry_split(&split, 0, symmetry->free);
+
+  solver_set_visitor(solver, NULL, NULL);
+
+  grid_free(split.grid);
+  for (size_t i = 0; i <= SYMMETRY_MAX_DEPTH; i = i + 1)
+    grid_free(split.images[i]);
+
+  free(split.stabilizer);
+  *count = split.count;
+  if (split.outcome == outcome_budget)
+    return outcome_budget;
+
+  return split.count ? outcome_solved : outcome_unsolvable;
+}
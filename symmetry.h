@@ -0,0 +1,65 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <grid.h>
+#include <solver.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* largest number of free colors broken, and of automorphisms kept (none is
+   beyond), so that the order of the symmetry group fits in a size_t
+   (16! * 4096 < 2^64) */
+#define SYMMETRY_MAX_FREE 16
+#define SYMMETRY_MAX_AUTOMORPHISMS 4096
+
+/* largest number of cells branched on through the automorphisms */
+#define SYMMETRY_MAX_DEPTH 64
+
+/* Symmetry of a grid, made of the relabelings of its free colors (the
+   colors given by no clue, which every cell holds all or none of) and of
+   its automorphisms (transposition, permutations of the bands, stacks, rows
+   or columns, with a relabeling of the colors given by clues, leaving the
+   grid as it is, see grid_automorphisms). Each one maps a solution to
+   another one. The automorphisms are only known when the search of the
+   canonical form is exhaustive, which it is not for the near-empty grids
+   of size 9 and more: only the free colors are broken then (forward
+   declaration to hide the implementation) */
+typedef struct symmetry_t symmetry_t;
+
+/* memory allocation of the symmetry of the given grid. return NULL if the
+   grid is invalid or memory is lacking */
+symmetry_t *symmetry_new(const grid_t *grid);
+
+/* free the allocated memory of the given symmetry */
+void symmetry_free(symmetry_t *symmetry);
+
+/* return the number of free colors broken by the given symmetry */
+size_t symmetry_get_free(const symmetry_t *symmetry);
+
+/* return the number of automorphisms of the given symmetry, identity
+   included */
+size_t symmetry_get_automorphisms(const symmetry_t *symmetry);
+
+/* return the order of the given symmetry, i.e the size of the largest
+   orbits: the number of automorphisms times the factorial of the number of
+   free colors */
+size_t symmetry_get_order(const symmetry_t *symmetry);
+
+/* search the solutions of the given grid with the given solver, in
+   mode_all or mode_count, by exploring a single representative of each
+   orbit of the given symmetry: the free colors come in order in the row
+   with the fewest cells holding them, then the cells whose candidates an
+   automorphism keeping them in place (and the grid as it is) moves are
+   branched on, a single candidate of each orbit being explored. Each
+   representative stands for the solutions of its orbit. In mode_all, each
+   representative is printed on the output of the solver, or replaced by
+   its whole orbit printed on expand if given (the output of the solver is
+   then cleared). count is set to the number of solutions. return the
+   outcome, as solver_run does */
+solver_outcome_t symmetry_run(solver_t *solver, const grid_t *grid,
+                              const symmetry_t *symmetry, FILE *expand,
+                              size_t *count);
+
+#endif /* SYMMETRY_H */
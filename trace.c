@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <trace.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* the events are written through a large buffer, a node costs a few
+   dozens of bytes */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+static const char *outcome_names[] = {"branch", "solved", "inconsistent",
+                                      "known"};
+
+/* Interal structure (hiden from outside) to represent a tracer. The
+   timestamps are given from the creation of the tracer */
+struct trace_t
+{
+  FILE *fd;
+  char *buffer;
+  size_t sampling;
+  uint64_t origin;
+  size_t run;
+};
+
+uint64_t trace_clock(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/* microseconds from the origin of the given tracer */
+static double trace_us(const trace_t *trace, const uint64_t when)
+{
+  return (double) (when - trace->origin) / 1000.0;
+}
+
+trace_t *trace_new(const char *path, const size_t sampling)
+{
+  trace_t *trace = NULL;
+
+  if (!path)
+    return NULL;
+
+  trace = calloc(1, sizeof(trace_t));
+  if (!trace)
+    return NULL;
+
+  trace->fd = fopen(path, "w");
+  trace->buffer = malloc(TRACE_BUFFER_SIZE);
+  if (!trace->fd || !trace->buffer)
+  {
+    if (trace->fd)
+      fclose(trace->fd);
+
+    free(trace->buffer);
+    free(trace);
+
+    return NULL;
+  }
+
+  setvbuf(trace->fd, trace->buffer, _IOFBF, TRACE_BUFFER_SIZE);
+  trace->sampling = sampling ? sampling : 1;
+  trace->origin = trace_clock();
+  fprintf(trace->fd, "[\n");
+
+  return trace;
+}
+
+void trace_free(trace_t *trace)
+{
+  if (!trace)
+    return;
+
+/* the last event closes the array, the viewer also reads a trace cut
+   before it */
+  fprintf(trace->fd, "{\"name\": \"trace_end\", \"ph\": \"i\", \"s\": \"g\","
+          " \"ts\": %.3f, \"pid\": %zu, \"tid\": 0}\n]\n",
+          trace_us(trace, trace_clock()), trace->run);
+  fclose(trace->fd);
+  free(trace->buffer);
+  free(trace);
+}
+
+void trace_run(trace_t *trace, const char *name)
+{
+  if (!trace)
+    return;
+
+  trace->run = trace->run + 1;
+  fprintf(trace->fd, "{\"name\": \"process_name\", \"ph\": \"M\","
+          " \"pid\": %zu, \"args\": {\"name\": \"", trace->run);
+
+/* the name is a path, its quotes and backslashes are escaped */
+  for (const char *c = name ? name : "search"; *c; c = c + 1)
+    if (*c == '"' || *c == '\\')
+      fprintf(trace->fd, "\\%c", *c);
+    else if ((unsigned char) *c >= ' ')
+      fputc(*c, trace->fd);
+
+  fprintf(trace->fd, "\"}},\n");
+}
+
+bool trace_wants(const trace_t *trace, const size_t node)
+{
+  return trace && node % trace->sampling == 0;
+}
+
+void trace_node(trace_t *trace, const trace_node_t *node)
+{
+  if (!trace || !node)
+    return;
+
+  fprintf(trace->fd, "{\"name\": \"%s\", \"cat\": \"node\", \"ph\": \"X\","
+          " \"ts\": %.3f, \"dur\": %.3f, \"pid\": %zu, \"tid\": %zu,"
+          " \"args\": {\"depth\": %zu, \"passes\": %zu,"
+          " \"eliminations\": %zu", outcome_names[node->outcome],
+          trace_us(trace, node->start),
+          (double) (node->end - node->start) / 1000.0, trace->run,
+          node->depth, node->depth, node->passes, node->eliminations);
+
+  if (node->outcome == trace_branch)
+    fprintf(trace->fd, ", \"row\": %zu, \"column\": %zu, \"color\": \"%s\"",
+            node->row, node->column, node->color);
+
+  fprintf(trace->fd, "}},\n");
+}
+
+void trace_end(trace_t *trace, const uint64_t when, const char *how)
+{
+  if (!trace)
+    return;
+
+  fprintf(trace->fd, "{\"name\": \"%s\", \"cat\": \"run\", \"ph\": \"i\","
+          " \"s\": \"p\", \"ts\": %.3f, \"pid\": %zu, \"tid\": 0},\n", how,
+          trace_us(trace, when), trace->run);
+}
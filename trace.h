@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* how a node of the search ended */
+typedef enum
+{
+  trace_branch,
+  trace_solved,
+  trace_inconsistent,
+  trace_known
+} trace_outcome_t;
+
+/* a node of the search: its propagation, from start to end (nanoseconds of
+   CLOCK_MONOTONIC), and the choice it branched on if its outcome is
+   trace_branch */
+typedef struct
+{
+  size_t depth;
+  uint64_t start;
+  uint64_t end;
+  size_t passes;
+  size_t eliminations;
+  trace_outcome_t outcome;
+  size_t row;
+  size_t column;
+  char color[4];
+} trace_node_t;
+
+/* Search tracer writing a file in the Chrome trace-event format (forward
+   declaration to hide the implementation), one event per line. Each run is
+   a process, each depth of its search a thread, so that the viewer lays
+   the nodes out as a tree over time */
+typedef struct trace_t trace_t;
+
+/* memory allocation for a tracer writing in the file at the given path,
+   which keeps one node out of sampling. return NULL if the file could not
+   be opened */
+trace_t *trace_new(const char *path, const size_t sampling);
+
+/* close the trace file of the given tracer and free it */
+void trace_free(trace_t *trace);
+
+/* start a new run of the given name, its nodes are grouped apart */
+void trace_run(trace_t *trace, const char *name);
+
+/* check if the node of the given number has to be recorded */
+bool trace_wants(const trace_t *trace, const size_t node);
+
+/* record the given node in the current run */
+void trace_node(trace_t *trace, const trace_node_t *node);
+
+/* record the end of the current run at the given time, and how it ended
+   (e.g. "solved", "exhausted" when the whole tree was explored, "budget") */
+void trace_end(trace_t *trace, const uint64_t when, const char *how);
+
+/* return the current time as it is given to trace_node */
+uint64_t trace_clock(void);
+
+#endif /* TRACE_H */
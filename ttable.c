@@ -0,0 +1,153 @@
+#include <ttable.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* entries per bucket, a bucket spans at most two cache lines */
+#define BUCKET_SIZE 4
+
+/* the count and the nodes of an entry share one word: the nodes saturate,
+   states with too many solutions are not stored */
+#define COUNT_BITS 40
+#define NODES_MAX ((1ULL << (64 - COUNT_BITS)) - 1)
+#define COUNT_MAX ((1ULL << COUNT_BITS) - 1)
+
+typedef struct
+{
+  uint64_t hash;
+  uint64_t check;
+  uint64_t data;
+} entry_t;
+
+typedef struct
+{
+  entry_t entries[BUCKET_SIZE];
+} bucket_t;
+
+/* Interal structure (hiden from outside) to represent a transposition
+   table. The number of buckets is a power of two. A hash of 0 marks an
+   empty entry, the hashes of 0 are stored as 1. An entry only matches a
+   state whose check is also the same, so that two states must collide on
+   128 bits to be confused */
+struct ttable_t
+{
+  size_t nb_buckets;
+  size_t hits;
+  bucket_t *buckets;
+};
+
+ttable_t *ttable_new(const size_t bytes)
+{
+  ttable_t *table = NULL;
+  size_t nb_buckets = 1;
+
+  if (bytes < sizeof(bucket_t))
+    return NULL;
+
+  while (nb_buckets * 2 * sizeof(bucket_t) <= bytes)
+    nb_buckets = nb_buckets * 2;
+
+  table = calloc(1, sizeof(ttable_t));
+  if (!table)
+    return NULL;
+
+  table->buckets = calloc(nb_buckets, sizeof(bucket_t));
+  if (!table->buckets)
+  {
+    free(table);
+
+    return NULL;
+  }
+
+  table->nb_buckets = nb_buckets;
+
+  return table;
+}
+
+void ttable_free(ttable_t *table)
+{
+  if (!table)
+    return;
+
+  free(table->buckets);
+  free(table);
+}
+
+void ttable_clear(ttable_t *table)
+{
+  if (!table)
+    return;
+
+  memset(table->buckets, 0, table->nb_buckets * sizeof(bucket_t));
+  table->hits = 0;
+}
+
+static bucket_t *ttable_bucket(const ttable_t *table, const uint64_t hash)
+{
+  return &table->buckets[(hash >> 32 ^ hash) & (table->nb_buckets - 1)];
+}
+
+bool ttable_lookup(ttable_t *table, const uint64_t hash, const uint64_t check,
+                   size_t *count)
+{
+  uint64_t key = hash ? hash : 1;
+  bucket_t *bucket = NULL;
+
+  if (!table)
+    return false;
+
+  bucket = ttable_bucket(table, key);
+  for (size_t i = 0; i < BUCKET_SIZE; i = i + 1)
+    if (bucket->entries[i].hash == key && bucket->entries[i].check == check)
+    {
+      *count = bucket->entries[i].data & COUNT_MAX;
+      table->hits = table->hits + 1;
+
+      return true;
+    }
+
+  return false;
+}
+
+void ttable_store(ttable_t *table, const uint64_t hash, const uint64_t check,
+                  const size_t count, const size_t nodes)
+{
+  uint64_t key = hash ? hash : 1;
+  bucket_t *bucket = NULL;
+  entry_t *victim = NULL;
+  uint64_t cost = nodes < NODES_MAX ? nodes : NODES_MAX;
+
+  if (!table || count > COUNT_MAX)
+    return;
+
+/* the same state, or else an empty entry, or else the cheapest one */
+  bucket = ttable_bucket(table, key);
+  victim = &bucket->entries[0];
+  for (size_t i = 0; i < BUCKET_SIZE; i = i + 1)
+  {
+    if ((bucket->entries[i].hash == key &&
+         bucket->entries[i].check == check) || !bucket->entries[i].hash)
+    {
+      victim = &bucket->entries[i];
+      break;
+    }
+
+    if (bucket->entries[i].data >> COUNT_BITS < victim->data >> COUNT_BITS)
+      victim = &bucket->entries[i];
+  }
+
+  victim->hash = key;
+  victim->check = check;
+  victim->data = cost << COUNT_BITS | count;
+}
+
+size_t ttable_get_hits(const ttable_t *table)
+{
+  if (!table)
+    return 0;
+
+  return table->hits;
+}
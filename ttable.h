@@ -0,0 +1,38 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bounded transposition table of search states (forward declaration to hide
+   the implementation). A state is known by the hash of its grid (see
+   grid_get_hash), verified by its check (see grid_get_check), and is stored with the number of solutions of its subtree,
+   '0' for a dead state, and the number of nodes this subtree took. When a
+   bucket is full, the entry which was the cheapest to compute goes */
+typedef struct ttable_t ttable_t;
+
+/* memory allocation for a table using at most the given number of bytes.
+   return NULL if it is too small to hold a single bucket */
+ttable_t *ttable_new(const size_t bytes);
+
+/* free the allocated memory of the given table */
+void ttable_free(ttable_t *table);
+
+/* forget every state of the given table */
+void ttable_clear(ttable_t *table);
+
+/* look for the state of the given hash and check, and set count to its
+   number of solutions. return false if it is unknown */
+bool ttable_lookup(ttable_t *table, const uint64_t hash, const uint64_t check,
+                   size_t *count);
+
+/* store the state of given hash and check with the number of solutions and
+   of nodes of its subtree */
+void ttable_store(ttable_t *table, const uint64_t hash, const uint64_t check,
+                  const size_t count, const size_t nodes);
+
+/* return the number of successful lookups since the last clear */
+size_t ttable_get_hits(const ttable_t *table);
+
+#endif /* TTABLE_H */